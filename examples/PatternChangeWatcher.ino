@@ -23,6 +23,11 @@ class PatternChangeWatcher : public PixelblazeWatcher {
 public:
     PatternChangeWatcher() : PixelblazeWatcher() {}
 
+    //Only pattern changes are handled, so stats and preview frames can be dropped without being parsed
+    int watchedEvents() override {
+        return (int) WatchedEvent::PatternChange;
+    }
+
     void handlePatternChange(SequencerState &patternChange) override {
         Serial.print(F("Pattern change detected. New pattern: "));
         Serial.print(patternChange.name);
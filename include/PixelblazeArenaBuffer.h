@@ -0,0 +1,151 @@
+#ifndef PixelblazeArenaBuffer_h
+#define PixelblazeArenaBuffer_h
+
+#include "PixelblazeClient.h"
+
+/**
+ * Buffers large binary reads in one block of memory split into fixed size chunks. Each buffer is a chain of as many
+ * chunks as its contents need, growing a chunk at a time as it's written, so small replies take one chunk and large
+ * ones can use most of the arena. Buffers are found by name through a small open addressing hash index.
+ *
+ * Everything is allocated once, when the buffer is constructed.
+ *
+ * garbageCollect() compacts the arena so each buffer's chunks are contiguous and the free ones are together at the
+ * end, which lets BorrowableStream hand out longer spans. It invalidates any open streams.
+ */
+class PixelblazeArenaBuffer : public PixelblazeBuffer {
+public:
+    /**
+     * @param arenaBytes rounded down to a whole number of chunks, at most 65533 of them
+     * @param maxBuffers how many named buffers can exist at once
+     */
+    explicit PixelblazeArenaBuffer(size_t arenaBytes = 30000, size_t chunkBytes = 256, size_t maxBuffers = 16);
+
+    virtual ~PixelblazeArenaBuffer();
+
+    PixelblazeArenaBuffer(const PixelblazeArenaBuffer &) = delete;
+
+    PixelblazeArenaBuffer &operator=(const PixelblazeArenaBuffer &) = delete;
+
+    CloseableStream *makeWriteStream(String &key, bool append) override;
+
+    CloseableStream *makeReadStream(String &key) override;
+
+    void deleteStreamResults(String &key) override;
+
+    void garbageCollect() override;
+
+    size_t getFreeBytes() const {
+        return freeChunks * chunkBytes;
+    }
+
+    size_t getChunkBytes() const {
+        return chunkBytes;
+    }
+
+private:
+    friend class ArenaStream;
+
+    static const uint16_t NO_CHUNK = 0xFFFF;
+    static const uint16_t FREE_CHUNK = 0xFFFE;
+    static const int16_t EMPTY_SLOT = -1;
+    static const int16_t DELETED_SLOT = -2;
+
+    struct Entry {
+        String name;
+        uint32_t hash = 0;
+        uint16_t first = NO_CHUNK;
+        uint16_t last = NO_CHUNK;
+        //Bytes written to the last chunk
+        size_t tailFill = 0;
+        size_t used = 0;
+        bool live = false;
+    };
+
+    static uint32_t hashKey(String &key);
+
+    /**
+     * @return the index slot holding key, or the first slot it could be inserted at if it's not present
+     */
+    size_t findSlot(String &key, uint32_t hash, bool &found) const;
+
+    int findEntry(String &key) const;
+
+    int createEntry(String &key);
+
+    uint8_t *chunkData(uint16_t chunk) const {
+        return arena + (size_t) chunk * chunkBytes;
+    }
+
+    /**
+     * Add a chunk to the end of an entry's chain
+     *
+     * @return false if the arena is full
+     */
+    bool growEntry(Entry &entry);
+
+    void freeChain(Entry &entry);
+
+    void rebuildIndex();
+
+    void swapChunks(uint16_t a, uint16_t b);
+
+    uint8_t *arena;
+    size_t chunkBytes;
+    uint16_t numChunks;
+    //Each chunk's successor in its buffer's chain, or in the free list
+    uint16_t *nextChunk;
+    uint16_t freeList = NO_CHUNK;
+    size_t freeChunks = 0;
+
+    Entry *entries;
+    size_t maxBuffers;
+    int16_t *index;
+    size_t indexMask;
+    //Slots holding an entry or marked deleted, kept to at most half the index
+    size_t occupiedSlots = 0;
+};
+
+/**
+ * Reads or writes one buffer of a PixelblazeArenaBuffer, lending out a chunk at a time when borrowed from
+ */
+class ArenaStream : public Stream, public BorrowableStream {
+public:
+    ArenaStream(PixelblazeArenaBuffer &owner, int entryIdx, bool readable);
+
+    using Stream::readBytes;
+
+    size_t write(uint8_t v) override {
+        return write(&v, 1);
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) override;
+
+    int available() override {
+        return readable ? (int) remaining : 0;
+    }
+
+    int read() override;
+
+    size_t readBytes(char *buffer, size_t length) override;
+
+    int peek() override;
+
+    const uint8_t *borrowRead(size_t &len) override;
+
+    void consumeRead(size_t len) override;
+
+    uint8_t *borrowWrite(size_t &len) override;
+
+    void commitWrite(size_t len) override;
+
+private:
+    PixelblazeArenaBuffer &owner;
+    PixelblazeArenaBuffer::Entry &entry;
+    bool readable;
+    uint16_t readChunk;
+    size_t readOffset = 0;
+    size_t remaining;
+};
+
+#endif
@@ -6,6 +6,12 @@
 
 #include "PixelblazeHandlers.h"
 #include "PixelblazeCommon.h"
+#include "PixelblazeFloatFormat.h"
+#include "PixelblazeHandlerPool.h"
+#include "PixelblazeJsonStream.h"
+#include "PixelblazeReplyTimeouts.h"
+#include "PixelblazePreviewExchange.h"
+#include "PixelblazePreviewDelta.h"
 
 static String defaultPlaylist = String("_defaultplaylist_");
 static ClientConfig defaultConfig = {};
@@ -81,6 +87,92 @@ public:
         return millis() - lastSuccessfulPingAtMs;
     }
 
+    /**
+     * With clientConfig.coalescePreviewFrames set, each checkForInbound() call delivers only the newest preview frame
+     * it read. This counts the older ones that were dropped instead of delivered.
+     *
+     * @return preview frames dropped since the client was created
+     */
+    uint32_t getDroppedPreviewFrames() const {
+        return droppedPreviewFrames;
+    }
+
+    /**
+     * With clientConfig.previewFrameHandoff set, every preview frame is published here after the watcher sees it. A
+     * single consumer on another core or thread can call takeLatest() on it to get the newest frame without locking
+     * or copying, while checkForInbound() keeps running.
+     *
+     * @return the exchange preview frames are published to, nullptr if handoff isn't enabled
+     */
+    PreviewFrameExchange *getPreviewFrameExchange() {
+        return previewExchange;
+    }
+
+    /**
+     * With clientConfig.previewChangeDetection set, preview frames identical to the one before are dropped before
+     * reaching the watcher or the frame exchange.
+     *
+     * @return preview frames dropped as unchanged since the client was created
+     */
+    uint32_t getUnchangedPreviewFrames() const {
+        return unchangedPreviewFrames;
+    }
+
+    /**
+     * Show every inbound message to observer as it's read, for capturing sessions. Costs nothing while unset, and with
+     * one set parts of messages that would be skipped are read for it instead.
+     *
+     * @param observer must outlive the client or be replaced, nullptr to stop observing
+     */
+    void setInboundObserver(InboundObserver *observer) {
+        inboundObserver = observer;
+    }
+
+    /**
+     * Start collecting setter changes to send together as one message. Until commitBatch() or abortBatch(),
+     * setBrightness(), setBrightnessLimit(), setCurrentPatternControl(), setCurrentPatternControls(),
+     * setSequencerMode(), playSequence(), pauseSequence() and setPlaylistIndex() add their change to the batch and
+     * return true instead of sending. Later changes to the same setting replace earlier ones, controls are merged.
+     * Anything else is sent immediately as usual.
+     *
+     * Batched changes skip clientConfig.setterCoalesceWindowMs, and replace any value it was holding.
+     *
+     * @return false if a batch was already open, in which case it's left as is
+     */
+    bool beginBatch();
+
+    /**
+     * Send everything changed since beginBatch() as a single message. If any change in the batch asked to be saved
+     * to flash, the whole batch is.
+     *
+     * @return true if the batch was sent or empty, false if none was open, it outgrew clientConfig.batchJsonBytes, or
+     *         the send failed. The batch is closed either way.
+     */
+    bool commitBatch();
+
+    /**
+     * Drop everything changed since beginBatch() without sending it
+     */
+    void abortBatch();
+
+    bool isBatching() const {
+        return batching;
+    }
+
+    /**
+     * Send every setter value held by clientConfig.setterCoalesceWindowMs now, without waiting out its window
+     *
+     * @return true if everything held was sent, false otherwise.
+     */
+    bool flushCoalescedSetters();
+
+    /**
+     * @return setter calls that were superseded by a later value before being sent, since the client was created
+     */
+    uint32_t getCoalescedSetterCount() const {
+        return coalescedSetters;
+    }
+
     /**
      * Get a list of all patterns on the device
      *
@@ -168,10 +260,14 @@ public:
     /**
      * Set the active brightness
      *
+     * With clientConfig.setterCoalesceWindowMs set, unsaved values may be held and sent later from checkForInbound(),
+     * see flushCoalescedSetters(). The same goes for setBrightnessLimit() and for each control set by
+     * setCurrentPatternControl() or setCurrentPatternControls().
+     *
      * @param brightness clamped to [0, 1.0], with 0 being fully off and 1.0 indicating full brightness
      * @param saveToFlash whether to persist the value through restarts. While you can send these at high volume
-     *                    for smooth dimming, only save when the value settles.
-     * @return true if the request was dispatched, false otherwise.
+     *                    for smooth dimming, only save when the value settles. Saved values are always sent at once.
+     * @return true if the request was dispatched or held, false otherwise.
      */
     bool setBrightness(float brightness, bool saveToFlash);
 
@@ -329,44 +425,59 @@ public:
     /**
      * Utility function for interacting with the backend in arbitrary ways if they're not implemented in this library
      *
-     * @param replyHandler handler to deal with the resulting message
-     * @param request json to send to the backend
-     * @return true if the request was dispatched, false otherwise.
-     */
-    bool rawRequest(RawBinaryHandler &replyHandler, JsonDocument &request);
-
-    /**
-     * Utility function for interacting with the backend in arbitrary ways if they're not implemented in this library
+     * The handler is copied into the client's handler pool, so it must subclass RawTextHandler or RawBinaryHandler
+     * and be no larger than RAW_HANDLER_MAX_BYTES.
      *
      * @param replyHandler handler to deal with the resulting message
      * @param request json to send to the backend
      * @return true if the request was dispatched, false otherwise.
      */
-    bool rawRequest(RawTextHandler &replyHandler, JsonDocument &request);
+    template<class Handler>
+    bool rawRequest(Handler &replyHandler, JsonDocument &request) {
+        if (!enqueueRawHandler(replyHandler)) {
+            return false;
+        }
+
+        return sendJson(request);
+    }
 
     /**
      * Utility function for interacting with the backend in arbitrary ways if they're not implemented in this library
      *
-     * Note that the maximum chunk size is bounded by binaryBufferBytes
+     * The handler is copied into the client's handler pool, so it must subclass RawTextHandler or RawBinaryHandler
+     * and be no larger than RAW_HANDLER_MAX_BYTES. Note that the maximum chunk size is bounded by binaryBufferBytes
      *
      * @param replyHandler handler to deal with the resulting message
      * @param rawRequestBinType the raw BinaryMsgType of the outbound request
      * @param request Binary stream to send to the backend
      * @return true if the request was dispatched, false otherwise.
      */
-    bool rawRequest(RawBinaryHandler &replyHandler, int rawRequestBinType, Stream &request);
+    template<class Handler>
+    bool rawRequest(Handler &replyHandler, int rawRequestBinType, Stream &request) {
+        if (!enqueueRawHandler(replyHandler)) {
+            return false;
+        }
+
+        return sendBinary(rawRequestBinType, request);
+    }
 
     /**
-     * Utility function for interacting with the backend in arbitrary ways if they're not implemented in this library
-     *
-     * Note that the maximum chunk size is bounded by binaryBufferBytes
+     * Override clientConfig.maxResponseWaitMs for the next request made that waits on a reply, whether or not it's
+     * accepted. Setters and other sends that expect no reply leave it in place. Raw handlers can instead carry their
+     * own ReplyHandler::timeoutMs, which takes precedence.
      *
-     * @param replyHandler handler to deal with the resulting message
-     * @param rawBinType the raw BinaryMsgType of the outbound request
-     * @param request Binary stream to send to the backend
-     * @return true if the request was dispatched, false otherwise.
+     * @param timeoutMs how long to wait for the reply before failing it with FailureCause::TimedOut
+     */
+    void setNextRequestTimeoutMs(uint32_t timeoutMs) {
+        nextRequestTimeoutMs = timeoutMs;
+    }
+
+    /**
+     * @return how many requests were refused because every handler pool slot was in use
      */
-    bool rawRequest(RawTextHandler &replyHandler, int rawBinType, Stream &request);
+    uint32_t getHandlerPoolExhaustedCount() const {
+        return handlerPool.getExhaustedCount();
+    }
 
     /**
      * Default handler for reply error reporting. Error codes are represented by the FAILURE_
@@ -401,18 +512,41 @@ private:
 
     void weedExpiredReplies();
 
-    void seekingTextHasText();
+    void readBinaryReply();
+
+    /**
+     * Read a reply that came in a single frame, flag already read, then dispatch and retire its handler
+     */
+    void readLoneBinaryReply(ReplyHandler *handler);
+
+    /**
+     * Buffer the first frame of a multipart reply, flag already read, and make it the read in progress
+     */
+    void startMultipartRead(ReplyHandler *handler, int frameType);
+
+    /**
+     * Fail the multipart read in progress and drop what it buffered
+     */
+    void abandonMultipartRead();
+
+    bool readJsonFrame();
 
-    void seekingBinaryHasText();
+    void streamTextFrame(TextFrameKind kind, int buffered, int frameLen);
 
-    void seekingTextHasBinary();
+    void rebuildJsonFilter();
 
-    void seekingBinaryHasBinary();
+    static TextFrameKind classifyTextFrame(const char *frame, size_t len);
+
+    static const char *textFrameKey(TextFrameKind kind);
 
     bool readBinaryToStream(ReplyHandler *handler, String &bufferId, bool append);
 
     size_t queueLength() const;
 
+    ReplyHandler *findTextReply();
+
+    ReplyHandler *findBinaryReply(int rawBinType);
+
     void dispatchTextReply(ReplyHandler *handler);
 
     void dispatchBinaryReply(ReplyHandler *handler);
@@ -421,13 +555,69 @@ private:
 
     bool handleUnrequestedBinary(int rawBinaryType);
 
+    void deliverPreviewFrame(uint8_t *frame, size_t len);
+
+    /**
+     * Read from the current message, showing the bytes to the inbound observer if there is one
+     */
+    int readInbound(uint8_t *buffer, size_t len);
+
+    int readInbound();
+
+    /**
+     * Read the rest of the current message through to the inbound observer and end it there
+     */
+    void finishInbound();
+
+    /**
+     * Construct a handler in the pool, compacting the queue first if the pool is out of slots
+     *
+     * @return the handler, or nullptr if there's still no room
+     */
+    template<class Handler, class... Args>
+    Handler *makeHandler(Args &&... args) {
+        if (handlerPool.available() == 0) {
+            weedExpiredReplies();
+        }
+
+        Handler *handler = handlerPool.make<Handler>(std::forward<Args>(args)...);
+        if (!handler) {
+            Serial.println(F("Reply handler pool exhausted"));
+            //The request is refused, a timeout meant for it mustn't land on the next one
+            nextRequestTimeoutMs = 0;
+        }
+
+        return handler;
+    }
+
+    template<class Handler>
+    bool enqueueRawHandler(Handler &replyHandler) {
+        static_assert(std::is_base_of<RawTextHandler, Handler>::value
+                      || std::is_base_of<RawBinaryHandler, Handler>::value,
+                      "rawRequest() handlers must subclass RawTextHandler or RawBinaryHandler");
+
+        //Copied as its own type, so overridden handle() and jsonMatches() survive
+        auto *myHandler = makeHandler<Handler>(replyHandler);
+        if (!myHandler) {
+            return false;
+        }
+
+        myHandler->requestTsMs = millis();
+        myHandler->satisfied = false;
+
+        if (!enqueueReply(myHandler)) {
+            handlerPool.release(myHandler);
+            return false;
+        }
+
+        return true;
+    }
+
     bool enqueueReply(ReplyHandler *handler);
 
     bool enqueueReplies(int, ...);
 
-    void dequeueReply();
-
-    void compactQueue();
+    void retireReply(ReplyHandler *handler);
 
     void evictQueue(FailureCause cause);
 
@@ -435,8 +625,72 @@ private:
 
     bool sendJson(JsonDocument &doc);
 
+    bool sendRaw(const char *frame, size_t len);
+
+    template<size_t N>
+    bool sendRaw(const char (&frame)[N]) {
+        return sendRaw(frame, N - 1);
+    }
+
+    bool sendIntFrame(const char *prefix, long value, const char *suffix);
+
+    /**
+     * Set a JSON slot to a setter's float value, as fixed point text of clientConfig.setterFloatDecimals places when
+     * that's set. The text is copied into the document, so it can live on the stack.
+     */
+    template<class Slot>
+    void putSetterFloat(Slot slot, float value) {
+        if (clientConfig.setterFloatDecimals > 0) {
+            char text[24];
+            size_t len = formatFixedFloat(text, sizeof(text), value, clientConfig.setterFloatDecimals);
+            if (len > 0) {
+                slot = serialized(text, len);
+                return;
+            }
+        }
+
+        slot = value;
+    }
+
+    /**
+     * The latest value of a coalesced setter and when it was last sent
+     */
+    struct HeldSetting {
+        float value = 0;
+        uint32_t lastSentMs = 0;
+        bool sentOnce = false;
+        bool pending = false;
+    };
+
+    struct HeldControl {
+        String name;
+        HeldSetting setting;
+    };
+
+    bool holdSetting(HeldSetting &setting, float value, bool saveToFlash);
+
+    bool settingDue(HeldSetting &setting, uint32_t nowMs) const;
+
+    HeldControl *heldControl(String &controlName);
+
+    bool sendHeldSettings(bool force);
+
+    bool sendBrightness(float brightness, bool saveToFlash);
+
+    JsonDocument &setterDoc();
+
+    JsonObject setControlsObj(JsonDocument &doc);
+
+    bool sendSetter(JsonDocument &doc);
+
+    bool sendSetter(JsonDocument &doc, bool saveToFlash);
+
+    bool sendBrightnessLimit(float value, bool saveToFlash);
+
     bool sendBinary(int rawBinType, Stream &stream);
 
+    bool sendBinaryFrame(int binType, int frameType, size_t bodyLen);
+
     static String *getColorOrder(uint8_t code);
 
 private:
@@ -445,9 +699,20 @@ private:
     PixelblazeWatcher &watcher;
     ClientConfig clientConfig;
 
-    ReplyHandler **replyQueue;
-    size_t queueFront = 0;
-    size_t queueBack = 0;
+    /**
+     * Handlers waiting on a reply, one oldest-first list per ReplyHandlerType
+     */
+    struct ReplyList {
+        ReplyHandler *oldest = nullptr;
+        ReplyHandler *newest = nullptr;
+    };
+
+    ReplyHandlerPool handlerPool;
+    ReplyList replyLists[REPLY_HANDLER_TYPE_COUNT];
+    ReplyTimeouts replyTimeouts;
+    uint32_t nextRequestTimeoutMs = 0;
+    size_t pendingReplies = 0;
+    uint32_t nextReplySeq = 0;
 
     SequencerState sequencerState;
     Stats statsEvent;
@@ -463,10 +728,36 @@ private:
     size_t controlCount = 0;
 
     uint8_t *byteBuffer;
+    uint8_t *previewFrame = nullptr;
+    PreviewFrameExchange *previewExchange = nullptr;
+    InboundObserver *inboundObserver = nullptr;
+    PreviewFrameDiffer *previewDiffer = nullptr;
+    uint32_t unchangedPreviewFrames = 0;
+    size_t previewFrameLen = 0;
+    bool previewFramePending = false;
+    uint32_t droppedPreviewFrames = 0;
+    char *sendBuffer;
     char *textReadBuffer;
+    char *textFrameBuffer;
     DynamicJsonDocument json;
+    DynamicJsonDocument jsonFilter;
+    DynamicJsonDocument batchJson;
+    JsonStreamTokenizer jsonTokenizer;
+    bool batching = false;
+    bool batchSave = false;
+    bool jsonFilterDirty = true;
+    bool jsonFilterActive = false;
+
+    HeldSetting heldBrightness;
+    HeldSetting heldBrightnessLimit;
+    HeldControl *heldControls = nullptr;
+    size_t heldControlCount = 0;
+    bool settingsHeld = false;
+    uint32_t coalescedSetters = 0;
 
     int rawBinaryReadType = -1;
+    //Handler the multipart binary reply being read belongs to
+    ReplyHandler *binaryReadHandler = nullptr;
 
     uint32_t lastPingAtMs = 0;
     uint32_t lastSuccessfulPingAtMs = 0;
@@ -5,6 +5,8 @@
 #include <Stream.h>
 #include "Arduino.h"
 
+class PreviewFrameDiffer;
+
 enum class WebsocketFormat : uint8_t {
     Text = 1,
     Binary = 2,
@@ -39,6 +41,9 @@ enum class ReplyHandlerType : uint8_t {
     PatternControls = 11,
 };
 
+//One past the largest ReplyHandlerType, pending replies are kept in a list per type
+#define REPLY_HANDLER_TYPE_COUNT 12
+
 enum class LedType : uint8_t {
     None = 0,
     APA102_SK9822_DOTSTAR = 1,
@@ -183,6 +188,25 @@ enum class SettingReply : uint8_t {
     Expander = 4
 };
 
+/**
+ * What a text frame carries, judged from its first key without parsing it
+ */
+enum class TextFrameKind : uint8_t {
+    Stats = 1,
+    ActiveProgram = 2,
+    Playlist = 3,
+    Ack = 4,
+    Other = 255
+};
+
+enum class WatchedEvent : uint8_t {
+    Stats = 1,
+    PatternChange = 2,
+    PreviewFrame = 4,
+    PlaylistChange = 8,
+    PreviewChange = 16
+};
+
 enum class BinaryMsgType : uint8_t {
     PutSource = 1,
     PutByteCode = 3,
@@ -314,10 +338,20 @@ struct ExpanderChannel {
 struct ClientConfig {
     size_t jsonBufferBytes = 4096;
     size_t binaryBufferBytes = 1024 * 3; //Per the Wizard, frame previews could have up to 1024 pixels * 3 bytes
+    //Also sizes the pool reply handlers are constructed in, so requests never allocate
     size_t replyQueueSize = 100;
     size_t maxResponseWaitMs = 5000;
     size_t maxInboundCheckMs = 300;
     size_t textReadBufferBytes = 128;
+    //Outbound JSON up to this size is serialized here and written to the socket at once, larger is streamed
+    size_t sendBufferBytes = 512;
+    //Text frames up to this size are read whole and parsed in place, larger ones are parsed off the socket
+    size_t textFrameBufferBytes = 4096;
+    //Playlists and pattern changes are decoded as they're read rather than parsed whole, strings in them longer than
+    //this are cut short
+    size_t streamTokenBytes = 128;
+    //Holds the filter inbound text is parsed through, if the pending handlers' filters don't fit it's not used
+    size_t jsonFilterBytes = 1536;
     size_t syncPollWaitMs = 5;
     size_t expanderChannelLimit = 64;
     size_t controlLimit = 25;
@@ -326,14 +360,62 @@ struct ClientConfig {
     size_t maxConnRepairMs = 300;
     size_t connRepairRetryDelayMs = 50;
     size_t sendPingEveryMs = 3000;
+    //Unsaved brightness, brightness limit and control sets within this long of the last send of the same setting are
+    //held, and only the latest is sent once the window has passed. 0 sends every call.
+    size_t setterCoalesceWindowMs = 0;
+    //Holds setter changes between beginBatch() and commitBatch()
+    size_t batchJsonBytes = 512;
+    //Brightness and control values are written with at most this many decimals, 0 leaves them to ArduinoJson
+    uint8_t setterFloatDecimals = 4;
+    //Deliver only the newest preview frame read by each checkForInbound() call, dropping the rest
+    bool coalescePreviewFrames = false;
+    //Publish preview frames to a triple buffer another thread can take from, see getPreviewFrameExchange()
+    bool previewFrameHandoff = false;
+    //Diff each preview frame against the last, dropping unchanged ones and dispatching handlePreviewChange()
+    bool previewChangeDetection = false;
+    //Dirty runs at most this many unchanged pixels apart are reported as one range
+    size_t previewMergeGapPixels = 4;
+    size_t previewMaxDirtyRanges = 32;
 };
 
-class CloseableStream : public Stream {
+/**
+ * A stream over memory, which can lend out its unread bytes and free space directly rather than copying them through
+ * read() and write()
+ */
+class BorrowableStream {
 public:
+    virtual ~BorrowableStream() = default;
+
+    /**
+     * @param len set to how many unread bytes are returned, 0 if there are none
+     * @return the next unread bytes, valid until the stream is next used. Nothing is consumed until consumeRead().
+     */
+    virtual const uint8_t *borrowRead(size_t &len) = 0;
+
+    virtual void consumeRead(size_t len) = 0;
+
+    /**
+     * @param len set to how many bytes can be written, 0 if the stream is full
+     * @return space for the next bytes written, valid until the stream is next used. Nothing written there is kept
+     *         until commitWrite().
+     */
+    virtual uint8_t *borrowWrite(size_t &len) = 0;
+
+    virtual void commitWrite(size_t len) = 0;
+};
+
+class CloseableStream : public Stream, public BorrowableStream {
+public:
+    /**
+     * @param borrowable the same stream as wrapped if it can lend out its memory, see BorrowableStream
+     */
     explicit CloseableStream(Stream *wrapped,
                              size_t (*bulk)(Stream *, const uint8_t *, size_t) = nullptr,
-                             void (*closer)(Stream *) = nullptr
-    ) : wrapped(wrapped), closer(closer), bulk(bulk) {}
+                             void (*closer)(Stream *) = nullptr,
+                             BorrowableStream *borrowable = nullptr
+    ) : wrapped(wrapped), closer(closer), bulk(bulk), borrowable(borrowable) {}
+
+    using Stream::readBytes;
 
     size_t write(uint8_t v) override {
         return wrapped->write(v);
@@ -343,16 +425,7 @@ public:
         if (bulk) {
             return bulk(wrapped, buffer, size);
         } else if (buffer) {
-            size_t idx = 0;
-            while (idx < size) {
-                if (write(buffer[idx])) {
-                    idx++;
-                } else {
-                    break;
-                }
-            }
-
-            return idx;
+            return wrapped->write(buffer, size);
         } else if (size == 0) {
             return 0;
         } else {
@@ -368,10 +441,57 @@ public:
         return wrapped->read();
     }
 
+    size_t readBytes(char *buffer, size_t length) override {
+        return wrapped->readBytes(buffer, length);
+    }
+
     int peek() override {
         return wrapped->peek();
     }
 
+    /**
+     * Lends nothing if the wrapped stream isn't borrowable, callers fall back to read()
+     */
+    const uint8_t *borrowRead(size_t &len) override {
+        if (!borrowable) {
+            len = 0;
+            return nullptr;
+        }
+
+        return borrowable->borrowRead(len);
+    }
+
+    void consumeRead(size_t len) override {
+        if (borrowable) {
+            borrowable->consumeRead(len);
+        }
+    }
+
+    /**
+     * Lends nothing if the wrapped stream isn't borrowable, callers fall back to write()
+     */
+    uint8_t *borrowWrite(size_t &len) override {
+        if (!borrowable) {
+            len = 0;
+            return nullptr;
+        }
+
+        return borrowable->borrowWrite(len);
+    }
+
+    void commitWrite(size_t len) override {
+        if (borrowable) {
+            borrowable->commitWrite(len);
+        }
+    }
+
+    /**
+     * Read up to and including delim, keeping as much of what comes before it as fits in out, null terminated
+     *
+     * @return delim, or -1 if the stream ended first
+     */
+    int readUntil(uint8_t delim, char *out, size_t outLen);
+
     virtual ~CloseableStream() {
         if (closer) {
             closer(wrapped);
@@ -394,6 +514,8 @@ private:
     size_t (*bulk)(Stream *, const uint8_t *, size_t);
 
     void (*closer)(Stream *);
+
+    BorrowableStream *borrowable;
 };
 
 /**
@@ -461,6 +583,24 @@ public:
  */
 class PixelblazeWatcher {
 public:
+    /**
+     * Which of the handlers below this watcher actually implements, as a bitwise-OR'd combination of:
+     *   (int) WatchedEvent::Stats
+     *   (int) WatchedEvent::PatternChange
+     *   (int) WatchedEvent::PreviewFrame
+     *   (int) WatchedEvent::PlaylistChange
+     *   (int) WatchedEvent::PreviewChange
+     *
+     * Messages only needed for events nobody watches are dropped without being parsed, or for preview frames
+     * without being read, and fields only they need are filtered out of everything else. The default claims
+     * everything, override it to return only what your subclass handles.
+     */
+    virtual int watchedEvents() {
+        return (int) WatchedEvent::Stats | (int) WatchedEvent::PatternChange
+               | (int) WatchedEvent::PreviewFrame | (int) WatchedEvent::PlaylistChange
+               | (int) WatchedEvent::PreviewChange;
+    }
+
     /**
      * Pixelblaze sends a stats packet once per second, all included info is repackaged into the provided struct.
      */
@@ -484,6 +624,15 @@ public:
      */
     virtual void handlePreviewFrame(uint8_t *previewPixelRGB, size_t len) {};
 
+    /**
+     * Only dispatched with clientConfig.previewChangeDetection set and WatchedEvent::PreviewChange watched, which is
+     * enough on its own to have preview frames read. Comes right after handlePreviewFrame() if that's watched too, and
+     * only for frames that differ from the one before. Unchanged frames reach neither handler.
+     *
+     * @param diff the frame, which pixel ranges changed, and writeDelta() to encode just those
+     */
+    virtual void handlePreviewChange(const PreviewFrameDiffer &diff) {};
+
     /**
      * TODO: Currently not dispatched
      *
@@ -493,4 +642,27 @@ public:
     virtual void handlePlaylistChange(PlaylistUpdate &playlistUpdate) {};
 };
 
+/**
+ * Sees every inbound websocket message whole, as checkForInbound() reads it, so a session can be captured on a device
+ * or gateway and replayed later. Bytes the client has no use for are still read through to the observer.
+ */
+class InboundObserver {
+public:
+    virtual ~InboundObserver() = default;
+
+    /**
+     * @param messageType the websocket message type, as from WebSocketClient::messageType()
+     * @param atMs millis() when the message was taken off the socket
+     * @param len the message's length, its bytes follow through onInboundBytes()
+     */
+    virtual void onInboundStart(int messageType, uint32_t atMs, size_t len) = 0;
+
+    /**
+     * Bytes of the current message in order, valid only for the duration of the call
+     */
+    virtual void onInboundBytes(const uint8_t *bytes, size_t len) = 0;
+
+    virtual void onInboundEnd() {};
+};
+
 #endif
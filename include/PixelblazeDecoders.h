@@ -0,0 +1,40 @@
+#ifndef PixelblazeDecoders_h
+#define PixelblazeDecoders_h
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "PixelblazeCommon.h"
+
+/**
+ * 32 bit FNV-1a of a null terminated key. It's constexpr so known keys can be switch cases: two keys of one schema
+ * hashing alike is a duplicate case and fails the build, so every switch over these is a perfect hash of its keys.
+ * Keys outside the schema can still land on a case, so a match is always confirmed with strcmp().
+ */
+constexpr uint32_t fieldHash(const char *key, uint32_t hash = 2166136261u) {
+    return *key ? fieldHash(key + 1, (hash ^ (uint8_t) *key) * 16777619u) : hash;
+}
+
+/*
+ * Decoders for the messages the client reads most. Each walks its object's members once, switching on the key's hash,
+ * where looking every field up by name scans the object once per field. Fields missing from the message are left at
+ * their defaults.
+ */
+
+/**
+ * Decode the reply to getConfig
+ */
+void decodeSettings(JsonObject obj, Settings &settings);
+
+/**
+ * Decode a stats message, sent by the Pixelblaze about once a second
+ */
+void decodeStats(JsonObject obj, Stats &stats);
+
+/**
+ * Decode a pattern change, also sent as part of the reply to getConfig. state.controls must have room for controlLimit
+ * controls, any past that are dropped.
+ */
+void decodeSequencerState(JsonObject obj, SequencerState &state, size_t controlLimit);
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef PixelblazeFloatFormat_h
+#define PixelblazeFloatFormat_h
+
+#include <Arduino.h>
+#include <math.h>
+
+//Past this many decimals the scaled value stops fitting comfortably in 64 bits
+#define FIXED_FLOAT_MAX_DECIMALS 9
+
+/**
+ * Write value as plain decimal text with at most the given number of digits after the point, rounded half away from
+ * zero and with trailing zeros dropped, so 0.5f is "0.5" and 0.123456f at 4 decimals is "0.1235". It's a handful of
+ * integer operations with no allocation, where general purpose float formatting works out the shortest exact digits.
+ *
+ * @param out receives the text, not null terminated
+ * @param outLen space in out, 24 bytes is always enough
+ * @param decimals clamped to FIXED_FLOAT_MAX_DECIMALS
+ * @return bytes written, or 0 if value is NaN, infinite, too large to scale, or out is too small
+ */
+inline size_t formatFixedFloat(char *out, size_t outLen, float value, uint8_t decimals) {
+    if (decimals > FIXED_FLOAT_MAX_DECIMALS) {
+        decimals = FIXED_FLOAT_MAX_DECIMALS;
+    }
+
+    uint64_t scale = 1;
+    for (uint8_t idx = 0; idx < decimals; idx++) {
+        scale *= 10;
+    }
+
+    double magnitude = fabs((double) value);
+    if (!(magnitude < 1e9)) {
+        //Also catches NaN
+        return 0;
+    }
+
+    uint64_t scaled = (uint64_t) (magnitude * (double) scale + 0.5);
+    uint64_t whole = scaled / scale;
+    uint64_t frac = scaled % scale;
+
+    //Worst case: sign, 10 whole digits, point, 9 decimals
+    char text[24];
+    size_t len = 0;
+    if (value < 0 && scaled > 0) {
+        text[len++] = '-';
+    }
+
+    char digits[10];
+    size_t numDigits = 0;
+    do {
+        digits[numDigits++] = (char) ('0' + whole % 10);
+        whole /= 10;
+    } while (whole > 0);
+    while (numDigits > 0) {
+        text[len++] = digits[--numDigits];
+    }
+
+    if (frac > 0) {
+        //Drop trailing zeros, then write what's left zero padded to its place
+        uint8_t places = decimals;
+        while (frac % 10 == 0) {
+            frac /= 10;
+            places--;
+        }
+
+        text[len++] = '.';
+        for (uint8_t idx = places; idx > 0; idx--) {
+            text[len + idx - 1] = (char) ('0' + frac % 10);
+            frac /= 10;
+        }
+        len += places;
+    }
+
+    if (len > outLen) {
+        return 0;
+    }
+
+    memcpy(out, text, len);
+    return len;
+}
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef PixelblazeHandlerPool_h
+#define PixelblazeHandlerPool_h
+
+#include <new>
+#include <stddef.h>
+#include <type_traits>
+#include <utility>
+
+#include <Arduino.h>
+
+#include "PixelblazeHandlers.h"
+
+//Room for a RawTextHandler or RawBinaryHandler subclass passed to rawRequest(), raise it if yours don't fit
+#ifndef RAW_HANDLER_MAX_BYTES
+#define RAW_HANDLER_MAX_BYTES 96
+#endif
+
+//Handlers a single request can construct before they're enqueued, getSystemState() builds three
+#define MAX_HANDLERS_PER_REQUEST 3
+
+template<typename T>
+constexpr size_t maxHandlerBytes(T first) {
+    return first;
+}
+
+template<typename T, typename... Rest>
+constexpr size_t maxHandlerBytes(T first, Rest... rest) {
+    return first > maxHandlerBytes(rest...) ? first : maxHandlerBytes(rest...);
+}
+
+/**
+ * Bytes in one pool slot, enough for any handler the client builds itself or a raw handler of RAW_HANDLER_MAX_BYTES
+ */
+static constexpr size_t REPLY_HANDLER_SLOT_BYTES = maxHandlerBytes(
+        sizeof(AllPatternsReplyHandler), sizeof(PlaylistReplyHandler), sizeof(PeersReplyHandler),
+        sizeof(PreviewImageReplyHandler), sizeof(SettingsReplyHandler), sizeof(SequencerReplyHandler),
+        sizeof(ExpanderChannelsReplyHandler), sizeof(PingReplyHandler), sizeof(PatternControlReplyHandler),
+        sizeof(SyncHandler), (size_t) RAW_HANDLER_MAX_BYTES);
+
+/**
+ * Fixed slab of handler-sized slots that reply handlers are constructed into in place, so issuing a request and
+ * dispatching its reply never touch the heap. The slab is allocated once, when the client is constructed.
+ *
+ * Free slots are chained through their own first bytes, so acquiring and releasing are both O(1).
+ */
+class ReplyHandlerPool {
+public:
+    explicit ReplyHandlerPool(size_t numSlots);
+
+    ~ReplyHandlerPool();
+
+    ReplyHandlerPool(const ReplyHandlerPool &) = delete;
+
+    ReplyHandlerPool &operator=(const ReplyHandlerPool &) = delete;
+
+    /**
+     * Construct a handler in a free slot
+     *
+     * @return the handler, or nullptr if every slot is in use
+     */
+    template<class Handler, class... Args>
+    Handler *make(Args &&... args) {
+        static_assert(sizeof(Handler) <= REPLY_HANDLER_SLOT_BYTES,
+                      "Handler doesn't fit a pool slot, define RAW_HANDLER_MAX_BYTES to at least its size");
+        static_assert(alignof(Handler) <= alignof(HandlerSlot), "Handler is over-aligned for a pool slot");
+
+        void *slot = acquire();
+        if (!slot) {
+            return nullptr;
+        }
+
+        return new(slot) Handler(std::forward<Args>(args)...);
+    }
+
+    /**
+     * Destroy a handler made by make() and return its slot, along with the slot of the handler it wraps if it's a
+     * SyncHandler. Null is ignored.
+     */
+    void release(ReplyHandler *handler);
+
+    size_t available() const {
+        return freeSlots;
+    }
+
+    size_t capacity() const {
+        return numSlots;
+    }
+
+    /**
+     * @return how many times make() has found the pool empty
+     */
+    uint32_t getExhaustedCount() const {
+        return exhausted;
+    }
+
+private:
+    union HandlerSlot {
+        HandlerSlot *nextFree;
+        alignas(alignof(max_align_t)) uint8_t bytes[REPLY_HANDLER_SLOT_BYTES];
+    };
+
+    void *acquire();
+
+    HandlerSlot *slots;
+    size_t numSlots;
+    HandlerSlot *freeList = nullptr;
+    size_t freeSlots = 0;
+    uint32_t exhausted = 0;
+};
+
+#endif
@@ -11,6 +11,32 @@
 
 static String GARBAGE = "GARBAGE";
 
+/**
+ * Top level keys of a getConfig settings reply that are copied into Settings
+ */
+static const char *const SETTINGS_KEYS[] = {
+        "name", "brandName", "pixelCount", "brightness", "maxBrightness", "colorOrder", "dataSpeedHz", "ledType",
+        "sequenceTimer", "transitionDuration", "sequencerMode", "runSequencer", "simpleUiMode", "learningUiMode",
+        "discoveryEnable", "timezone", "autoOffEnable", "autoOffStart", "autoOffEnd", "cpuSpeed",
+        "networkPowerSave", "mapperFit", "leaderId", "nodeId", "soundSrc", "accelSrc", "lightSrc", "analogSrc",
+        "exp", "ver", "chipId"
+};
+
+/**
+ * Sequencer state arrives both as a getConfig reply and unprompted on pattern change, both are parsed the same way.
+ */
+inline void addSequencerStateFilter(JsonDocument &filter) {
+    filter["activeProgram"]["name"] = true;
+    filter["activeProgram"]["activeProgramId"] = true;
+    filter["activeProgram"]["controls"] = true;
+    filter["sequencerMode"] = true;
+    filter["runSequencer"] = true;
+    filter["playlist"]["position"] = true;
+    filter["playlist"]["id"] = true;
+    filter["playlist"]["ms"] = true;
+    filter["playlist"]["remainingMs"] = true;
+}
+
 /*
   Base class for all objects which signify a command waiting for a response. Library users should never see this name
 */
@@ -34,6 +60,17 @@ public:
 
     virtual void reportFailure(FailureCause cause) {}
 
+    /**
+     * Mark the fields this handler reads from its reply, including any it matches on, in an ArduinoJson filter
+     * document. Inbound text is parsed through the union of the filters of every pending handler, so fields nobody
+     * reads never take up space in the client's JsonDocument.
+     *
+     * @return false if the handler can't say what it needs, which turns filtering off while it's pending
+     */
+    virtual bool addJsonFilter(JsonDocument &filter) {
+        return true;
+    }
+
     virtual bool isSatisfied() {
         return satisfied;
     }
@@ -44,6 +81,19 @@ public:
 
     unsigned long requestTsMs;
     bool satisfied;
+
+    //How long to wait for the reply before failing with FailureCause::TimedOut, 0 for clientConfig.maxResponseWaitMs
+    uint32_t timeoutMs = 0;
+    //Set from requestTsMs and the timeout in effect when the handler is enqueued
+    uint32_t deadlineMs = 0;
+    //Position in the client's ReplyTimeouts heap
+    size_t heapIdx = 0;
+
+    //Links in the client's pending list for this handler's ReplyHandlerType, oldest to newest
+    ReplyHandler *older = nullptr;
+    ReplyHandler *newer = nullptr;
+    //Enqueue order across every type, so the oldest of several handlers that could take a reply gets it
+    uint32_t replySeq = 0;
 };
 
 /*
@@ -57,9 +107,8 @@ public:
         trueWhenFinished = _trueWhenFinished;
     }
 
-    ~SyncHandler() override {
-        delete wrappedHandler;
-    }
+    //The wrapped handler is released along with this one by ReplyHandlerPool::release()
+    ~SyncHandler() override = default;
 
     ReplyHandler *getWrapped() const {
         return wrappedHandler;
@@ -77,6 +126,10 @@ public:
         return wrappedHandler->jsonMatches(json);
     }
 
+    bool addJsonFilter(JsonDocument &filter) override {
+        return wrappedHandler->addJsonFilter(filter);
+    }
+
     ReplyHandler *wrappedHandler;
 private:
     bool *trueWhenFinished;
@@ -163,6 +216,11 @@ public:
 
     virtual void handle(JsonDocument &json) {};
     //Implementations must also include 'bool jsonMatches(json)';
+
+    //Raw replies are opaque, so by default they're parsed whole. Override if the interesting fields are known.
+    bool addJsonFilter(JsonDocument &filter) override {
+        return false;
+    }
 };
 
 struct PatternIdentifiers {
@@ -230,6 +288,16 @@ public:
         return json.containsKey("playlist") && json["playlist"].containsKey("position");
     }
 
+    bool addJsonFilter(JsonDocument &filter) override {
+        filter["playlist"]["id"] = true;
+        filter["playlist"]["position"] = true;
+        filter["playlist"]["ms"] = true;
+        filter["playlist"]["remainingMs"] = true;
+        filter["playlist"]["items"][0]["id"] = true;
+        filter["playlist"]["items"][0]["ms"] = true;
+        return true;
+    }
+
 private:
     void (*handlerFn)(Playlist &);
 
@@ -255,6 +323,17 @@ public:
         return json.containsKey("peers");
     }
 
+    bool addJsonFilter(JsonDocument &filter) override {
+        filter["peers"][0]["id"] = true;
+        filter["peers"][0]["address"] = true;
+        filter["peers"][0]["name"] = true;
+        filter["peers"][0]["ver"] = true;
+        filter["peers"][0]["isFollowing"] = true;
+        filter["peers"][0]["nodeId"] = true;
+        filter["peers"][0]["followerCount"] = true;
+        return true;
+    }
+
 private:
     void (*handlerFn)(Peer *, size_t);
 
@@ -300,6 +379,13 @@ public:
         return json.containsKey("pixelCount");
     }
 
+    bool addJsonFilter(JsonDocument &filter) override {
+        for (const char *key: SETTINGS_KEYS) {
+            filter[key] = true;
+        }
+        return true;
+    }
+
     void reportFailure(FailureCause cause) override {
         onError(cause);
     }
@@ -325,6 +411,11 @@ public:
         return json.containsKey("activeProgram");
     }
 
+    bool addJsonFilter(JsonDocument &filter) override {
+        addSequencerStateFilter(filter);
+        return true;
+    }
+
     void reportFailure(FailureCause cause) override {
         onError(cause);
     }
@@ -381,6 +472,11 @@ public:
         return json.containsKey("ack");  //Lots of commands return this, nothing really to do about it
     }
 
+    bool addJsonFilter(JsonDocument &filter) override {
+        filter["ack"] = true;
+        return true;
+    }
+
     void reportFailure(FailureCause cause) override {
         onError(cause);
     }
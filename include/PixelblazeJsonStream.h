@@ -0,0 +1,246 @@
+#ifndef PixelblazeJsonStream_h
+#define PixelblazeJsonStream_h
+
+#include <Arduino.h>
+
+#include "PixelblazeCommon.h"
+
+//Containers nested deeper than this fail the parse, nothing the Pixelblaze sends comes close
+#define JSON_STREAM_MAX_DEPTH 16
+
+enum class JsonEvent : uint8_t {
+    ObjectStart,
+    ObjectEnd,
+    ArrayStart,
+    ArrayEnd,
+    Key,
+    String,
+    Number,
+    True,
+    False,
+    Null,
+};
+
+/**
+ * Receives the events of a JsonStreamTokenizer as it works through a message
+ */
+class JsonStreamListener {
+public:
+    virtual ~JsonStreamListener() = default;
+
+    /**
+     * @param depth containers around the event: members of the top level object are at 1, and the top level object's
+     *        own ObjectStart and ObjectEnd at 0
+     * @param text for Key, String and Number, the null terminated token, cut short at the tokenizer's tokenBytes.
+     *        Only valid during the call.
+     */
+    virtual void onJsonEvent(JsonEvent event, uint8_t depth, const char *text, size_t len) = 0;
+};
+
+/**
+ * Incremental JSON tokenizer. Bytes are fed in whatever chunks they arrive in and events are raised as soon as each
+ * token is complete, so the only memory a message needs is one token's worth, however long the message is.
+ *
+ * Strings and numbers longer than tokenBytes - 1 are truncated and counted in getTruncatedTokens(), the parse itself
+ * carries on.
+ */
+class JsonStreamTokenizer {
+public:
+    explicit JsonStreamTokenizer(size_t tokenBytes);
+
+    ~JsonStreamTokenizer();
+
+    JsonStreamTokenizer(const JsonStreamTokenizer &) = delete;
+
+    JsonStreamTokenizer &operator=(const JsonStreamTokenizer &) = delete;
+
+    /**
+     * Get ready for a new message
+     */
+    void reset();
+
+    /**
+     * Tokenize the next chunk of the message
+     *
+     * @return false if the message isn't valid JSON, after which further feeds are ignored until reset()
+     */
+    bool feed(const char *bytes, size_t len, JsonStreamListener &listener);
+
+    /**
+     * @return true once a whole top level value has been read
+     */
+    bool isComplete() const {
+        return state == State::Done;
+    }
+
+    size_t getTruncatedTokens() const {
+        return truncatedTokens;
+    }
+
+private:
+    enum class State : uint8_t {
+        Value,
+        ValueOrArrayEnd,
+        Key,
+        KeyOrObjectEnd,
+        Colon,
+        CommaOrEnd,
+        String,
+        StringEscape,
+        StringUnicode,
+        Number,
+        Literal,
+        Done,
+        Failed,
+    };
+
+    bool structural(char c, JsonStreamListener &listener);
+
+    bool push(bool isObject);
+
+    void afterValue();
+
+    void startToken(State tokenState);
+
+    void append(char c);
+
+    void appendCodepoint(uint32_t codepoint);
+
+    void emitToken(JsonEvent event, JsonStreamListener &listener);
+
+    bool inObject() const {
+        return depth > 0 && (objectBits >> (depth - 1)) & 1;
+    }
+
+    char *token;
+    size_t tokenBytes;
+    size_t tokenLen = 0;
+    bool tokenTruncated = false;
+    size_t truncatedTokens = 0;
+
+    State state = State::Value;
+    uint8_t depth = 0;
+    //Bit n is set if the container at depth n + 1 is an object
+    uint32_t objectBits = 0;
+    bool stringIsKey = false;
+
+    const char *literal = nullptr;
+    uint8_t literalIdx = 0;
+    JsonEvent literalEvent = JsonEvent::Null;
+
+    uint16_t unicode = 0;
+    uint8_t unicodeDigits = 0;
+    uint16_t highSurrogate = 0;
+};
+
+/**
+ * Fills a Playlist from a getPlaylist reply as it's tokenized. Items past itemLimit are counted but not stored.
+ */
+class PlaylistStreamDecoder : public JsonStreamListener {
+public:
+    PlaylistStreamDecoder(Playlist &playlist, size_t itemLimit);
+
+    void onJsonEvent(JsonEvent event, uint8_t depth, const char *text, size_t len) override;
+
+    /**
+     * @return true if the message had a playlist position, which only replies to getPlaylist do
+     */
+    bool sawPosition() const {
+        return positionSeen;
+    }
+
+    size_t getDroppedItems() const {
+        return droppedItems;
+    }
+
+private:
+    enum class Field : uint8_t {
+        Other,
+        Id,
+        Position,
+        Ms,
+        RemainingMs,
+        Items,
+    };
+
+    Playlist &playlist;
+    size_t itemLimit;
+    bool inPlaylist = false;
+    Field field = Field::Other;
+    Field itemField = Field::Other;
+    PlaylistItem *item = nullptr;
+    bool positionSeen = false;
+    size_t droppedItems = 0;
+};
+
+/**
+ * Fills a SequencerState from a pattern change, or the part of a getConfig reply carrying one, as it's tokenized.
+ * state.controls must have room for controlLimit controls, any past that are counted but not stored.
+ */
+class SequencerStreamDecoder : public JsonStreamListener {
+public:
+    SequencerStreamDecoder(SequencerState &state, size_t controlLimit);
+
+    void onJsonEvent(JsonEvent event, uint8_t depth, const char *text, size_t len) override;
+
+    size_t getDroppedControls() const {
+        return droppedControls;
+    }
+
+private:
+    enum class Field : uint8_t {
+        Other,
+        ActiveProgram,
+        SequencerMode,
+        RunSequencer,
+        Playlist,
+        Name,
+        ActiveProgramId,
+        Controls,
+        Position,
+        Id,
+        Ms,
+        RemainingMs,
+    };
+
+    SequencerState &state;
+    size_t controlLimit;
+    Field topField = Field::Other;
+    Field field = Field::Other;
+    Control *control = nullptr;
+    size_t droppedControls = 0;
+};
+
+/**
+ * Reads bytes already taken off a stream, then the rest of the stream, so a message can be classified from its first
+ * bytes and still be parsed whole
+ */
+class PrefixedStream : public Stream {
+public:
+    PrefixedStream(const char *prefix, size_t prefixLen, Stream &rest)
+            : prefix(prefix), prefixLen(prefixLen), rest(rest) {};
+
+    int available() override {
+        return (int) (prefixLen - prefixIdx) + rest.available();
+    }
+
+    int read() override {
+        return prefixIdx < prefixLen ? (uint8_t) prefix[prefixIdx++] : rest.read();
+    }
+
+    int peek() override {
+        return prefixIdx < prefixLen ? (uint8_t) prefix[prefixIdx] : rest.peek();
+    }
+
+    size_t write(uint8_t c) override {
+        return 0;
+    }
+
+private:
+    const char *prefix;
+    size_t prefixLen;
+    size_t prefixIdx = 0;
+    Stream &rest;
+};
+
+#endif
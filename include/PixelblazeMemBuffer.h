@@ -9,11 +9,13 @@ struct NamedBuffer {
     size_t used;
 };
 
-class BufferStream : public Stream {
+class BufferStream : public Stream, public BorrowableStream {
 public:
     BufferStream(NamedBuffer *buff, size_t buffLen, size_t writeIdx, size_t readIdx, bool readable)
             : buff(buff), buffLen(buffLen), writeIdx(writeIdx), readIdx(readIdx), readable(readable) {}
 
+    using Stream::readBytes;
+
     size_t write(uint8_t uint8) override {
         if (readable) {
             return 0;
@@ -24,11 +26,24 @@ public:
         }
 
         buff->buffer[writeIdx] = uint8;
-        buff->used++;
         writeIdx++;
+        buff->used = writeIdx;
         return 1;
     }
 
+    size_t write(const uint8_t *buffer, size_t size) override {
+        size_t space;
+        uint8_t *dest = borrowWrite(space);
+        if (!dest) {
+            return 0;
+        }
+
+        size_t toWrite = min(size, space);
+        memcpy(dest, buffer, toWrite);
+        commitWrite(toWrite);
+        return toWrite;
+    }
+
     int available() override {
         if (readable) {
             return writeIdx - readIdx;
@@ -51,6 +66,19 @@ public:
         }
     }
 
+    size_t readBytes(char *buffer, size_t length) override {
+        size_t unread;
+        const uint8_t *src = borrowRead(unread);
+        if (!src) {
+            return 0;
+        }
+
+        size_t toRead = min(length, unread);
+        memcpy(buffer, src, toRead);
+        consumeRead(toRead);
+        return toRead;
+    }
+
     int peek() override {
         if (readable) {
             if (readIdx >= buffLen || writeIdx <= readIdx) {
@@ -63,6 +91,25 @@ public:
         }
     }
 
+    const uint8_t *borrowRead(size_t &len) override {
+        len = readable && writeIdx > readIdx ? writeIdx - readIdx : 0;
+        return len > 0 ? buff->buffer + readIdx : nullptr;
+    }
+
+    void consumeRead(size_t len) override {
+        readIdx += len;
+    }
+
+    uint8_t *borrowWrite(size_t &len) override {
+        len = !readable && buffLen > writeIdx ? buffLen - writeIdx : 0;
+        return len > 0 ? buff->buffer + writeIdx : nullptr;
+    }
+
+    void commitWrite(size_t len) override {
+        writeIdx += len;
+        buff->used = writeIdx;
+    }
+
     virtual ~BufferStream() {
         //We don't own buff
     }
@@ -89,26 +136,28 @@ public:
         //If any of our CloseableStreams are in the world, they're about to get hosed.
 
         for (size_t idx = 0; idx < allocated; idx++) {
-            delete[] buffers[idx];
+            delete[] buffers[idx]->buffer;
+            delete buffers[idx];
         }
+
+        delete[] buffers;
     }
 
 private:
+    static CloseableStream *wrap(BufferStream *stream) {
+        return new CloseableStream(stream, nullptr, nullptr, stream);
+    }
+
     CloseableStream *makeWriteStream(String &key, bool append) override {
         int buffIdx = 0;
         int emptyIdx = -1;
         while (buffIdx < allocated) {
             NamedBuffer *thisBuffer = buffers[buffIdx];
             if (key.equals(thisBuffer->name)) {
-                if (append) {
-                    return new CloseableStream(
-                            new BufferStream(thisBuffer, buffBytes, thisBuffer->used, 0, false)
-                    );
-                } else {
-                    return new CloseableStream(
-                            new BufferStream(thisBuffer, buffBytes, 0, 0, false)
-                    );
+                if (!append) {
+                    thisBuffer->used = 0;
                 }
+                return wrap(new BufferStream(thisBuffer, buffBytes, thisBuffer->used, 0, false));
             } else if (!thisBuffer->name.length() && emptyIdx < 0) {
                 emptyIdx = buffIdx;
             }
@@ -120,9 +169,7 @@ private:
             NamedBuffer *thisBuffer = buffers[emptyIdx];
             thisBuffer->name = key;
 
-            return new CloseableStream(
-                    new BufferStream(thisBuffer, buffBytes, 0, 0, false)
-            );
+            return wrap(new BufferStream(thisBuffer, buffBytes, 0, 0, false));
         }
 
         if (buffIdx >= numBuffers) {
@@ -132,9 +179,7 @@ private:
         buffers[buffIdx] = new NamedBuffer{key, new uint8_t[buffBytes], 0};
         allocated++;
 
-        return new CloseableStream(
-                new BufferStream(buffers[buffIdx], buffBytes, 0, 0, false)
-        );
+        return wrap(new BufferStream(buffers[buffIdx], buffBytes, 0, 0, false));
     };
 
     CloseableStream *makeReadStream(String &key) override {
@@ -142,9 +187,7 @@ private:
         while (buffIdx < allocated) {
             NamedBuffer *thisBuffer = buffers[buffIdx];
             if (key.equals(thisBuffer->name)) {
-                return new CloseableStream(
-                        new BufferStream(thisBuffer, buffBytes, thisBuffer->used, 0, true)
-                );
+                return wrap(new BufferStream(thisBuffer, buffBytes, thisBuffer->used, 0, true));
             }
 
             buffIdx++;
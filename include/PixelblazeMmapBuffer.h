@@ -0,0 +1,164 @@
+#ifndef PixelblazeMmapBuffer_h
+#define PixelblazeMmapBuffer_h
+
+#include "PixelblazeClient.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+/**
+ * Buffers large binary reads in memory mapped segment files, for hosts with a filesystem and many clients sharing one
+ * buffer. Each buffer gets a segment file preallocated to segmentBytes and mapped read-write, doubling it as it's
+ * written past that. Read streams lend out the mapped bytes, so nothing is copied into the heap.
+ *
+ * Segment files on disk are kept to budgetBytes. Deleted buffers leave their segment behind to be reused by the next
+ * one. When a new buffer has no segment to take, makeWriteStream() fails and garbageCollect() evicts the least recently
+ * used buffer without open streams, which the client does before retrying. A buffer growing past the budget evicts the
+ * same way. Buffers are only evicted once they've been read back, one written to and not yet read may be a multipart
+ * reply still arriving between frames.
+ *
+ * The directory should be dedicated to one buffer, segment files in it are truncated, reused and removed freely.
+ */
+class PixelblazeMmapBuffer : public PixelblazeBuffer {
+public:
+    /**
+     * @param directory created if it doesn't exist, its parent has to
+     * @param segmentBytes starting size of each buffer's segment file
+     * @param budgetBytes most bytes of segment files on disk at once, at least one segment
+     */
+    explicit PixelblazeMmapBuffer(const char *directory, size_t segmentBytes = 65536, size_t budgetBytes = 4194304);
+
+    virtual ~PixelblazeMmapBuffer();
+
+    PixelblazeMmapBuffer(const PixelblazeMmapBuffer &) = delete;
+
+    PixelblazeMmapBuffer &operator=(const PixelblazeMmapBuffer &) = delete;
+
+    CloseableStream *makeWriteStream(String &key, bool append) override;
+
+    CloseableStream *makeReadStream(String &key) override;
+
+    void deleteStreamResults(String &key) override;
+
+    void garbageCollect() override;
+
+    size_t getDiskBytes() const {
+        return diskBytes;
+    }
+
+    size_t getBudgetBytes() const {
+        return budgetBytes;
+    }
+
+private:
+    friend class MmapStream;
+
+    struct Segment {
+        String name;
+        uint32_t hash = 0;
+        int fd = -1;
+        uint8_t *data = nullptr;
+        size_t capacity = 0;
+        size_t used = 0;
+        uint32_t lastUse = 0;
+        uint16_t openStreams = 0;
+        bool live = false;
+        //Written since it was last read, so possibly still being assembled
+        bool incomplete = false;
+    };
+
+    static uint32_t hashKey(String &key);
+
+    int findSegment(String &key, uint32_t hash) const;
+
+    /**
+     * Take a spare segment, or open a new one if the budget has room
+     *
+     * @return the segment's index, or -1 if there's neither
+     */
+    int claimSegment();
+
+    bool openSegment(size_t segmentIdx);
+
+    void releaseSegment(Segment &segment);
+
+    /**
+     * Change a segment file's size, and its mapping with it
+     */
+    bool resizeSegment(Segment &segment, size_t capacity);
+
+    /**
+     * Double a live segment, within the budget, releasing spares and evicting other buffers to make room
+     */
+    bool growSegment(Segment &segment);
+
+    /**
+     * Turn the least recently used live segment without open streams that's been read back, other than keep, into a
+     * spare
+     *
+     * @return its index, or -1 if every live segment is open or unread
+     */
+    int evictLeastRecentlyUsed(const Segment *keep);
+
+    CloseableStream *openStream(size_t segmentIdx, bool readable);
+
+    static void closeMmapStream(Stream *stream);
+
+    String root;
+    size_t segmentBytes;
+    size_t budgetBytes;
+    size_t diskBytes = 0;
+    uint32_t useClock = 0;
+
+    Segment *segments;
+    size_t maxSegments;
+};
+
+/**
+ * Reads or writes one segment of a PixelblazeMmapBuffer. Borrowing reads lends the whole rest of the buffer at once.
+ */
+class MmapStream : public Stream, public BorrowableStream {
+public:
+    MmapStream(PixelblazeMmapBuffer &owner, size_t segmentIdx, bool readable);
+
+    /**
+     * Stop counting against the segment, so it can be evicted. Called when the wrapping CloseableStream closes.
+     */
+    void close();
+
+    using Stream::readBytes;
+
+    size_t write(uint8_t v) override {
+        return write(&v, 1);
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) override;
+
+    int available() override {
+        return readable ? (int) (segment.used - readPos) : 0;
+    }
+
+    int read() override;
+
+    size_t readBytes(char *buffer, size_t length) override;
+
+    int peek() override;
+
+    const uint8_t *borrowRead(size_t &len) override;
+
+    void consumeRead(size_t len) override;
+
+    uint8_t *borrowWrite(size_t &len) override;
+
+    void commitWrite(size_t len) override;
+
+private:
+    PixelblazeMmapBuffer &owner;
+    PixelblazeMmapBuffer::Segment &segment;
+    bool readable;
+    size_t readPos = 0;
+    bool closed = false;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef PixelblazePreviewAnalytics_h
+#define PixelblazePreviewAnalytics_h
+
+#include <Arduino.h>
+
+//Must be a power of two no larger than 256, luminance is 8 bits
+#define PREVIEW_HISTOGRAM_BINS 32
+
+/**
+ * Implementations of the analytics kernel. SSSE3 and AVX2 only exist on x86 builds and are only used if the CPU
+ * running the code supports them.
+ */
+enum class PreviewKernel : uint8_t {
+    Auto = 0,
+    Scalar = 1,
+    SSSE3 = 2,
+    AVX2 = 3,
+};
+
+/**
+ * A contiguous run of pixels to average, filled in by analyzePreviewFrame()
+ */
+struct PreviewSegment {
+    size_t firstPixel;
+    size_t pixelCount;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+};
+
+struct PreviewFrameStats {
+    size_t pixelCount;
+    uint8_t avgRed;
+    uint8_t avgGreen;
+    uint8_t avgBlue;
+    uint8_t peakRed;
+    uint8_t peakGreen;
+    uint8_t peakBlue;
+    //Pixels per luminance range, luminance being (77r + 150g + 29b) / 256
+    uint32_t luminanceHistogram[PREVIEW_HISTOGRAM_BINS];
+};
+
+/**
+ * Compute summary statistics for a preview frame in one pass over it, for instance from
+ * PixelblazeWatcher::handlePreviewFrame(). Trailing bytes that don't make up a whole pixel are ignored.
+ *
+ * If segments are requested the frame is split into numSegments runs of near-equal length, and the mean color of each
+ * is written to the matching PreviewSegment.
+ *
+ * @param previewPixelRGB Packed RGB data, with the first pixel r = preview[0], g = preview[1], b = preview[2]
+ * @param len the length of the preview buffer in bytes
+ * @param stats filled in with whole-frame statistics
+ * @param segments numSegments structs to fill, or nullptr
+ * @param numSegments how many segments to split the frame into, ignored if segments is nullptr
+ * @param kernel implementation to use, Auto picks the fastest the CPU supports
+ * @return true if the frame was analyzed, false if the requested kernel isn't available here
+ */
+bool analyzePreviewFrame(const uint8_t *previewPixelRGB, size_t len, PreviewFrameStats &stats,
+                         PreviewSegment *segments = nullptr, size_t numSegments = 0,
+                         PreviewKernel kernel = PreviewKernel::Auto);
+
+/**
+ * @return true if analyzePreviewFrame() can run the given kernel on this build and CPU
+ */
+bool previewKernelAvailable(PreviewKernel kernel);
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef PixelblazePreviewDelta_h
+#define PixelblazePreviewDelta_h
+
+#include <Arduino.h>
+
+//Bytes ahead of each range's pixel data in a delta: first pixel and pixel count, both little endian uint16
+#define PREVIEW_DELTA_RANGE_HEADER_BYTES 4
+
+struct PixelRange {
+    size_t firstPixel;
+    size_t pixelCount;
+};
+
+/**
+ * Compares each preview frame with the one before it, tracking which runs of pixels changed. Consumers that mirror,
+ * relay or record frames can then touch only those pixels, or ship them as a compact delta with writeDelta().
+ *
+ * Dirty runs separated by mergeGapPixels or fewer unchanged pixels are reported as one range, and if a frame has more
+ * than maxRanges runs the last range grows to cover the rest. Either way ranges only ever over-report.
+ */
+class PreviewFrameDiffer {
+public:
+    explicit PreviewFrameDiffer(size_t frameBytes, size_t maxRanges = 32, size_t mergeGapPixels = 4);
+
+    ~PreviewFrameDiffer();
+
+    PreviewFrameDiffer(const PreviewFrameDiffer &) = delete;
+
+    PreviewFrameDiffer &operator=(const PreviewFrameDiffer &) = delete;
+
+    /**
+     * Diff a frame against the previous one and remember it for next time. The first frame, and any frame whose
+     * length differs from the one before, is entirely dirty.
+     *
+     * @param previewPixelRGB Packed RGB data, with the first pixel r = preview[0], g = preview[1], b = preview[2]
+     * @param len the length of the preview buffer in bytes, anything past frameBytes is ignored
+     * @return true if any pixel changed
+     */
+    bool update(const uint8_t *previewPixelRGB, size_t len);
+
+    bool changed() const {
+        return numRanges > 0;
+    }
+
+    const PixelRange *dirtyRanges() const {
+        return ranges;
+    }
+
+    size_t dirtyRangeCount() const {
+        return numRanges;
+    }
+
+    size_t dirtyPixelCount() const;
+
+    /**
+     * The last frame passed to update()
+     */
+    const uint8_t *frame() const {
+        return previous;
+    }
+
+    size_t frameLen() const {
+        return previousLen;
+    }
+
+    /**
+     * @return bytes needed to hold the delta from the last update()
+     */
+    size_t deltaBytes() const {
+        return numRanges * PREVIEW_DELTA_RANGE_HEADER_BYTES + dirtyPixelCount() * 3;
+    }
+
+    /**
+     * Encode the pixels changed by the last update() as a sequence of ranges, each a PREVIEW_DELTA_RANGE_HEADER_BYTES
+     * header followed by pixelCount * 3 bytes of RGB.
+     *
+     * @return bytes written, 0 if nothing changed or out is smaller than deltaBytes()
+     */
+    size_t writeDelta(uint8_t *out, size_t outLen) const;
+
+    /**
+     * Apply a delta from writeDelta() to a copy of the frame it was diffed against.
+     *
+     * @return false if the delta is malformed or reaches past len, in which case frame may be partially updated
+     */
+    static bool applyDelta(uint8_t *previewPixelRGB, size_t len, const uint8_t *delta, size_t deltaLen);
+
+private:
+    void addRange(size_t firstPixel, size_t pixelCount);
+
+    uint8_t *previous;
+    size_t frameBytes;
+    size_t previousLen = 0;
+    bool havePrevious = false;
+
+    PixelRange *ranges;
+    size_t maxRanges;
+    size_t numRanges = 0;
+    size_t mergeGapPixels;
+};
+
+#endif
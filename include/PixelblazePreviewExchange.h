@@ -0,0 +1,102 @@
+#ifndef PixelblazePreviewExchange_h
+#define PixelblazePreviewExchange_h
+
+#include <atomic>
+
+#include <Arduino.h>
+
+struct PreviewFrameSlot {
+    uint8_t *pixels;
+    size_t len;
+    //Counts up from 1 with each published frame, gaps are frames the consumer never took
+    uint32_t frameNumber;
+};
+
+/**
+ * Hands preview frames from the thread running checkForInbound() to a single consumer on another core or thread
+ * without either side ever blocking or copying.
+ *
+ * This is a triple buffer: the producer owns one slot, the consumer owns one, and the third is swapped between them
+ * with a single atomic exchange. The newest published frame always wins, a consumer that falls behind skips straight
+ * to it. Exactly one thread may produce and exactly one may consume.
+ */
+class PreviewFrameExchange {
+public:
+    explicit PreviewFrameExchange(size_t frameBytes) : frameBytes(frameBytes) {
+        for (auto &slot: slots) {
+            slot.pixels = new uint8_t[frameBytes];
+            slot.len = 0;
+            slot.frameNumber = 0;
+        }
+    }
+
+    ~PreviewFrameExchange() {
+        for (auto &slot: slots) {
+            delete[] slot.pixels;
+        }
+    }
+
+    PreviewFrameExchange(const PreviewFrameExchange &) = delete;
+
+    PreviewFrameExchange &operator=(const PreviewFrameExchange &) = delete;
+
+    /**
+     * Consumer side. The returned slot stays untouched by the producer until the next call to takeLatest().
+     *
+     * @return the newest frame published since the last call, or nullptr if there hasn't been one
+     */
+    const PreviewFrameSlot *takeLatest() {
+        if (!(shared.load(std::memory_order_relaxed) & FRESH)) {
+            return nullptr;
+        }
+
+        front = shared.exchange(front, std::memory_order_acq_rel) & SLOT_MASK;
+        return &slots[front];
+    }
+
+    /**
+     * Consumer side, the frame returned by the last successful takeLatest() call.
+     *
+     * @return the frame the consumer currently holds, len 0 if it's never taken one
+     */
+    const PreviewFrameSlot *current() const {
+        return &slots[front];
+    }
+
+    /**
+     * Producer side, the buffer the next frame should be written into. Valid until publish() is called.
+     */
+    uint8_t *writeSlot() {
+        return slots[back].pixels;
+    }
+
+    size_t slotBytes() const {
+        return frameBytes;
+    }
+
+    /**
+     * Producer side, make the frame in writeSlot() the latest. Any frame published earlier and not yet taken is
+     * dropped.
+     *
+     * @param len bytes of the frame written into writeSlot()
+     */
+    void publish(size_t len) {
+        slots[back].len = len;
+        slots[back].frameNumber = ++published;
+        back = shared.exchange(back | FRESH, std::memory_order_acq_rel) & SLOT_MASK;
+    }
+
+private:
+    static const uint8_t SLOT_MASK = 0x03;
+    static const uint8_t FRESH = 0x04;
+
+    PreviewFrameSlot slots[3];
+    size_t frameBytes;
+
+    uint8_t back = 0;
+    std::atomic<uint8_t> shared{1};
+    uint8_t front = 2;
+    uint32_t published = 0;
+};
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef PixelblazeRecorder_h
+#define PixelblazeRecorder_h
+
+#include <Arduino.h>
+
+#include "PixelblazeCommon.h"
+#include "PixelblazePreviewDelta.h"
+
+/*
+ * Recording layout, all multi-byte fixed width values little endian:
+ *
+ *   header:  "PBRC", version byte, 3 reserved bytes
+ *   record:  type byte, varint ms since the previous record (the first: since boot), varint payload length, payload
+ *   trailer: an Index record, then its offset as a uint32 and "PBIX"
+ *
+ * Preview frames are KeyFrame or DeltaFrame records. Key frames carry the whole frame, delta frames only the pixel
+ * ranges that changed since the frame before; pixel data in both is run-length encoded. The index lists the time and
+ * offset of key frames, a recording that was never finish()ed has no trailer and readers rebuild it by scanning.
+ */
+#define RECORDING_HEADER_BYTES 8
+#define RECORDING_FOOTER_BYTES 8
+#define RECORDING_VERSION 1
+
+enum class RecordType : uint8_t {
+    KeyFrame = 1,
+    DeltaFrame = 2,
+    Stats = 3,
+    PatternChange = 4,
+    Index = 16,
+};
+
+struct RecorderConfig {
+    //Largest preview frame that will be recorded, Pixelblaze sends at most 1024 pixels
+    size_t frameBytes = 3072;
+    //A key frame is written, and indexed, at least this often so seeks never replay more than this much
+    uint32_t keyFrameEveryMs = 5000;
+    size_t maxDirtyRanges = 64;
+    size_t mergeGapPixels = 2;
+    //Initial capacity of the in-memory index, it grows as needed
+    size_t indexEntries = 256;
+};
+
+struct RecordingIndexEntry {
+    uint32_t timeMs;
+    uint32_t offset;
+};
+
+/**
+ * A watcher that appends timestamped preview frames, stats and pattern changes to a Print, such as an SD or SPIFFS
+ * File, in the compact format described above. Events are passed on to an optional downstream watcher, so it can sit
+ * between the client and the watcher an application already has.
+ *
+ * Preview frames identical to the one before aren't recorded. Call begin() before handing the recorder to the client,
+ * and finish() to write the seek index once recording is over.
+ */
+class PixelblazeRecorder : public PixelblazeWatcher {
+public:
+    explicit PixelblazeRecorder(Print &out, PixelblazeWatcher *downstream = nullptr,
+                                RecorderConfig config = RecorderConfig());
+
+    ~PixelblazeRecorder();
+
+    PixelblazeRecorder(const PixelblazeRecorder &) = delete;
+
+    PixelblazeRecorder &operator=(const PixelblazeRecorder &) = delete;
+
+    /**
+     * Write the file header.
+     *
+     * @return true if the header was written in full
+     */
+    bool begin();
+
+    /**
+     * Write the seek index and footer. Nothing more is recorded afterwards.
+     *
+     * @return true if the trailer was written in full
+     */
+    bool finish();
+
+    size_t bytesWritten() const {
+        return written;
+    }
+
+    /**
+     * @return records that couldn't be written in full, after the first failure the file can't be read past it
+     */
+    uint32_t failedWrites() const {
+        return writeFailures;
+    }
+
+    int watchedEvents() override;
+
+    void handleStats(Stats &stats) override;
+
+    void handlePatternChange(SequencerState &patternChange) override;
+
+    void handlePreviewFrame(uint8_t *previewPixelRGB, size_t len) override;
+
+    void handlePreviewChange(const PreviewFrameDiffer &diff) override;
+
+    void handlePlaylistChange(PlaylistUpdate &playlistUpdate) override;
+
+private:
+    /**
+     * @param timeMs when the record happened, from one millis() call shared with anything else about it
+     */
+    bool writeRecord(RecordType type, size_t payloadLen, uint32_t timeMs);
+
+    bool writeRecordHeader(RecordType type, size_t payloadLen, uint32_t timeMs);
+
+    bool writeBytes(const uint8_t *bytes, size_t len);
+
+    void addIndexEntry(uint32_t timeMs, uint32_t offset);
+
+    Print &out;
+    PixelblazeWatcher *downstream;
+    RecorderConfig config;
+    PreviewFrameDiffer differ;
+
+    uint8_t *payload;
+    size_t payloadBytes;
+
+    RecordingIndexEntry *index;
+    size_t indexCapacity;
+    size_t indexCount = 0;
+
+    size_t written = 0;
+    uint32_t writeFailures = 0;
+    uint32_t lastRecordMs = 0;
+    uint32_t lastKeyFrameMs = 0;
+    bool keyFrameWritten = false;
+    bool recording = false;
+};
+
+/**
+ * One event read back from a recording. Only the fields for its type are filled in, frame points into the reader and
+ * is valid until the next call to next() or seek().
+ */
+struct RecordedEvent {
+    RecordType type;
+    uint32_t timeMs;
+
+    const uint8_t *frame;
+    size_t frameLen;
+
+    Stats stats;
+
+    String activeProgramId;
+    String patternName;
+    int playlistPos;
+};
+
+/**
+ * Reads a recording from memory: a file mapped with open(path), or bytes loaded some other way. Key and delta frames
+ * are decoded into a frame buffer the reader owns, so every preview event comes back as a complete frame.
+ */
+class PixelblazeRecordingReader {
+public:
+    explicit PixelblazeRecordingReader(size_t frameBytes = 3072);
+
+    ~PixelblazeRecordingReader();
+
+    PixelblazeRecordingReader(const PixelblazeRecordingReader &) = delete;
+
+    PixelblazeRecordingReader &operator=(const PixelblazeRecordingReader &) = delete;
+
+    /**
+     * Read a recording already in memory, which must outlive the reader or the next open()
+     *
+     * @return false if it isn't a recording this version understands
+     */
+    bool open(const uint8_t *data, size_t len);
+
+#if defined(__unix__) || defined(__APPLE__)
+
+    /**
+     * Map a recording file read-only and read it in place
+     *
+     * @return false if the file can't be mapped or isn't a recording
+     */
+    bool open(const char *path);
+
+#endif
+
+    void close();
+
+    /**
+     * @param event filled in with the next event in the recording
+     * @return false at the end of the recording, or if the rest is truncated or corrupt
+     */
+    bool next(RecordedEvent &event);
+
+    /**
+     * Position the reader so next() returns the first event at or after timeMs. Jumps to the closest indexed key frame
+     * then decodes forward, so frames returned afterwards are complete.
+     *
+     * @return false if the recording has no key frame at or before timeMs
+     */
+    bool seek(uint32_t timeMs);
+
+    size_t indexEntryCount() const {
+        return indexCount;
+    }
+
+    const RecordingIndexEntry *indexEntries() const {
+        return index;
+    }
+
+private:
+    bool loadIndex();
+
+    bool rebuildIndex();
+
+    bool readHeader(size_t &pos, RecordType &type, uint32_t &timeMs, size_t &payloadLen) const;
+
+    bool decode(RecordType type, const uint8_t *payload, size_t payloadLen, RecordedEvent &event);
+
+    const uint8_t *data = nullptr;
+    size_t dataLen = 0;
+    size_t recordsEnd = 0;
+    size_t pos = 0;
+    uint32_t lastRecordMs = 0;
+
+    uint8_t *frame;
+    size_t frameBytes;
+    size_t frameLen = 0;
+
+    RecordingIndexEntry *index = nullptr;
+    size_t indexCount = 0;
+
+    void *mapped = nullptr;
+    size_t mappedLen = 0;
+};
+
+#endif
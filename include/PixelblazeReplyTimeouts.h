@@ -0,0 +1,59 @@
+#ifndef PixelblazeReplyTimeouts_h
+#define PixelblazeReplyTimeouts_h
+
+#include <Arduino.h>
+
+#include "PixelblazeHandlers.h"
+
+/**
+ * Min-heap of pending reply handlers ordered by ReplyHandler::deadlineMs, so the next handler to time out is always
+ * at the top however many are in flight. Each handler tracks its own position in heapIdx, which lets any handler be
+ * removed in O(log n) when its reply arrives.
+ *
+ * Deadlines are compared as millis() does, so they keep ordering correctly across its wraparound.
+ */
+class ReplyTimeouts {
+public:
+    explicit ReplyTimeouts(size_t capacity);
+
+    ~ReplyTimeouts();
+
+    ReplyTimeouts(const ReplyTimeouts &) = delete;
+
+    ReplyTimeouts &operator=(const ReplyTimeouts &) = delete;
+
+    /**
+     * @return false if the heap is full
+     */
+    bool push(ReplyHandler *handler);
+
+    void remove(ReplyHandler *handler);
+
+    /**
+     * @return the handler with the earliest deadline, or nullptr if none are pending
+     */
+    ReplyHandler *next() const {
+        return count > 0 ? heap[0] : nullptr;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+private:
+    static bool before(const ReplyHandler *a, const ReplyHandler *b) {
+        return (int32_t) (a->deadlineMs - b->deadlineMs) < 0;
+    }
+
+    void place(ReplyHandler *handler, size_t idx);
+
+    void siftUp(size_t idx);
+
+    void siftDown(size_t idx);
+
+    ReplyHandler **heap;
+    size_t capacity;
+    size_t count = 0;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include "BenchHarness.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> allocations(0);
+static std::atomic<size_t> bytes(0);
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+size_t BenchHarness::allocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+size_t BenchHarness::allocatedBytes() {
+    return bytes.load(std::memory_order_relaxed);
+}
+
+void BenchHarness::printHeader() {
+    printf("%-28s %12s %14s %10s %12s %12s\n",
+           "benchmark", "messages", "msgs/sec", "ns/msg", "allocs/msg", "bytes/msg");
+}
+
+void BenchHarness::printResult(const Result &result) {
+    double messages = result.messages ? (double) result.messages : 1;
+    double seconds = (double) result.elapsedNs / 1e9;
+    printf("%-28s %12zu %14.0f %10.1f %12.2f %12.1f\n",
+           result.name,
+           result.messages,
+           seconds > 0 ? (double) result.messages / seconds : 0,
+           (double) result.elapsedNs / messages,
+           (double) result.allocations / messages,
+           (double) result.allocatedBytes / messages);
+}
@@ -0,0 +1,57 @@
+#ifndef BenchHarness_h
+#define BenchHarness_h
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Minimal timing and allocation accounting for the host benchmarks. Linking BenchHarness.cpp replaces the global
+ * operator new/delete with counting versions, so only link it into benchmark executables.
+ */
+namespace BenchHarness {
+
+    struct Result {
+        const char *name;
+        size_t messages;
+        uint64_t elapsedNs;
+        size_t allocations;
+        size_t allocatedBytes;
+    };
+
+    size_t allocationCount();
+
+    size_t allocatedBytes();
+
+    void printHeader();
+
+    void printResult(const Result &result);
+
+    /**
+     * Runs setup() untimed, then run() timed with allocations counted, for the given number of rounds.
+     *
+     * @param messagesPerRound how many messages a single run() call processes, for per-message figures
+     */
+    template<typename Setup, typename Run>
+    Result measure(const char *name, size_t rounds, size_t messagesPerRound, Setup setup, Run run) {
+        Result result = {name, 0, 0, 0, 0};
+        for (size_t round = 0; round < rounds; round++) {
+            setup();
+
+            size_t allocsBefore = allocationCount();
+            size_t bytesBefore = allocatedBytes();
+            auto start = std::chrono::steady_clock::now();
+            run();
+            auto end = std::chrono::steady_clock::now();
+
+            result.elapsedNs += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            result.allocations += allocationCount() - allocsBefore;
+            result.allocatedBytes += allocatedBytes() - bytesBefore;
+            result.messages += messagesPerRound;
+        }
+
+        return result;
+    }
+}
+
+#endif
@@ -0,0 +1,297 @@
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "PixelblazeDecoders.h"
+#include "PixelblazeJsonStream.h"
+
+#include "BenchHarness.h"
+
+/**
+ * Times decoding a parsed getConfig reply, pattern change and stats message into their structs, looking every field
+ * up by name as the client used to against the single pass decoders in PixelblazeDecoders.h, and fails if the two
+ * disagree on any field. Parsing is done once up front, only the decode is measured.
+ *
+ * Then parses and decodes a long playlist both through a document, reporting how big the document has to be, and
+ * through the streaming decoder fed in socket sized chunks.
+ *
+ * Usage: decode_bench [rounds] [messagesPerRound] [playlistItems]
+ */
+
+using BenchHarness::measure;
+using BenchHarness::printResult;
+
+static const char SETTINGS_JSON[] =
+        "{\"name\":\"Living Room\",\"brandName\":\"\",\"pixelCount\":300,\"brightness\":0.6,\"maxBrightness\":80,"
+        "\"colorOrder\":\"GRB\",\"dataSpeedHz\":3500000,\"ledType\":2,\"sequenceTimer\":15,"
+        "\"transitionDuration\":0,\"sequencerMode\":1,\"runSequencer\":true,\"simpleUiMode\":false,"
+        "\"learningUiMode\":false,\"discoveryEnable\":true,\"timezone\":\"America/Los_Angeles\","
+        "\"autoOffEnable\":false,\"autoOffStart\":\"00:00\",\"autoOffEnd\":\"00:00\",\"cpuSpeed\":240,"
+        "\"networkPowerSave\":false,\"mapperFit\":0,\"leaderId\":0,\"nodeId\":1234,\"soundSrc\":0,\"accelSrc\":0,"
+        "\"lightSrc\":0,\"analogSrc\":0,\"exp\":0,\"ver\":\"3.40\",\"chipId\":6044276}";
+
+static const char SEQUENCER_JSON[] =
+        "{\"activeProgram\":{\"name\":\"rainbow melt\",\"activeProgramId\":\"6PS3fNgfrPTgA8PGo\","
+        "\"controls\":{\"sliderSpeed\":0.25,\"sliderScale\":0.5,\"hsvPickerColor\":0.1}},"
+        "\"sequencerMode\":1,\"runSequencer\":true,"
+        "\"playlist\":{\"position\":3,\"id\":\"_defaultplaylist_\",\"ms\":15000,\"remainingMs\":4200}}";
+
+static const char STATS_JSON[] =
+        "{\"fps\":287.6,\"vmerr\":0,\"vmerrpc\":-1,\"mem\":10230,\"exp\":0,\"renderType\":2,\"uptime\":8675309,"
+        "\"storageUsed\":723456,\"storageSize\":1378241,\"rr0\":1,\"rr1\":0,\"rebootCounter\":4}";
+
+static void lookupSettings(JsonDocument &json, Settings &settings) {
+    settings.name = json["name"].as<String>();
+    settings.brandName = json["brandName"].as<String>();
+    settings.pixelCount = json["pixelCount"];
+    settings.brightness = json["brightness"];
+    settings.maxBrightness = json["maxBrightness"];
+    settings.colorOrder = json["colorOrder"].as<String>();
+    settings.dataSpeedHz = json["dataSpeedHz"];
+    settings.ledType = ledTypeFromInt(json["ledType"].as<int>());
+    settings.sequenceTimerMs = json["sequenceTimer"];
+    settings.transitionDurationMs = json["transitionDuration"];
+    settings.sequencerMode = json["sequencerMode"];
+    settings.runSequencer = json["runSequencer"];
+    settings.simpleUiMode = json["simpleUiMode"];
+    settings.learningUiMode = json["learningUiMode"];
+    settings.discoveryEnabled = json["discoveryEnable"];
+    settings.timezone = json["timezone"].as<String>();
+    settings.autoOffEnable = json["autoOffEnable"];
+    settings.autoOffStart = json["autoOffStart"].as<String>();
+    settings.autoOffEnd = json["autoOffEnd"].as<String>();
+    settings.cpuSpeedMhz = json["cpuSpeed"];
+    settings.networkPowerSave = json["networkPowerSave"];
+    settings.mapperFit = json["mapperFit"];
+    settings.leaderId = json["leaderId"];
+    settings.nodeId = json["nodeId"];
+    settings.soundSrc = inputSourceFromInt(json["soundSrc"]);
+    settings.accelSrc = inputSourceFromInt(json["accelSrc"]);
+    settings.lightSrc = inputSourceFromInt(json["lightSrc"]);
+    settings.analogSrc = inputSourceFromInt(json["analogSrc"]);
+    settings.exp = json["exp"];
+    settings.version = json["ver"].as<String>();
+    settings.chipId = json["chipId"];
+}
+
+static void lookupSequencerState(JsonDocument &json, SequencerState &state, size_t controlLimit) {
+    JsonObject activeProgram = json["activeProgram"];
+    state.name = activeProgram["name"].as<String>();
+    state.activeProgramId = activeProgram["activeProgramId"].as<String>();
+
+    JsonObject controlsObj = activeProgram["controls"];
+    size_t controlIdx = 0;
+    for (JsonPair kv: controlsObj) {
+        if (controlIdx >= controlLimit) {
+            break;
+        }
+        state.controls[controlIdx].name = kv.key().c_str();
+        state.controls[controlIdx].value = kv.value();
+        controlIdx++;
+    }
+    state.controlCount = controlIdx;
+
+    state.sequencerMode = sequencerModeFromInt(json["sequencerMode"]);
+    state.runSequencer = json["runSequencer"];
+
+    JsonObject playlistObj = json["playlist"];
+    state.playlistPos = playlistObj["position"];
+    state.playlistId = playlistObj["id"].as<String>();
+    state.ttlMs = playlistObj["ms"];
+    state.remainingMs = playlistObj["remainingMs"];
+}
+
+static void lookupStats(JsonDocument &json, Stats &stats) {
+    stats.fps = json["fps"];
+    stats.vmerr = json["vmerr"];
+    stats.vmerrpc = json["vmerrpc"];
+    stats.memBytes = json["mem"];
+    stats.expansions = json["exp"];
+    stats.renderType = renderTypeFromInt(json["renderType"]);
+    stats.uptimeMs = json["uptime"];
+    stats.storageBytesUsed = json["storageUsed"];
+    stats.storageBytesSize = json["storageSize"];
+    stats.rr0 = json["rr0"];
+    stats.rr1 = json["rr1"];
+    stats.rebootCounter = json["rebootCounter"];
+}
+
+static std::string makePlaylist(size_t numItems) {
+    std::string text = "{\"playlist\":{\"position\":7,\"id\":\"_defaultplaylist_\",\"ms\":30000,"
+                       "\"remainingMs\":1234,\"items\":[";
+    char item[64];
+    for (size_t idx = 0; idx < numItems; idx++) {
+        snprintf(item, sizeof(item), "%s{\"id\":\"pb%014zu\",\"ms\":%zu}", idx ? "," : "", idx, 15000 + idx);
+        text += item;
+    }
+    return text + "]}}";
+}
+
+static void lookupPlaylist(JsonDocument &json, Playlist &playlist, size_t itemLimit) {
+    JsonObject playlistObj = json["playlist"];
+    playlist.id = playlistObj["id"].as<String>();
+    playlist.position = playlistObj["position"];
+    playlist.currentDurationMs = playlistObj["ms"];
+    playlist.remainingCurrentMs = playlistObj["remainingMs"];
+
+    size_t itemIdx = 0;
+    for (JsonVariant v: playlistObj["items"].as<JsonArray>()) {
+        if (itemIdx >= itemLimit) {
+            break;
+        }
+        playlist.items[itemIdx].id = v["id"].as<String>();
+        playlist.items[itemIdx].durationMs = v["ms"];
+        itemIdx++;
+    }
+    playlist.numItems = (int) itemIdx;
+}
+
+static size_t comparePlaylist(const Playlist &a, const Playlist &b) {
+    size_t mismatches = (a.id != b.id) + (a.position != b.position) + (a.currentDurationMs != b.currentDurationMs)
+                        + (a.remainingCurrentMs != b.remainingCurrentMs) + (a.numItems != b.numItems);
+    for (int idx = 0; idx < a.numItems && idx < b.numItems; idx++) {
+        mismatches += (a.items[idx].id != b.items[idx].id) + (a.items[idx].durationMs != b.items[idx].durationMs);
+    }
+
+    return mismatches;
+}
+
+static size_t compareSettings(const Settings &a, const Settings &b) {
+    return (a.name != b.name) + (a.brandName != b.brandName) + (a.pixelCount != b.pixelCount)
+           + (a.brightness != b.brightness) + (a.maxBrightness != b.maxBrightness) + (a.colorOrder != b.colorOrder)
+           + (a.dataSpeedHz != b.dataSpeedHz) + (a.ledType != b.ledType) + (a.sequenceTimerMs != b.sequenceTimerMs)
+           + (a.transitionDurationMs != b.transitionDurationMs) + (a.sequencerMode != b.sequencerMode)
+           + (a.runSequencer != b.runSequencer) + (a.simpleUiMode != b.simpleUiMode)
+           + (a.learningUiMode != b.learningUiMode) + (a.discoveryEnabled != b.discoveryEnabled)
+           + (a.timezone != b.timezone) + (a.autoOffEnable != b.autoOffEnable) + (a.autoOffStart != b.autoOffStart)
+           + (a.autoOffEnd != b.autoOffEnd) + (a.cpuSpeedMhz != b.cpuSpeedMhz)
+           + (a.networkPowerSave != b.networkPowerSave) + (a.mapperFit != b.mapperFit) + (a.leaderId != b.leaderId)
+           + (a.nodeId != b.nodeId) + (a.soundSrc != b.soundSrc) + (a.accelSrc != b.accelSrc)
+           + (a.lightSrc != b.lightSrc) + (a.analogSrc != b.analogSrc) + (a.exp != b.exp) + (a.version != b.version)
+           + (a.chipId != b.chipId);
+}
+
+static size_t compareSequencerState(const SequencerState &a, const SequencerState &b) {
+    size_t mismatches = (a.name != b.name) + (a.activeProgramId != b.activeProgramId)
+                        + (a.controlCount != b.controlCount) + (a.sequencerMode != b.sequencerMode)
+                        + (a.runSequencer != b.runSequencer) + (a.playlistPos != b.playlistPos)
+                        + (a.playlistId != b.playlistId) + (a.ttlMs != b.ttlMs) + (a.remainingMs != b.remainingMs);
+    for (size_t idx = 0; idx < a.controlCount && idx < b.controlCount; idx++) {
+        mismatches += (a.controls[idx].name != b.controls[idx].name) + (a.controls[idx].value != b.controls[idx].value);
+    }
+
+    return mismatches;
+}
+
+static size_t compareStats(const Stats &a, const Stats &b) {
+    return (a.fps != b.fps) + (a.vmerr != b.vmerr) + (a.vmerrpc != b.vmerrpc) + (a.memBytes != b.memBytes)
+           + (a.expansions != b.expansions) + (a.renderType != b.renderType) + (a.uptimeMs != b.uptimeMs)
+           + (a.storageBytesUsed != b.storageBytesUsed) + (a.storageBytesSize != b.storageBytesSize)
+           + (a.rr0 != b.rr0) + (a.rr1 != b.rr1) + (a.rebootCounter != b.rebootCounter);
+}
+
+int main(int argc, char **argv) {
+    size_t rounds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 5;
+    size_t perRound = argc > 2 ? strtoul(argv[2], nullptr, 10) : 20000;
+    size_t playlistItems = argc > 3 ? strtoul(argv[3], nullptr, 10) : 400;
+    const size_t controlLimit = 25;
+
+    DynamicJsonDocument settingsJson(4096);
+    DynamicJsonDocument sequencerJson(2048);
+    DynamicJsonDocument statsJson(1024);
+    if (deserializeJson(settingsJson, SETTINGS_JSON) || deserializeJson(sequencerJson, SEQUENCER_JSON)
+        || deserializeJson(statsJson, STATS_JSON)) {
+        fprintf(stderr, "failed to parse sample messages\n");
+        return 1;
+    }
+
+    Settings lookedUpSettings, decodedSettings;
+    Control lookedUpControls[controlLimit], decodedControls[controlLimit];
+    SequencerState lookedUpState, decodedState;
+    lookedUpState.controls = lookedUpControls;
+    decodedState.controls = decodedControls;
+    Stats lookedUpStats, decodedStats;
+
+    BenchHarness::printHeader();
+    printResult(measure("settings lookups", rounds, perRound, []() {}, [&]() {
+        for (size_t idx = 0; idx < perRound; idx++) {
+            lookupSettings(settingsJson, lookedUpSettings);
+        }
+    }));
+    printResult(measure("settings decoder", rounds, perRound, []() {}, [&]() {
+        for (size_t idx = 0; idx < perRound; idx++) {
+            decodeSettings(settingsJson.as<JsonObject>(), decodedSettings);
+        }
+    }));
+    printResult(measure("sequencer lookups", rounds, perRound, []() {}, [&]() {
+        for (size_t idx = 0; idx < perRound; idx++) {
+            lookupSequencerState(sequencerJson, lookedUpState, controlLimit);
+        }
+    }));
+    printResult(measure("sequencer decoder", rounds, perRound, []() {}, [&]() {
+        for (size_t idx = 0; idx < perRound; idx++) {
+            decodeSequencerState(sequencerJson.as<JsonObject>(), decodedState, controlLimit);
+        }
+    }));
+    printResult(measure("stats lookups", rounds, perRound, []() {}, [&]() {
+        for (size_t idx = 0; idx < perRound; idx++) {
+            lookupStats(statsJson, lookedUpStats);
+        }
+    }));
+    printResult(measure("stats decoder", rounds, perRound, []() {}, [&]() {
+        for (size_t idx = 0; idx < perRound; idx++) {
+            decodeStats(statsJson.as<JsonObject>(), decodedStats);
+        }
+    }));
+
+    //A reply a document can't hold fails outright, so size one to fit for the comparison
+    std::string playlistText = makePlaylist(playlistItems);
+    size_t docBytes = 4096;
+    DynamicJsonDocument *playlistJson = nullptr;
+    while (true) {
+        playlistJson = new DynamicJsonDocument(docBytes);
+        if (!deserializeJson(*playlistJson, playlistText.data(), playlistText.size())) {
+            break;
+        }
+        delete playlistJson;
+        docBytes *= 2;
+    }
+    size_t docUsed = playlistJson->memoryUsage();
+
+    std::vector<PlaylistItem> documentItems(playlistItems), streamedItems(playlistItems);
+    Playlist documentPlaylist, streamedPlaylist;
+    documentPlaylist.items = documentItems.data();
+    streamedPlaylist.items = streamedItems.data();
+    const size_t chunkBytes = 1024;
+    JsonStreamTokenizer tokenizer(128);
+    bool streamOk = true;
+
+    printResult(measure("playlist document", rounds, 1, []() {}, [&]() {
+        //Parsed from a copy each round, since parsing in place consumes the text
+        std::string copy = playlistText;
+        deserializeJson(*playlistJson, &copy[0], copy.size());
+        lookupPlaylist(*playlistJson, documentPlaylist, playlistItems);
+    }));
+    printResult(measure("playlist stream", rounds, 1, []() {}, [&]() {
+        PlaylistStreamDecoder decoder(streamedPlaylist, playlistItems);
+        tokenizer.reset();
+        for (size_t offset = 0; offset < playlistText.size(); offset += chunkBytes) {
+            streamOk = tokenizer.feed(playlistText.data() + offset,
+                                      min(chunkBytes, playlistText.size() - offset), decoder) && streamOk;
+        }
+        streamOk = streamOk && tokenizer.isComplete();
+    }));
+    delete playlistJson;
+
+    printf("\nplaylist of %zu items, %zu bytes: document needs %zu bytes, stream %zu chunk + %d token bytes\n",
+           playlistItems, playlistText.size(), docUsed, chunkBytes, 128);
+
+    size_t mismatches = compareSettings(lookedUpSettings, decodedSettings)
+                        + compareSequencerState(lookedUpState, decodedState)
+                        + compareStats(lookedUpStats, decodedStats)
+                        + comparePlaylist(documentPlaylist, streamedPlaylist) + !streamOk;
+    printf("mismatched fields: %zu\n", mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
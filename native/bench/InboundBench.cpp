@@ -0,0 +1,156 @@
+#include <Arduino.h>
+
+#include "PixelblazeClient.h"
+#include "PixelblazeMemBuffer.h"
+
+#include "BenchHarness.h"
+#include "../fixtures/PixelblazeFixtures.h"
+
+/**
+ * Pushes synthetic traffic through PixelblazeClient::checkForInbound() and reports throughput and allocations for
+ * each inbound dispatch path. Queueing traffic and issuing requests happens outside the timed region, so the figures
+ * cover only checkForInbound() draining the mock socket.
+ *
+ * Usage: inbound_bench [rounds] [messagesPerRound]
+ */
+
+using namespace PixelblazeFixtures;
+using BenchHarness::measure;
+using BenchHarness::printResult;
+
+class CountingWatcher : public PixelblazeWatcher {
+public:
+    void handleStats(Stats &stats) override {
+        statsSeen++;
+    }
+
+    void handlePatternChange(SequencerState &patternChange) override {
+        patternChangesSeen++;
+    }
+
+    void handlePreviewFrame(uint8_t *previewPixelRGB, size_t len) override {
+        previewBytesSeen += len;
+    }
+
+    size_t statsSeen = 0;
+    size_t patternChangesSeen = 0;
+    size_t previewBytesSeen = 0;
+};
+
+static size_t repliesSeen = 0;
+static size_t patternsSeen = 0;
+
+static void countSettings(Settings &settings) {
+    repliesSeen++;
+}
+
+static void countSequencer(SequencerState &sequencerState) {
+    repliesSeen++;
+}
+
+static void countPatterns(AllPatternIterator &iterator) {
+    PatternIdentifiers identifiers;
+    while (iterator.next(identifiers)) {
+        patternsSeen++;
+    }
+    repliesSeen++;
+}
+
+static void countExpander(ExpanderChannel *channels, size_t numChannels) {
+    repliesSeen++;
+}
+
+static void ignoreFailure(FailureCause cause) {}
+
+static ClientConfig benchConfig(size_t messagesPerRound) {
+    ClientConfig config;
+    config.replyQueueSize = messagesPerRound + 1;
+    config.maxInboundCheckMs = 1000000;
+    config.maxResponseWaitMs = 1000000;
+    return config;
+}
+
+int main(int argc, char **argv) {
+    size_t rounds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200;
+    size_t perRound = argc > 2 ? strtoul(argv[2], nullptr, 10) : 64;
+
+    Serial.mute(true);
+
+    WebSocketClient wsClient;
+    wsClient.setRecordSent(false);
+    PixelblazeMemBuffer buffer(3, 16384);
+    CountingWatcher watcher;
+    PixelblazeClient client(wsClient, buffer, watcher, benchConfig(perRound));
+    client.begin();
+
+    std::vector<uint8_t> preview = previewFrame(1024, 0);
+    std::vector<std::vector<uint8_t>> programList = programListFrames(100, 1024);
+    std::vector<uint8_t> expanderFirst = binaryFrame(BinaryMsgType::ExpanderChannels, FramePosition::First,
+                                                     expanderChannelsBody(8).data(), 8 * EXPANDER_CHANNEL_BYTE_WIDTH);
+    std::vector<uint8_t> expanderLast = binaryFrame(BinaryMsgType::ExpanderChannels, FramePosition::Last,
+                                                    nullptr, 0);
+
+    BenchHarness::printHeader();
+
+    printResult(measure("stats json", rounds, perRound, [&]() {
+        for (size_t idx = 0; idx < perRound; idx++) {
+            wsClient.queueText(STATS_JSON);
+        }
+    }, [&]() {
+        client.checkForInbound();
+    }));
+
+    printResult(measure("preview frame 3072B", rounds, perRound, [&]() {
+        for (size_t idx = 0; idx < perRound; idx++) {
+            wsClient.queueBinary(preview.data(), preview.size());
+        }
+    }, [&]() {
+        client.checkForInbound();
+    }));
+
+    printResult(measure("getConfig settings", rounds, perRound, [&]() {
+        for (size_t idx = 0; idx < perRound; idx++) {
+            client.getSettings(countSettings, ignoreFailure);
+            wsClient.queueText(SETTINGS_JSON);
+        }
+    }, [&]() {
+        client.checkForInbound();
+    }));
+
+    printResult(measure("getConfig sequencer", rounds, perRound, [&]() {
+        for (size_t idx = 0; idx < perRound; idx++) {
+            client.getSequencerState(countSequencer, ignoreFailure);
+            wsClient.queueText(SEQUENCER_JSON);
+        }
+    }, [&]() {
+        client.checkForInbound();
+    }));
+
+    size_t listRequests = max((size_t) 1, perRound / programList.size());
+    printResult(measure("program list (frames)", rounds, listRequests * programList.size(), [&]() {
+        for (size_t idx = 0; idx < listRequests; idx++) {
+            client.getPatterns(countPatterns, ignoreFailure);
+            for (auto &frame: programList) {
+                wsClient.queueBinary(frame.data(), frame.size());
+            }
+        }
+    }, [&]() {
+        client.checkForInbound();
+    }));
+
+    size_t expanderRequests = max((size_t) 1, perRound / 2);
+    printResult(measure("expander channels (frames)", rounds, expanderRequests * 2, [&]() {
+        for (size_t idx = 0; idx < expanderRequests; idx++) {
+            client.getExpanderConfig(countExpander, ignoreFailure);
+            wsClient.queueBinary(expanderFirst.data(), expanderFirst.size());
+            wsClient.queueBinary(expanderLast.data(), expanderLast.size());
+        }
+    }, [&]() {
+        client.checkForInbound();
+    }));
+
+    printf("\nstats=%zu patternChanges=%zu previewBytes=%zu replies=%zu patterns=%zu\n",
+           watcher.statsSeen, watcher.patternChangesSeen, watcher.previewBytesSeen, repliesSeen, patternsSeen);
+
+    return 0;
+}
@@ -0,0 +1,213 @@
+#include <vector>
+
+#include <Arduino.h>
+
+#include "PixelblazePreviewAnalytics.h"
+#include "PixelblazePreviewDelta.h"
+
+#include "BenchHarness.h"
+#include "../fixtures/PixelblazeFixtures.h"
+
+/**
+ * Times analyzePreviewFrame() with each kernel this machine supports against the naive per-byte loops it replaces,
+ * and checks every kernel agrees with the scalar one. Then times PreviewFrameDiffer on mostly repeated and on entirely
+ * changing frames against a per-pixel compare, and checks applying its deltas reproduces each frame.
+ *
+ * Usage: preview_bench [rounds] [framesPerRound] [pixels] [segments]
+ */
+
+using namespace PixelblazeFixtures;
+using BenchHarness::measure;
+using BenchHarness::printResult;
+
+//What dashboards did before, one loop per statistic
+static void naiveAnalyze(const uint8_t *rgb, size_t len, PreviewFrameStats &stats,
+                         PreviewSegment *segments, size_t numSegments) {
+    size_t pixels = len / 3;
+    uint64_t sums[3] = {0, 0, 0};
+    uint8_t peaks[3] = {0, 0, 0};
+    for (size_t idx = 0; idx < pixels * 3; idx++) {
+        sums[idx % 3] += rgb[idx];
+    }
+    for (size_t idx = 0; idx < pixels * 3; idx++) {
+        peaks[idx % 3] = max(peaks[idx % 3], rgb[idx]);
+    }
+    for (uint32_t &bin: stats.luminanceHistogram) {
+        bin = 0;
+    }
+    for (size_t pixel = 0; pixel < pixels; pixel++) {
+        float luma = 0.3f * rgb[pixel * 3] + 0.59f * rgb[pixel * 3 + 1] + 0.11f * rgb[pixel * 3 + 2];
+        stats.luminanceHistogram[min((size_t) (luma * PREVIEW_HISTOGRAM_BINS / 256), (size_t) PREVIEW_HISTOGRAM_BINS - 1)]++;
+    }
+    for (size_t segmentIdx = 0; segmentIdx < numSegments; segmentIdx++) {
+        size_t start = pixels * segmentIdx / numSegments;
+        size_t end = pixels * (segmentIdx + 1) / numSegments;
+        uint64_t segmentSums[3] = {0, 0, 0};
+        for (size_t idx = start * 3; idx < end * 3; idx++) {
+            segmentSums[idx % 3] += rgb[idx];
+        }
+        segments[segmentIdx].red = (uint8_t) (segmentSums[0] / max(end - start, (size_t) 1));
+        segments[segmentIdx].green = (uint8_t) (segmentSums[1] / max(end - start, (size_t) 1));
+        segments[segmentIdx].blue = (uint8_t) (segmentSums[2] / max(end - start, (size_t) 1));
+    }
+
+    stats.pixelCount = pixels;
+    stats.avgRed = (uint8_t) (sums[0] / max(pixels, (size_t) 1));
+    stats.avgGreen = (uint8_t) (sums[1] / max(pixels, (size_t) 1));
+    stats.avgBlue = (uint8_t) (sums[2] / max(pixels, (size_t) 1));
+    stats.peakRed = peaks[0];
+    stats.peakGreen = peaks[1];
+    stats.peakBlue = peaks[2];
+}
+
+static bool sameResults(const PreviewFrameStats &a, const PreviewSegment *aSegments,
+                        const PreviewFrameStats &b, const PreviewSegment *bSegments, size_t numSegments) {
+    if (a.pixelCount != b.pixelCount || a.avgRed != b.avgRed || a.avgGreen != b.avgGreen || a.avgBlue != b.avgBlue
+        || a.peakRed != b.peakRed || a.peakGreen != b.peakGreen || a.peakBlue != b.peakBlue) {
+        return false;
+    }
+
+    for (size_t bin = 0; bin < PREVIEW_HISTOGRAM_BINS; bin++) {
+        if (a.luminanceHistogram[bin] != b.luminanceHistogram[bin]) {
+            return false;
+        }
+    }
+
+    for (size_t idx = 0; idx < numSegments; idx++) {
+        if (aSegments[idx].red != bSegments[idx].red || aSegments[idx].green != bSegments[idx].green
+            || aSegments[idx].blue != bSegments[idx].blue || aSegments[idx].pixelCount != bSegments[idx].pixelCount) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv) {
+    size_t rounds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200;
+    size_t perRound = argc > 2 ? strtoul(argv[2], nullptr, 10) : 100;
+    size_t pixels = argc > 3 ? strtoul(argv[3], nullptr, 10) : 1024;
+    size_t numSegments = argc > 4 ? strtoul(argv[4], nullptr, 10) : 8;
+
+    //Skip the type byte, watchers only ever see the pixels
+    std::vector<std::vector<uint8_t>> frames;
+    for (size_t idx = 0; idx < perRound; idx++) {
+        frames.push_back(previewFrame(pixels, idx));
+        frames.back().erase(frames.back().begin());
+    }
+
+    std::vector<PreviewSegment> segments(numSegments);
+    std::vector<PreviewSegment> expectedSegments(numSegments);
+    PreviewFrameStats stats = {};
+    PreviewFrameStats expected = {};
+    uint64_t checksum = 0;
+
+    BenchHarness::printHeader();
+
+    printResult(measure("naive loops", rounds, perRound, []() {}, [&]() {
+        for (auto &frame: frames) {
+            naiveAnalyze(frame.data(), frame.size(), stats, segments.data(), numSegments);
+            checksum += stats.avgRed + stats.luminanceHistogram[0];
+        }
+    }));
+
+    const struct {
+        PreviewKernel kernel;
+        const char *name;
+    } kernels[] = {
+            {PreviewKernel::Scalar, "analyze scalar"},
+            {PreviewKernel::SSSE3,  "analyze ssse3"},
+            {PreviewKernel::AVX2,   "analyze avx2"},
+    };
+
+    for (auto &kernel: kernels) {
+        if (!previewKernelAvailable(kernel.kernel)) {
+            printf("%-28s unavailable\n", kernel.name);
+            continue;
+        }
+
+        printResult(measure(kernel.name, rounds, perRound, []() {}, [&]() {
+            for (auto &frame: frames) {
+                analyzePreviewFrame(frame.data(), frame.size(), stats, segments.data(), numSegments, kernel.kernel);
+                checksum += stats.avgRed + stats.luminanceHistogram[0];
+            }
+        }));
+
+        for (auto &frame: frames) {
+            analyzePreviewFrame(frame.data(), frame.size(), expected, expectedSegments.data(), numSegments,
+                                PreviewKernel::Scalar);
+            analyzePreviewFrame(frame.data(), frame.size(), stats, segments.data(), numSegments, kernel.kernel);
+            if (!sameResults(expected, expectedSegments.data(), stats, segments.data(), numSegments)) {
+                printf("%s disagrees with scalar\n", kernel.name);
+                return 1;
+            }
+        }
+    }
+
+    //Slow patterns: most frames repeat, the rest change a handful of pixels
+    std::vector<std::vector<uint8_t>> sparseFrames(perRound, frames[0]);
+    for (size_t idx = 1; idx < perRound; idx++) {
+        sparseFrames[idx] = sparseFrames[idx - 1];
+        if (idx % 4 == 0) {
+            size_t pixel = (idx * 37) % pixels;
+            sparseFrames[idx][pixel * 3] ^= 0xFF;
+            sparseFrames[idx][((pixel + pixels / 2) % pixels) * 3 + 2] ^= 0x0F;
+        }
+    }
+
+    const struct {
+        const char *naiveName;
+        const char *name;
+        std::vector<std::vector<uint8_t>> *frames;
+    } diffCases[] = {
+            {"naive diff sparse", "differ sparse", &sparseFrames},
+            {"naive diff full",   "differ full",   &frames},
+    };
+
+    PreviewFrameDiffer differ(frames[0].size());
+    std::vector<uint8_t> previous(frames[0].size());
+    std::vector<uint8_t> delta(frames[0].size() * 2);
+    std::vector<uint8_t> mirror(frames[0].size());
+
+    for (auto &diffCase: diffCases) {
+        std::vector<std::vector<uint8_t>> &caseFrames = *diffCase.frames;
+
+        printResult(measure(diffCase.naiveName, rounds, perRound, [&]() {
+            previous = caseFrames.back();
+        }, [&]() {
+            for (auto &frame: caseFrames) {
+                for (size_t pixel = 0; pixel < pixels; pixel++) {
+                    if (memcmp(&previous[pixel * 3], &frame[pixel * 3], 3) != 0) {
+                        memcpy(&previous[pixel * 3], &frame[pixel * 3], 3);
+                        checksum++;
+                    }
+                }
+            }
+        }));
+
+        printResult(measure(diffCase.name, rounds, perRound, [&]() {
+            differ.update(caseFrames.back().data(), caseFrames.back().size());
+        }, [&]() {
+            for (auto &frame: caseFrames) {
+                if (differ.update(frame.data(), frame.size())) {
+                    checksum += differ.dirtyPixelCount();
+                }
+            }
+        }));
+
+        mirror = caseFrames.back();
+        differ.update(mirror.data(), mirror.size());
+        for (auto &frame: caseFrames) {
+            differ.update(frame.data(), frame.size());
+            size_t deltaLen = differ.writeDelta(delta.data(), delta.size());
+            if (!PreviewFrameDiffer::applyDelta(mirror.data(), mirror.size(), delta.data(), deltaLen)
+                || mirror != frame) {
+                printf("%s delta doesn't reproduce the frame\n", diffCase.name);
+                return 1;
+            }
+        }
+    }
+
+    printf("\nchecksum=%llu\n", (unsigned long long) checksum);
+    return 0;
+}
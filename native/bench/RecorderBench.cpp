@@ -0,0 +1,151 @@
+#include <vector>
+
+#include <Arduino.h>
+
+#include "PixelblazeRecorder.h"
+
+#include "BenchHarness.h"
+
+/**
+ * Records synthetic preview traffic through PixelblazeRecorder into memory, reports how compact the result is against
+ * raw frames, then reads it back checking every frame matches what was recorded and that seeks land where they
+ * should. Frames come from a slow pattern (a band of pixels drifting along the strip) and a noisy one (every pixel
+ * changing every frame).
+ *
+ * Usage: recorder_bench [seconds] [fps] [pixels]
+ */
+
+using BenchHarness::measure;
+using BenchHarness::printResult;
+
+class VectorPrint : public Print {
+public:
+    size_t write(uint8_t c) override {
+        bytes.push_back(c);
+        return 1;
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) override {
+        bytes.insert(bytes.end(), buffer, buffer + size);
+        return size;
+    }
+
+    std::vector<uint8_t> bytes;
+};
+
+static void slowFrame(std::vector<uint8_t> &frame, size_t frameNum) {
+    size_t pixels = frame.size() / 3;
+    size_t bandStart = (frameNum / 4) % pixels;
+    std::fill(frame.begin(), frame.end(), 0);
+    for (size_t idx = 0; idx < 16; idx++) {
+        size_t pixel = (bandStart + idx) % pixels;
+        frame[pixel * 3] = 200;
+        frame[pixel * 3 + 1] = (uint8_t) (idx * 16);
+    }
+}
+
+static void noisyFrame(std::vector<uint8_t> &frame, size_t frameNum) {
+    for (size_t idx = 0; idx < frame.size(); idx++) {
+        frame[idx] = (uint8_t) (idx * 7 + frameNum * 3);
+    }
+}
+
+static bool runCase(const char *name, void (*makeFrame)(std::vector<uint8_t> &, size_t),
+                    uint32_t seconds, uint32_t fps, size_t pixels) {
+    size_t frameCount = (size_t) seconds * fps;
+    uint32_t intervalMs = max((uint32_t) 1, 1000 / fps);
+
+    VectorPrint out;
+    PixelblazeRecorder recorder(out);
+    std::vector<uint8_t> frame(pixels * 3);
+    Stats stats;
+    SequencerState patternChange;
+    patternChange.activeProgramId = "pb00000000000000";
+    patternChange.name = "drifting band";
+
+    ArduinoShim::setMillis(1000);
+    recorder.begin();
+    char resultName[64];
+    snprintf(resultName, sizeof(resultName), "record %s", name);
+    printResult(measure(resultName, 1, frameCount, []() {}, [&]() {
+        for (size_t idx = 0; idx < frameCount; idx++) {
+            makeFrame(frame, idx);
+            recorder.handlePreviewFrame(frame.data(), frame.size());
+            if (idx % fps == 0) {
+                stats.uptimeMs = millis();
+                recorder.handleStats(stats);
+            }
+            if (idx % (fps * 30) == 0) {
+                recorder.handlePatternChange(patternChange);
+            }
+            ArduinoShim::advanceMillis(intervalMs);
+        }
+    }));
+    recorder.finish();
+
+    printf("  %zu frames, %zu bytes recorded vs %zu raw (%.1f%%), %.1f bytes/frame\n",
+           frameCount, out.bytes.size(), frameCount * frame.size(),
+           100.0 * out.bytes.size() / max(frameCount * frame.size(), (size_t) 1),
+           (double) out.bytes.size() / max(frameCount, (size_t) 1));
+
+    PixelblazeRecordingReader reader(frame.size());
+    if (!reader.open(out.bytes.data(), out.bytes.size())) {
+        printf("  %s: recording didn't open\n", name);
+        return false;
+    }
+
+    RecordedEvent event;
+    size_t framesRead = 0;
+    snprintf(resultName, sizeof(resultName), "replay %s", name);
+    bool framesMatch = true;
+    printResult(measure(resultName, 1, frameCount, []() {}, [&]() {
+        while (reader.next(event)) {
+            if (event.type == RecordType::KeyFrame || event.type == RecordType::DeltaFrame) {
+                makeFrame(frame, framesRead);
+                //Unchanged frames aren't recorded, catch up to the one this event carries
+                while (memcmp(frame.data(), event.frame, frame.size()) != 0 && framesRead < frameCount) {
+                    makeFrame(frame, ++framesRead);
+                }
+                framesMatch = framesMatch && framesRead < frameCount && event.frameLen == frame.size();
+                framesRead++;
+            }
+        }
+    }));
+
+    if (!framesMatch) {
+        printf("  %s: replayed frames don't match what was recorded\n", name);
+        return false;
+    }
+
+    //Seek to the middle and check the frame we land on is the one recorded then
+    uint32_t middleMs = 1000 + (uint32_t) (frameCount / 2) * intervalMs;
+    if (!reader.seek(middleMs) || !reader.next(event)) {
+        printf("  %s: seek failed\n", name);
+        return false;
+    }
+    while (event.type != RecordType::KeyFrame && event.type != RecordType::DeltaFrame && reader.next(event)) {}
+    size_t seekedFrame = (event.timeMs - 1000) / intervalMs;
+    makeFrame(frame, seekedFrame);
+    if (event.timeMs < middleMs || memcmp(frame.data(), event.frame, frame.size()) != 0) {
+        printf("  %s: seek to %ums landed on the wrong frame\n", name, middleMs);
+        return false;
+    }
+
+    printf("  index entries=%zu, seek to %ums ok\n", reader.indexEntryCount(), middleMs);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    uint32_t seconds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 60;
+    uint32_t fps = argc > 2 ? max((uint32_t) 1, (uint32_t) strtoul(argv[2], nullptr, 10)) : 100;
+    size_t pixels = argc > 3 ? strtoul(argv[3], nullptr, 10) : 1024;
+
+    Serial.mute(true);
+    ArduinoShim::useManualClock(true);
+
+    BenchHarness::printHeader();
+    bool ok = runCase("slow", slowFrame, seconds, fps, pixels);
+    ok = runCase("noisy", noisyFrame, seconds, fps, pixels) && ok;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+#include <vector>
+
+#include <Arduino.h>
+
+#include "PixelblazeClient.h"
+#include "PixelblazeMemBuffer.h"
+#include "PixelblazeFloatFormat.h"
+
+#include "BenchHarness.h"
+
+/**
+ * Compares how brightness and control values get turned into text: ArduinoJson's general purpose float serialization
+ * against formatFixedFloat(), first on bare values and then end to end through setCurrentPatternControls() with
+ * clientConfig.setterFloatDecimals at 0 and at 4. Also checks every formatted value reads back within half a unit of
+ * its last place.
+ *
+ * Usage: setter_bench [values] [controls]
+ */
+
+using BenchHarness::measure;
+using BenchHarness::printResult;
+
+static size_t checkRoundTrip(const std::vector<float> &values, uint8_t decimals) {
+    double tolerance = 0.5;
+    for (uint8_t idx = 0; idx < decimals; idx++) {
+        tolerance /= 10;
+    }
+
+    size_t mismatches = 0;
+    char text[24];
+    for (float value: values) {
+        size_t len = formatFixedFloat(text, sizeof(text) - 1, value, decimals);
+        text[len] = 0;
+        //Allow for the float itself not landing exactly on the rounding boundary
+        if (len == 0 || fabs(strtod(text, nullptr) - value) > tolerance + 1e-6) {
+            mismatches++;
+        }
+    }
+
+    return mismatches;
+}
+
+static size_t runSetters(const std::vector<float> &values, size_t numControls, uint8_t decimals, size_t &bytesSent) {
+    WebSocketClient wsClient;
+    wsClient.setRecordSent(false);
+    PixelblazeMemBuffer buffer(4, 1024);
+    PixelblazeWatcher watcher;
+    ClientConfig clientConfig;
+    clientConfig.setterFloatDecimals = decimals;
+    PixelblazeClient client(wsClient, buffer, watcher, clientConfig);
+    client.begin();
+
+    std::vector<Control> controls(numControls);
+    for (size_t idx = 0; idx < numControls; idx++) {
+        controls[idx].name = String("sliderControl") + String((int) idx);
+    }
+
+    size_t rounds = values.size() / numControls;
+    char name[48];
+    snprintf(name, sizeof(name), "setControls decimals=%u", decimals);
+    wsClient.resetStats();
+    printResult(measure(name, 1, rounds, []() {}, [&]() {
+        for (size_t round = 0; round < rounds; round++) {
+            for (size_t idx = 0; idx < numControls; idx++) {
+                controls[idx].value = values[round * numControls + idx];
+            }
+            client.setCurrentPatternControls(controls.data(), (int) numControls, false);
+        }
+    }));
+
+    bytesSent = wsClient.stats().bytesSent;
+    return rounds;
+}
+
+int main(int argc, char **argv) {
+    size_t numValues = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+    size_t numControls = argc > 2 ? max((size_t) 1, (size_t) strtoul(argv[2], nullptr, 10)) : 10;
+
+    //Slider positions as a UI produces them, anywhere in [0, 1) with no particular precision
+    std::vector<float> values(numValues);
+    uint32_t seed = 12345;
+    for (auto &value: values) {
+        seed = seed * 1664525 + 1013904223;
+        value = (float) (seed >> 8) / (float) (1 << 24);
+    }
+
+    Serial.mute(true);
+
+    size_t arduinoJsonBytes = 0;
+    size_t fixedBytes = 0;
+    char text[24];
+    BenchHarness::printHeader();
+    printResult(measure("ArduinoJson float", 1, numValues, []() {}, [&]() {
+        StaticJsonDocument<64> doc;
+        for (float value: values) {
+            doc["v"] = value;
+            arduinoJsonBytes += serializeJson(doc["v"], text, sizeof(text));
+        }
+    }));
+    printResult(measure("formatFixedFloat 4", 1, numValues, []() {}, [&]() {
+        for (float value: values) {
+            fixedBytes += formatFixedFloat(text, sizeof(text), value, 4);
+        }
+    }));
+
+    size_t looseBytes = 0;
+    size_t fixedSetterBytes = 0;
+    runSetters(values, numControls, 0, looseBytes);
+    size_t rounds = runSetters(values, numControls, 4, fixedSetterBytes);
+
+    size_t mismatches = checkRoundTrip(values, 4) + checkRoundTrip(values, 2) + checkRoundTrip(values, 0);
+    printf("\nvalue text: %.2f bytes ArduinoJson, %.2f bytes fixed\n", (double) arduinoJsonBytes / numValues,
+           (double) fixedBytes / numValues);
+    printf("setter frames: %.1f bytes decimals=0, %.1f bytes decimals=4\n", (double) looseBytes / max(rounds, (size_t) 1),
+           (double) fixedSetterBytes / max(rounds, (size_t) 1));
+    printf("round trip mismatches: %zu\n", mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
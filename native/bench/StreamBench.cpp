@@ -0,0 +1,246 @@
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+
+#include "PixelblazeClient.h"
+#include "PixelblazeArenaBuffer.h"
+#include "PixelblazeMemBuffer.h"
+#include "PixelblazeMmapBuffer.h"
+
+#include "BenchHarness.h"
+
+/**
+ * Times moving bytes through PixelblazeMemBuffer, PixelblazeArenaBuffer and PixelblazeMmapBuffer streams a byte at a
+ * time, with the bulk write()/readBytes() paths and by borrowing the buffer's memory, then multipart pattern lists and
+ * preview images end to end through checkForInbound() on each. Then counts how many replies of mixed sizes the memory
+ * backends hold at once in the same RAM. Fails if any path reads back something other than what was written.
+ *
+ * Usage: stream_bench [rounds] [patterns] [mmapDirectory]
+ */
+
+using BenchHarness::measure;
+using BenchHarness::printResult;
+
+static size_t patternsSeen = 0;
+static size_t patternBytesSeen = 0;
+static size_t previewBytesSeen = 0;
+static String previewIdSeen;
+
+static void countPatterns(AllPatternIterator &iterator) {
+    PatternIdentifiers identifiers;
+    while (iterator.next(identifiers)) {
+        patternsSeen++;
+        patternBytesSeen += identifiers.id.length() + identifiers.name.length() + 2;
+    }
+}
+
+static void readPreview(String &patternId, CloseableStream *stream) {
+    previewIdSeen = patternId;
+    uint8_t chunk[256];
+    size_t read;
+    while ((read = stream->readBytes(chunk, sizeof(chunk))) > 0) {
+        previewBytesSeen += read;
+    }
+}
+
+static void noFailure(FailureCause cause) {
+    Serial.print(F("Unexpected failure: "));
+    Serial.println((int) cause);
+}
+
+/**
+ * Split payload into binary frames of the given type no longer than frameBytes, flagged first/middle/last
+ */
+static void queueMultipart(WebSocketClient &wsClient, BinaryMsgType type, const std::string &payload,
+                           size_t frameBytes) {
+    for (size_t offset = 0; offset < payload.size(); offset += frameBytes) {
+        size_t len = min(frameBytes, payload.size() - offset);
+        uint8_t flag = offset == 0 ? (uint8_t) FramePosition::First : 0;
+        if (offset + len >= payload.size()) {
+            flag |= (uint8_t) FramePosition::Last;
+        } else if (offset > 0) {
+            flag = (uint8_t) FramePosition::Middle;
+        }
+
+        std::vector<uint8_t> frame = {(uint8_t) type, flag};
+        frame.insert(frame.end(), payload.begin() + offset, payload.begin() + offset + len);
+        wsClient.queueBinary(frame.data(), frame.size(), 0);
+    }
+}
+
+int main(int argc, char **argv) {
+    size_t rounds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 50;
+    size_t numPatterns = argc > 2 ? strtoul(argv[2], nullptr, 10) : 200;
+    String mmapDirectory = argc > 3 ? argv[3] : "/tmp/stream_bench";
+
+    std::string patternList;
+    char line[64];
+    for (size_t idx = 0; idx < numPatterns; idx++) {
+        snprintf(line, sizeof(line), "pb%014zu\tpattern number %zu\n", idx, idx);
+        patternList += line;
+    }
+    const size_t previewBytes = 8192;
+    const size_t bufferBytes = max(patternList.size(), previewBytes) + 1024;
+
+    std::vector<uint8_t> source(patternList.begin(), patternList.end());
+    std::vector<uint8_t> sink(source.size());
+    String key = "bench";
+    size_t mismatches = 0;
+
+    String previewId = "pb00000000000042";
+    std::string preview = std::string(previewId.c_str()) + '\xFF';
+    for (size_t idx = 0; idx < previewBytes; idx++) {
+        preview += (char) (idx * 7);
+    }
+
+    BenchHarness::printHeader();
+    auto runStreams = [&](const char *backend, PixelblazeBuffer &buffer) {
+        CloseableStream *probe = buffer.makeWriteStream(key, false);
+        if (!probe) {
+            printf("%s: couldn't open a stream\n", backend);
+            mismatches++;
+            return;
+        }
+        delete probe;
+
+        std::string label = std::string(backend) + " bytewise write+read";
+        printResult(measure(label.c_str(), rounds, source.size(), []() {}, [&]() {
+            CloseableStream *out = buffer.makeWriteStream(key, false);
+            for (uint8_t byte: source) {
+                out->write(byte);
+            }
+            delete out;
+
+            CloseableStream *in = buffer.makeReadStream(key);
+            for (size_t idx = 0; idx < sink.size(); idx++) {
+                sink[idx] = (uint8_t) in->read();
+            }
+            delete in;
+        }));
+        mismatches += sink != source;
+
+        label = std::string(backend) + " bulk write+read";
+        printResult(measure(label.c_str(), rounds, source.size(), []() {}, [&]() {
+            CloseableStream *out = buffer.makeWriteStream(key, false);
+            out->write(source.data(), source.size());
+            delete out;
+
+            CloseableStream *in = buffer.makeReadStream(key);
+            in->readBytes(sink.data(), sink.size());
+            delete in;
+        }));
+        mismatches += sink != source;
+
+        //Arena chains are lent a span at a time, so keep borrowing until everything's moved
+        label = std::string(backend) + " borrowed write+read";
+        printResult(measure(label.c_str(), rounds, source.size(), []() {}, [&]() {
+            size_t len;
+            size_t moved = 0;
+            CloseableStream *out = buffer.makeWriteStream(key, false);
+            uint8_t *dest;
+            while (moved < source.size() && (dest = out->borrowWrite(len)) != nullptr) {
+                len = min(len, source.size() - moved);
+                memcpy(dest, source.data() + moved, len);
+                out->commitWrite(len);
+                moved += len;
+            }
+            delete out;
+
+            moved = 0;
+            CloseableStream *in = buffer.makeReadStream(key);
+            const uint8_t *src;
+            while (moved < sink.size() && (src = in->borrowRead(len)) != nullptr) {
+                len = min(len, sink.size() - moved);
+                memcpy(sink.data() + moved, src, len);
+                in->consumeRead(len);
+                moved += len;
+            }
+            delete in;
+        }));
+        mismatches += sink != source;
+        buffer.deleteStreamResults(key);
+    };
+
+    PixelblazeMemBuffer memBuffer(2, bufferBytes);
+    runStreams("mem", memBuffer);
+    PixelblazeArenaBuffer arenaBuffer(2 * bufferBytes);
+    runStreams("arena", arenaBuffer);
+    PixelblazeMmapBuffer mmapBuffer((mmapDirectory + "-streams").c_str());
+    runStreams("mmap", mmapBuffer);
+
+    Serial.mute(true);
+    WebSocketClient wsClient;
+    wsClient.setRecordSent(false);
+    PixelblazeWatcher watcher;
+    auto runClient = [&](const char *backend, PixelblazeBuffer &clientBuffer) {
+        patternsSeen = 0;
+        patternBytesSeen = 0;
+        previewBytesSeen = 0;
+        previewIdSeen = "";
+        PixelblazeClient client(wsClient, clientBuffer, watcher);
+        client.begin();
+
+        std::string label = std::string(backend) + " pattern list";
+        printResult(measure(label.c_str(), rounds, 1, [&]() {
+            client.getPatterns(countPatterns, noFailure);
+            queueMultipart(wsClient, BinaryMsgType::GetProgramList, patternList, 1024);
+        }, [&]() {
+            while (wsClient.pendingInbound() > 0) {
+                client.checkForInbound();
+            }
+        }));
+        mismatches += patternsSeen != rounds * numPatterns || patternBytesSeen != rounds * patternList.size();
+
+        label = std::string(backend) + " preview image";
+        printResult(measure(label.c_str(), rounds, 1, [&]() {
+            client.getPreviewImage(previewId, readPreview, true, noFailure);
+            queueMultipart(wsClient, BinaryMsgType::PreviewImage, preview, 1024);
+        }, [&]() {
+            while (wsClient.pendingInbound() > 0) {
+                client.checkForInbound();
+            }
+        }));
+        mismatches += previewBytesSeen != rounds * previewBytes || previewIdSeen != previewId;
+    };
+
+    PixelblazeMemBuffer clientMemBuffer(4, bufferBytes);
+    runClient("mem", clientMemBuffer);
+    PixelblazeArenaBuffer clientArenaBuffer(4 * bufferBytes);
+    runClient("arena", clientArenaBuffer);
+    PixelblazeMmapBuffer clientMmapBuffer((mmapDirectory + "-client").c_str());
+    runClient("mmap", clientMmapBuffer);
+    Serial.mute(false);
+
+    //Same RAM as the default PixelblazeMemBuffer, filled with replies until one doesn't fit
+    const size_t replySizes[] = {200, 600, 200, 1500, 200, 4000, 200, 15000};
+    std::vector<uint8_t> reply(15000, 0x5A);
+    auto countHeld = [&](PixelblazeBuffer &buffer) {
+        size_t held = 0;
+        for (size_t idx = 0;; idx++) {
+            String replyKey = "reply" + String((int) idx);
+            size_t replyBytes = replySizes[idx % (sizeof(replySizes) / sizeof(replySizes[0]))];
+            CloseableStream *out = buffer.makeWriteStream(replyKey, false);
+            if (!out) {
+                return held;
+            }
+
+            size_t written = out->write(reply.data(), replyBytes);
+            delete out;
+            if (written < replyBytes) {
+                buffer.deleteStreamResults(replyKey);
+                return held;
+            }
+            held++;
+        }
+    };
+
+    PixelblazeMemBuffer defaultMemBuffer;
+    PixelblazeArenaBuffer defaultArenaBuffer(30000, 256, 64);
+    size_t memHeld = countHeld(defaultMemBuffer);
+    size_t arenaHeld = countHeld(defaultArenaBuffer);
+    printf("\nreplies held in 30000 bytes: mem=%zu arena=%zu\n", memHeld, arenaHeld);
+
+    printf("\npatterns=%zu previewBytes=%zu mismatches=%zu\n", patternsSeen, previewBytesSeen, mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+#include <Arduino.h>
+
+#include "PixelblazeClient.h"
+#include "PixelblazeMemBuffer.h"
+
+/**
+ * Drives a PixelblazeClient through the mock WebSocketClient with a short canned conversation. Handy as a starting
+ * point for poking at the client on a workstation, or under perf/valgrind.
+ */
+class PrintingWatcher : public PixelblazeWatcher {
+public:
+    void handleStats(Stats &stats) override {
+        Serial.print(F("Stats: fps="));
+        Serial.print(stats.fps);
+        Serial.print(F(" uptimeMs="));
+        Serial.println(stats.uptimeMs);
+    }
+
+    void handlePatternChange(SequencerState &patternChange) override {
+        Serial.print(F("Pattern change: "));
+        Serial.println(patternChange.name);
+    }
+
+    void handlePreviewFrame(uint8_t *previewPixelRGB, size_t len) override {
+        Serial.print(F("Preview frame bytes: "));
+        Serial.println(len);
+    }
+};
+
+void printSettings(Settings &settings) {
+    Serial.print(F("Settings: name="));
+    Serial.print(settings.name);
+    Serial.print(F(" pixelCount="));
+    Serial.println(settings.pixelCount);
+}
+
+int main() {
+    WebSocketClient wsClient;
+    PixelblazeMemBuffer buffer;
+    PrintingWatcher watcher;
+    PixelblazeClient client(wsClient, buffer, watcher);
+
+    if (!client.begin()) {
+        Serial.println(F("Mock connection refused"));
+        return 1;
+    }
+
+    wsClient.queueText(R"({"fps":59.2,"vmerr":0,"vmerrpc":-1,"mem":10240,"exp":0,"renderType":1,"uptime":123456,)"
+                       R"("storageUsed":1024,"storageSize":2048,"rr0":1,"rr1":0,"rebootCounter":0})");
+    wsClient.queueText(R"({"activeProgram":{"name":"rainbow melt","activeProgramId":"Tx2kdgZ8Ycf3pH3Hp",)"
+                       R"("controls":{"sliderSpeed":0.5}},"sequencerMode":2,"runSequencer":true,)"
+                       R"("playlist":{"position":1,"id":"_defaultplaylist_","ms":30000,"remainingMs":1200}})");
+
+    uint8_t frame[1 + 300 * 3];
+    frame[0] = (uint8_t) BinaryMsgType::PreviewFrame;
+    for (size_t idx = 1; idx < sizeof(frame); idx++) {
+        frame[idx] = (uint8_t) idx;
+    }
+    wsClient.queueBinary(frame, sizeof(frame));
+
+    client.checkForInbound();
+
+    client.getSettings(printSettings);
+    wsClient.queueText(R"({"name":"Pixelblaze_7C9EBD","brandName":"","pixelCount":300,"brightness":0.5,)"
+                       R"("maxBrightness":100,"colorOrder":"GRB","dataSpeed":2000000,"ledType":2,)"
+                       R"("sequenceTimer":15,"transitionDuration":0,"sequencerMode":2,"runSequencer":true,)"
+                       R"("simpleUiMode":false,"learningUiMode":false,"discoveryEnable":true,)"
+                       R"("timezone":"America/Los_Angeles","autoOffEnable":false,"autoOffStart":"00:00",)"
+                       R"("autoOffEnd":"00:00","cpuSpeed":240,"networkPowerSave":false,"mapperFit":0,)"
+                       R"("leaderId":0,"nodeId":0,"soundSrc":0,"accelSrc":0,"lightSrc":0,"analogSrc":0,)"
+                       R"("exp":0,"ver":"3.40","chipId":8216253})");
+    client.checkForInbound();
+
+    Serial.print(F("Frames sent: "));
+    Serial.println(wsClient.stats().framesSent);
+
+    return 0;
+}
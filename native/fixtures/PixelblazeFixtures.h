@@ -0,0 +1,158 @@
+#ifndef PixelblazeFixtures_h
+#define PixelblazeFixtures_h
+
+#include <string>
+#include <vector>
+
+#include "PixelblazeCommon.h"
+
+/**
+ * Canned Pixelblaze traffic, shaped after captures from a v3 controller running firmware 3.40. Shared by the
+ * benchmarks and the simulated controller so they exercise the same payloads.
+ */
+namespace PixelblazeFixtures {
+
+    static constexpr char STATS_JSON[] =
+            R"({"fps":59.2,"vmerr":0,"vmerrpc":-1,"mem":10240,"exp":0,"renderType":1,"uptime":123456,)"
+            R"("storageUsed":1024,"storageSize":2048,"rr0":1,"rr1":0,"rebootCounter":0})";
+
+    static constexpr char SETTINGS_JSON[] =
+            R"({"name":"Pixelblaze_7C9EBD","brandName":"","pixelCount":300,"brightness":0.5,)"
+            R"("maxBrightness":100,"colorOrder":"GRB","dataSpeed":2000000,"ledType":2,)"
+            R"("sequenceTimer":15,"transitionDuration":0,"sequencerMode":2,"runSequencer":true,)"
+            R"("simpleUiMode":false,"learningUiMode":false,"discoveryEnable":true,)"
+            R"("timezone":"America/Los_Angeles","autoOffEnable":false,"autoOffStart":"00:00",)"
+            R"("autoOffEnd":"00:00","cpuSpeed":240,"networkPowerSave":false,"mapperFit":0,)"
+            R"("leaderId":0,"nodeId":0,"soundSrc":0,"accelSrc":0,"lightSrc":0,"analogSrc":0,)"
+            R"("exp":0,"ver":"3.40","chipId":8216253})";
+
+    static constexpr char SEQUENCER_JSON[] =
+            R"({"activeProgram":{"name":"rainbow melt","activeProgramId":"Tx2kdgZ8Ycf3pH3Hp",)"
+            R"("controls":{"sliderSpeed":0.5,"sliderScale":0.25,"hsvPickerColor":0.75}},)"
+            R"("sequencerMode":2,"runSequencer":true,)"
+            R"("playlist":{"position":1,"id":"_defaultplaylist_","ms":30000,"remainingMs":1200}})";
+
+    static constexpr char ACK_JSON[] = R"({"ack":1})";
+
+    /**
+     * @return a stats payload with the given uptime, so consecutive stats frames differ like they do on a device
+     */
+    inline std::string statsJson(uint32_t uptimeMs, float fps = 59.2f) {
+        char buf[320];
+        snprintf(buf, sizeof(buf),
+                 R"({"fps":%.1f,"vmerr":0,"vmerrpc":-1,"mem":10240,"exp":0,"renderType":1,"uptime":%u,)"
+                 R"("storageUsed":1024,"storageSize":2048,"rr0":1,"rr1":0,"rebootCounter":0})",
+                 fps, uptimeMs);
+        return buf;
+    }
+
+    /**
+     * @return the 16 character pattern id the fixtures use for pattern number idx
+     */
+    inline std::string patternId(size_t idx) {
+        char buf[24];
+        snprintf(buf, sizeof(buf), "pb%014zu", idx);
+        return buf;
+    }
+
+    inline std::string sequencerJson(const std::string &patternId, const std::string &name, int playlistPos) {
+        return R"({"activeProgram":{"name":")" + name + R"(","activeProgramId":")" + patternId
+               + R"(","controls":{"sliderSpeed":0.5,"sliderScale":0.25,"hsvPickerColor":0.75}},)"
+               + R"("sequencerMode":2,"runSequencer":true,"playlist":{"position":)" + std::to_string(playlistPos)
+               + R"(,"id":"_defaultplaylist_","ms":30000,"remainingMs":30000}})";
+    }
+
+    inline std::string playlistJson(size_t numItems, int position) {
+        std::string json = R"({"playlist":{"id":"_defaultplaylist_","position":)" + std::to_string(position)
+                           + R"(,"currentIndex":)" + std::to_string(position)
+                           + R"(,"ms":30000,"remainingMs":30000,"items":[)";
+        for (size_t idx = 0; idx < numItems; idx++) {
+            if (idx) {
+                json += ",";
+            }
+            json += R"({"id":")" + patternId(idx) + R"(","ms":30000})";
+        }
+        json += "]}}";
+        return json;
+    }
+
+    /**
+     * @return a binary frame, type and frame position bytes followed by the body
+     */
+    inline std::vector<uint8_t> binaryFrame(BinaryMsgType type, FramePosition position,
+                                            const uint8_t *body, size_t len) {
+        std::vector<uint8_t> frame;
+        frame.reserve(len + 2);
+        frame.push_back((uint8_t) type);
+        frame.push_back((uint8_t) position);
+        frame.insert(frame.end(), body, body + len);
+        return frame;
+    }
+
+    /**
+     * @return the tab/newline separated "id\tname\n" body of a GetProgramList reply
+     */
+    inline std::string programListBody(size_t numPatterns) {
+        std::string body;
+        for (size_t idx = 0; idx < numPatterns; idx++) {
+            body += patternId(idx) + "\tpattern number " + std::to_string(idx) + "\n";
+        }
+        return body;
+    }
+
+    /**
+     * Split a GetProgramList body across frames of at most chunkBytes, flagged First, Middle... Last
+     */
+    inline std::vector<std::vector<uint8_t>> programListFrames(size_t numPatterns, size_t chunkBytes) {
+        std::string body = programListBody(numPatterns);
+        std::vector<std::vector<uint8_t>> frames;
+        for (size_t start = 0; start < body.size(); start += chunkBytes) {
+            FramePosition position = start == 0 ? FramePosition::First
+                                                 : (start + chunkBytes >= body.size() ? FramePosition::Last
+                                                                                      : FramePosition::Middle);
+            size_t len = std::min(chunkBytes, body.size() - start);
+            frames.push_back(binaryFrame(BinaryMsgType::GetProgramList, position,
+                                         (const uint8_t *) body.data() + start, len));
+        }
+
+        if (frames.size() == 1) {
+            //Split it so the reply always has a First and Last frame
+            frames.push_back(binaryFrame(BinaryMsgType::GetProgramList, FramePosition::Last, nullptr, 0));
+        }
+        return frames;
+    }
+
+    /**
+     * @return numChannels packed EXPANDER_CHANNEL_BYTE_WIDTH byte channel records
+     */
+    inline std::vector<uint8_t> expanderChannelsBody(size_t numChannels) {
+        std::vector<uint8_t> body;
+        for (size_t idx = 0; idx < numChannels; idx++) {
+            uint16_t pixels = 150;
+            uint16_t startIndex = (uint16_t) (idx * pixels);
+            uint32_t frequency = 800000;
+            body.push_back((uint8_t) idx);
+            body.push_back((uint8_t) ChannelType::WS2812);
+            body.push_back(3);
+            body.push_back(33);
+            body.insert(body.end(), (uint8_t *) &pixels, (uint8_t *) &pixels + 2);
+            body.insert(body.end(), (uint8_t *) &startIndex, (uint8_t *) &startIndex + 2);
+            body.insert(body.end(), (uint8_t *) &frequency, (uint8_t *) &frequency + 4);
+        }
+        return body;
+    }
+
+    /**
+     * @return a PreviewFrame message: the type byte followed by packed RGB, which varies with frameNum
+     */
+    inline std::vector<uint8_t> previewFrame(size_t pixels, size_t frameNum) {
+        std::vector<uint8_t> frame(1 + pixels * 3);
+        frame[0] = (uint8_t) BinaryMsgType::PreviewFrame;
+        for (size_t idx = 0; idx < pixels * 3; idx++) {
+            frame[idx + 1] = (uint8_t) (idx * 7 + frameNum * 3);
+        }
+        return frame;
+    }
+}
+
+#endif
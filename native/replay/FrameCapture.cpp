@@ -0,0 +1,98 @@
+#include "FrameCapture.h"
+
+static const char CAPTURE_MAGIC[4] = {'P', 'B', 'W', 'C'};
+static const uint32_t CAPTURE_VERSION = 1;
+
+static bool putUint32(FILE *file, uint32_t value) {
+    uint8_t bytes[4] = {(uint8_t) value, (uint8_t) (value >> 8), (uint8_t) (value >> 16), (uint8_t) (value >> 24)};
+    return fwrite(bytes, 1, 4, file) == 4;
+}
+
+static bool getUint32(FILE *file, uint32_t &value) {
+    uint8_t bytes[4];
+    if (fread(bytes, 1, 4, file) != 4) {
+        return false;
+    }
+
+    value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+    return true;
+}
+
+void FrameCapture::onInbound(int type, uint32_t atMs, const uint8_t *payload, size_t len) {
+    if (captured.empty()) {
+        firstAtMs = atMs;
+    }
+
+    captured.push_back(CapturedFrame{type, atMs - firstAtMs, std::vector<uint8_t>(payload, payload + len)});
+}
+
+void FrameCapture::onInboundStart(int messageType, uint32_t atMs, size_t len) {
+    onInbound(messageType, atMs, nullptr, 0);
+    captured.back().payload.reserve(len);
+}
+
+void FrameCapture::onInboundBytes(const uint8_t *bytes, size_t len) {
+    if (!captured.empty()) {
+        captured.back().payload.insert(captured.back().payload.end(), bytes, bytes + len);
+    }
+}
+
+size_t FrameCapture::payloadBytes() const {
+    size_t bytes = 0;
+    for (auto &frame: captured) {
+        bytes += frame.payload.size();
+    }
+
+    return bytes;
+}
+
+bool FrameCapture::save(const char *path) const {
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+
+    bool ok = fwrite(CAPTURE_MAGIC, 1, sizeof(CAPTURE_MAGIC), file) == sizeof(CAPTURE_MAGIC)
+              && putUint32(file, CAPTURE_VERSION);
+    for (size_t idx = 0; ok && idx < captured.size(); idx++) {
+        const CapturedFrame &frame = captured[idx];
+        uint8_t type = (uint8_t) frame.type;
+        ok = fwrite(&type, 1, 1, file) == 1
+             && putUint32(file, frame.atMs)
+             && putUint32(file, (uint32_t) frame.payload.size())
+             && fwrite(frame.payload.data(), 1, frame.payload.size(), file) == frame.payload.size();
+    }
+
+    return fclose(file) == 0 && ok;
+}
+
+bool FrameCapture::load(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    captured.clear();
+    char magic[4];
+    uint32_t version;
+    bool ok = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, CAPTURE_MAGIC, 4) == 0
+              && getUint32(file, version) && version == CAPTURE_VERSION;
+
+    uint8_t type;
+    while (ok && fread(&type, 1, 1, file) == 1) {
+        CapturedFrame frame;
+        uint32_t len;
+        frame.type = type;
+        ok = getUint32(file, frame.atMs) && getUint32(file, len);
+        if (ok) {
+            frame.payload.resize(len);
+            ok = fread(frame.payload.data(), 1, len, file) == len;
+        }
+        if (ok) {
+            captured.push_back(std::move(frame));
+        }
+    }
+
+    fclose(file);
+    return ok;
+}
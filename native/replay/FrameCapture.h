@@ -0,0 +1,53 @@
+#ifndef FrameCapture_h
+#define FrameCapture_h
+
+#include <vector>
+
+#include <Arduino.h>
+#include <WebSocketClient.h>
+
+#include "PixelblazeCommon.h"
+
+struct CapturedFrame {
+    int type;
+    //Relative to the first captured frame
+    uint32_t atMs;
+    std::vector<uint8_t> payload;
+};
+
+/**
+ * Inbound websocket traffic with arrival times, captured from a PixelblazeClient with setInboundObserver(), which
+ * works against any transport, or from the mock WebSocketClient with setTap(), and saved for replay_bench to push back
+ * through checkForInbound().
+ *
+ * File layout, little endian: "PBWC", a uint32 version, then per frame a type byte, uint32 arrival ms, uint32 length
+ * and the payload.
+ */
+class FrameCapture : public WebSocketTap, public InboundObserver {
+public:
+    void onInbound(int type, uint32_t atMs, const uint8_t *payload, size_t len) override;
+
+    void onInboundStart(int messageType, uint32_t atMs, size_t len) override;
+
+    void onInboundBytes(const uint8_t *bytes, size_t len) override;
+
+    bool save(const char *path) const;
+
+    bool load(const char *path);
+
+    const std::vector<CapturedFrame> &frames() const {
+        return captured;
+    }
+
+    size_t payloadBytes() const;
+
+    void clear() {
+        captured.clear();
+    }
+
+private:
+    std::vector<CapturedFrame> captured;
+    uint32_t firstAtMs = 0;
+};
+
+#endif
@@ -0,0 +1,217 @@
+#include <chrono>
+#include <thread>
+
+#include <Arduino.h>
+
+#include "PixelblazeClient.h"
+#include "PixelblazeMemBuffer.h"
+
+#include "BenchHarness.h"
+#include "FrameCapture.h"
+
+/**
+ * Replays a capture of inbound websocket traffic, as written by load_test --capture, through
+ * PixelblazeClient::checkForInbound() and reports throughput and allocations, so dispatch changes can be compared on
+ * a fixed, realistic message mix.
+ *
+ * By default frames are delivered as fast as checkForInbound() drains them, with the shim clock stepped to each
+ * frame's capture time so timeouts behave as they did live. With --realtime they're delivered on the wall clock at
+ * their captured offsets.
+ *
+ * Replies only reach their handlers if something asked for them, so with --requests the request each reply answers is
+ * issued just before the reply is delivered. Without it replies go down the unrequested paths.
+ *
+ * Usage: replay_bench capture [--realtime] [--requests] [--repeat n]
+ */
+
+using BenchHarness::measure;
+using BenchHarness::printResult;
+
+class CountingWatcher : public PixelblazeWatcher {
+public:
+    void handleStats(Stats &stats) override {
+        statsSeen++;
+    }
+
+    void handlePatternChange(SequencerState &patternChange) override {
+        patternChangesSeen++;
+    }
+
+    void handlePreviewFrame(uint8_t *previewPixelRGB, size_t len) override {
+        previewFramesSeen++;
+    }
+
+    size_t statsSeen = 0;
+    size_t patternChangesSeen = 0;
+    size_t previewFramesSeen = 0;
+};
+
+static size_t repliesSeen = 0;
+static size_t failures = 0;
+
+static void countFailure(FailureCause cause) {
+    failures++;
+}
+
+static void countSettings(Settings &settings) {
+    repliesSeen++;
+}
+
+static void countPlaylist(Playlist &playlist) {
+    repliesSeen++;
+}
+
+static void countPing(uint32_t roundtripMs) {
+    repliesSeen++;
+}
+
+static void countPeers(Peer *peers, size_t numPeers) {
+    repliesSeen++;
+}
+
+static void countPatterns(AllPatternIterator &iterator) {
+    PatternIdentifiers identifiers;
+    while (iterator.next(identifiers)) {}
+    repliesSeen++;
+}
+
+static void countExpander(ExpanderChannel *channels, size_t numChannels) {
+    repliesSeen++;
+}
+
+static void countPreviewImage(String &patternId, CloseableStream *stream) {
+    while (stream->read() >= 0) {}
+    repliesSeen++;
+}
+
+static bool startsWithKey(const CapturedFrame &frame, const char *key) {
+    //Every reply we care about is a JSON object with its telltale key first
+    size_t keyLen = strlen(key);
+    const uint8_t *payload = frame.payload.data();
+    return frame.payload.size() > keyLen + 2 && payload[0] == '{' && payload[1] == '"'
+           && memcmp(payload + 2, key, keyLen) == 0 && payload[2 + keyLen] == '"';
+}
+
+/**
+ * Issue the request a captured frame is the (first part of the) reply to, if it's a reply at all
+ */
+static void requestFor(PixelblazeClient &client, const CapturedFrame &frame) {
+    if (frame.type == WebSocketClient::TYPE_TEXT) {
+        if (startsWithKey(frame, "name") && strstr((const char *) frame.payload.data(), "\"pixelCount\"")) {
+            client.getSettings(countSettings, countFailure);
+        } else if (startsWithKey(frame, "playlist")) {
+            client.getPlaylist(countPlaylist, defaultPlaylist, countFailure);
+        } else if (startsWithKey(frame, "ack")) {
+            client.ping(countPing, countFailure);
+        } else if (startsWithKey(frame, "peers")) {
+            client.getPeers(countPeers, countFailure);
+        }
+        return;
+    }
+
+    if (frame.payload.size() < 2 || frame.payload[1] != (uint8_t) FramePosition::First) {
+        return;
+    }
+
+    switch ((BinaryMsgType) frame.payload[0]) {
+        case BinaryMsgType::GetProgramList:
+            client.getPatterns(countPatterns, countFailure);
+            break;
+        case BinaryMsgType::ExpanderChannels:
+            client.getExpanderConfig(countExpander, countFailure);
+            break;
+        case BinaryMsgType::PreviewImage: {
+            const uint8_t *body = frame.payload.data() + 2;
+            const uint8_t *idEnd = (const uint8_t *) memchr(body, 0xFF, frame.payload.size() - 2);
+            if (idEnd) {
+                String patternId((const char *) body, idEnd - body);
+                client.getPreviewImage(patternId, countPreviewImage, true, countFailure);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *path = nullptr;
+    bool realtime = false;
+    bool issueRequests = false;
+    size_t repeat = 1;
+    for (int idx = 1; idx < argc; idx++) {
+        String arg = argv[idx];
+        if (arg == "--realtime") {
+            realtime = true;
+        } else if (arg == "--requests") {
+            issueRequests = true;
+        } else if (arg == "--repeat" && idx + 1 < argc) {
+            repeat = max((size_t) 1, (size_t) strtoul(argv[++idx], nullptr, 10));
+        } else {
+            path = argv[idx];
+        }
+    }
+
+    FrameCapture capture;
+    if (!path || !capture.load(path)) {
+        fprintf(stderr, "usage: replay_bench capture [--realtime] [--requests] [--repeat n]\n");
+        return 1;
+    }
+
+    const std::vector<CapturedFrame> &frames = capture.frames();
+    size_t textFrames = 0;
+    for (auto &frame: frames) {
+        textFrames += frame.type == WebSocketClient::TYPE_TEXT;
+    }
+    uint32_t spanMs = frames.empty() ? 0 : frames.back().atMs;
+    printf("%zu frames (%zu text, %zu binary), %zu payload bytes over %ums\n\n", frames.size(), textFrames,
+           frames.size() - textFrames, capture.payloadBytes(), spanMs);
+
+    Serial.mute(true);
+    ArduinoShim::useManualClock(!realtime);
+
+    WebSocketClient wsClient;
+    wsClient.setRecordSent(false);
+    PixelblazeMemBuffer buffer(4, 16384);
+    CountingWatcher watcher;
+    ClientConfig clientConfig;
+    clientConfig.replyQueueSize = 64;
+    PixelblazeClient client(wsClient, buffer, watcher, clientConfig);
+    client.begin();
+
+    //Frames are queued untimed, only request dispatch and checkForInbound() are measured
+    uint32_t baseMs = 0;
+    BenchHarness::printHeader();
+    printResult(measure(realtime ? "replay realtime" : "replay", repeat, frames.size(), [&]() {
+        baseMs = millis() + 1;
+        for (auto &frame: frames) {
+            wsClient.queueFrame(MockWebSocketFrame{frame.type, frame.payload, baseMs + frame.atMs});
+        }
+    }, [&]() {
+        size_t next = 0;
+        while (next < frames.size()) {
+            if (realtime) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            } else {
+                ArduinoShim::setMillis(baseMs + frames[next].atMs);
+            }
+
+            while (next < frames.size() && (int32_t) (millis() - (baseMs + frames[next].atMs)) >= 0) {
+                if (issueRequests) {
+                    requestFor(client, frames[next]);
+                }
+                next++;
+            }
+
+            client.checkForInbound();
+        }
+
+        while (wsClient.pendingInbound() > 0) {
+            client.checkForInbound();
+        }
+    }));
+
+    printf("\nstats=%zu patternChanges=%zu previewFrames=%zu replies=%zu failures=%zu\n",
+           watcher.statsSeen, watcher.patternChangesSeen, watcher.previewFramesSeen, repliesSeen, failures);
+    return 0;
+}
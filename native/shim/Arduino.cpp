@@ -0,0 +1,92 @@
+#include "Arduino.h"
+
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+
+static bool manualClock = false;
+static uint32_t manualMillis = 0;
+
+static uint64_t monotonicMicros() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint32_t millis() {
+    if (manualClock) {
+        return manualMillis;
+    }
+
+    return (uint32_t) (monotonicMicros() / 1000);
+}
+
+uint32_t micros() {
+    if (manualClock) {
+        return manualMillis * 1000;
+    }
+
+    return (uint32_t) monotonicMicros();
+}
+
+void delay(uint32_t ms) {
+    if (manualClock) {
+        manualMillis += ms;
+    } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+}
+
+long random(long howBig) {
+    if (howBig <= 0) {
+        return 0;
+    }
+
+    return random() % howBig;
+}
+
+long random(long howSmall, long howBig) {
+    if (howSmall >= howBig) {
+        return howSmall;
+    }
+
+    return random(howBig - howSmall) + howSmall;
+}
+
+void randomSeed(unsigned long seed) {
+    srandom(seed);
+}
+
+void ArduinoShim::useManualClock(bool manual) {
+    if (manual && !manualClock) {
+        manualMillis = millis();
+    }
+
+    manualClock = manual;
+}
+
+bool ArduinoShim::isManualClock() {
+    return manualClock;
+}
+
+void ArduinoShim::setMillis(uint32_t ms) {
+    manualMillis = ms;
+}
+
+void ArduinoShim::advanceMillis(uint32_t ms) {
+    manualMillis += ms;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    if (!isMuted) {
+        fputc(c, stderr);
+    }
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+    if (!isMuted) {
+        fwrite(buffer, 1, size, stderr);
+    }
+    return size;
+}
@@ -0,0 +1,97 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+
+/**
+ * Host shim for the parts of the Arduino core this library touches, so it can be built, profiled and exercised on
+ * a workstation. Mirrors the ESP32 core where the cores differ.
+ */
+
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+#define constrain(amt, low, high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+using std::min;
+using std::max;
+
+uint32_t millis();
+
+uint32_t micros();
+
+void delay(uint32_t ms);
+
+long random(long howBig);
+
+long random(long howSmall, long howBig);
+
+void randomSeed(unsigned long seed);
+
+/**
+ * The host clock runs off the monotonic system clock by default. Simulations and replays can switch it to a manual
+ * clock that only moves when told to, in which case delay() advances it instead of sleeping.
+ */
+namespace ArduinoShim {
+    void useManualClock(bool manual);
+
+    bool isManualClock();
+
+    void setMillis(uint32_t ms);
+
+    void advanceMillis(uint32_t ms);
+}
+
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud) {}
+
+    void end() {}
+
+    explicit operator bool() const {
+        return true;
+    }
+
+    size_t write(uint8_t c) override;
+
+    size_t write(const uint8_t *buffer, size_t size) override;
+
+    using Print::write;
+
+    int available() override {
+        return 0;
+    }
+
+    int read() override {
+        return -1;
+    }
+
+    int peek() override {
+        return -1;
+    }
+
+    /**
+     * Log output goes to stderr unless muted, benchmarks mute it so logging doesn't swamp the measurements.
+     */
+    void mute(bool muted) {
+        isMuted = muted;
+    }
+
+private:
+    bool isMuted = false;
+};
+
+extern HardwareSerial Serial;
+
+#endif
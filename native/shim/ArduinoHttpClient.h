@@ -0,0 +1,6 @@
+#ifndef ArduinoHttpClient_h
+#define ArduinoHttpClient_h
+
+#include "WebSocketClient.h"
+
+#endif
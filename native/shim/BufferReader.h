@@ -0,0 +1,43 @@
+#ifndef BufferReader_h
+#define BufferReader_h
+
+#include "Arduino.h"
+
+/**
+ * Host stand-in for BufferUtils' BufferReader, reading little-endian values sequentially out of a byte buffer
+ */
+class BufferReader {
+public:
+    BufferReader(const uint8_t *buffer, size_t size, size_t offset = 0)
+            : buffer(buffer), size(size), offset(offset) {}
+
+    BufferReader(const BufferReader &) = delete;
+
+    BufferReader &operator=(const BufferReader &) = delete;
+
+    template<typename T>
+    size_t read(T &value) {
+        if (offset + sizeof(T) > size) {
+            return 0;
+        }
+
+        memcpy(&value, buffer + offset, sizeof(T));
+        offset += sizeof(T);
+        return sizeof(T);
+    }
+
+    size_t getOffset() const {
+        return offset;
+    }
+
+    size_t getSize() const {
+        return size;
+    }
+
+private:
+    const uint8_t *buffer;
+    size_t size;
+    size_t offset;
+};
+
+#endif
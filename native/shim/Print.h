@@ -0,0 +1,95 @@
+#ifndef Print_h
+#define Print_h
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "WString.h"
+
+/**
+ * Host stand-in for the Arduino Print interface. Numbers are formatted the way the Arduino core does, in base 10.
+ */
+class Print {
+public:
+    virtual ~Print() = default;
+
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+        size_t written = 0;
+        while (written < size && write(buffer[written])) {
+            written++;
+        }
+        return written;
+    }
+
+    size_t write(const char *str) {
+        return str ? write((const uint8_t *) str, strlen(str)) : 0;
+    }
+
+    size_t write(const char *buffer, size_t size) {
+        return write((const uint8_t *) buffer, size);
+    }
+
+    virtual void flush() {}
+
+    size_t print(const __FlashStringHelper *fstr) {
+        return write(reinterpret_cast<const char *>(fstr));
+    }
+
+    size_t print(const String &s) {
+        return write(s.c_str(), s.length());
+    }
+
+    size_t print(const char *str) {
+        return write(str);
+    }
+
+    size_t print(char c) {
+        return write((uint8_t) c);
+    }
+
+    size_t print(int v) {
+        return printFormatted("%d", v);
+    }
+
+    size_t print(unsigned int v) {
+        return printFormatted("%u", v);
+    }
+
+    size_t print(long v) {
+        return printFormatted("%ld", v);
+    }
+
+    size_t print(unsigned long v) {
+        return printFormatted("%lu", v);
+    }
+
+    size_t print(double v, int decimals = 2) {
+        char tmp[40];
+        int len = snprintf(tmp, sizeof(tmp), "%.*f", decimals, v);
+        return write(tmp, len > 0 ? (size_t) len : 0);
+    }
+
+    size_t println() {
+        return write("\r\n");
+    }
+
+    template<typename T>
+    size_t println(const T &v) {
+        size_t n = print(v);
+        return n + println();
+    }
+
+private:
+    template<typename T>
+    size_t printFormatted(const char *fmt, T v) {
+        char tmp[24];
+        int len = snprintf(tmp, sizeof(tmp), fmt, v);
+        return write(tmp, len > 0 ? (size_t) len : 0);
+    }
+};
+
+#endif
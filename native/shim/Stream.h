@@ -0,0 +1,56 @@
+#ifndef Stream_h
+#define Stream_h
+
+#include "Print.h"
+
+/**
+ * Host stand-in for the Arduino Stream interface. As on the ESP32 core, readBytes() is virtual so implementations
+ * can override it with bulk copies. Reads never block: there's nothing to wait for on the host.
+ */
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+
+    virtual int read() = 0;
+
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeoutMs) {
+        timeout = timeoutMs;
+    }
+
+    unsigned long getTimeout() const {
+        return timeout;
+    }
+
+    virtual size_t readBytes(char *buffer, size_t length) {
+        size_t count = 0;
+        while (count < length) {
+            int c = read();
+            if (c < 0) {
+                break;
+            }
+            buffer[count++] = (char) c;
+        }
+        return count;
+    }
+
+    virtual size_t readBytes(uint8_t *buffer, size_t length) {
+        return readBytes((char *) buffer, length);
+    }
+
+    virtual String readString() {
+        String ret;
+        int c = read();
+        while (c >= 0) {
+            ret += (char) c;
+            c = read();
+        }
+        return ret;
+    }
+
+protected:
+    unsigned long timeout = 1000;
+};
+
+#endif
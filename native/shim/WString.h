@@ -0,0 +1,225 @@
+#ifndef WString_h
+#define WString_h
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+class __FlashStringHelper;
+
+/**
+ * Host stand-in for the Arduino String class, backed by std::string. Only covers the surface used by this library
+ * and by ArduinoJson's Arduino String support.
+ */
+class String {
+public:
+    String(const char *cstr = "") : buf(cstr ? cstr : "") {}
+
+    String(const char *cstr, size_t len) : buf(cstr ? std::string(cstr, len) : std::string()) {}
+
+    String(const __FlashStringHelper *fstr) : String(reinterpret_cast<const char *>(fstr)) {}
+
+    String(const String &other) = default;
+
+    String(String &&other) noexcept = default;
+
+    explicit String(char c) : buf(1, c) {}
+
+    explicit String(int v) : buf(std::to_string(v)) {}
+
+    explicit String(unsigned int v) : buf(std::to_string(v)) {}
+
+    explicit String(long v) : buf(std::to_string(v)) {}
+
+    explicit String(unsigned long v) : buf(std::to_string(v)) {}
+
+    explicit String(float v, unsigned int decimals = 2) : String((double) v, decimals) {}
+
+    explicit String(double v, unsigned int decimals = 2) {
+        char tmp[33];
+        snprintf(tmp, sizeof(tmp), "%.*f", (int) decimals, v);
+        buf = tmp;
+    }
+
+    String &operator=(const String &other) = default;
+
+    String &operator=(String &&other) noexcept = default;
+
+    String &operator=(const char *cstr) {
+        buf = cstr ? cstr : "";
+        return *this;
+    }
+
+    const char *c_str() const {
+        return buf.c_str();
+    }
+
+    unsigned int length() const {
+        return buf.length();
+    }
+
+    unsigned char reserve(unsigned int size) {
+        buf.reserve(size);
+        return 1;
+    }
+
+    unsigned char concat(const String &str) {
+        buf += str.buf;
+        return 1;
+    }
+
+    unsigned char concat(const char *cstr) {
+        if (!cstr) {
+            return 0;
+        }
+        buf += cstr;
+        return 1;
+    }
+
+    unsigned char concat(const char *cstr, unsigned int len) {
+        if (!cstr) {
+            return 0;
+        }
+        buf.append(cstr, len);
+        return 1;
+    }
+
+    unsigned char concat(char c) {
+        buf += c;
+        return 1;
+    }
+
+    String &operator+=(const String &rhs) {
+        concat(rhs);
+        return *this;
+    }
+
+    String &operator+=(const char *rhs) {
+        concat(rhs);
+        return *this;
+    }
+
+    String &operator+=(char rhs) {
+        concat(rhs);
+        return *this;
+    }
+
+    bool equals(const String &other) const {
+        return buf == other.buf;
+    }
+
+    bool equals(const char *cstr) const {
+        return cstr ? buf == cstr : buf.empty();
+    }
+
+    bool operator==(const String &rhs) const {
+        return equals(rhs);
+    }
+
+    bool operator==(const char *rhs) const {
+        return equals(rhs);
+    }
+
+    bool operator!=(const String &rhs) const {
+        return !equals(rhs);
+    }
+
+    bool operator!=(const char *rhs) const {
+        return !equals(rhs);
+    }
+
+    bool operator<(const String &rhs) const {
+        return buf < rhs.buf;
+    }
+
+    bool startsWith(const String &prefix) const {
+        return buf.compare(0, prefix.buf.length(), prefix.buf) == 0;
+    }
+
+    bool endsWith(const String &suffix) const {
+        return buf.length() >= suffix.buf.length()
+               && buf.compare(buf.length() - suffix.buf.length(), suffix.buf.length(), suffix.buf) == 0;
+    }
+
+    char charAt(unsigned int idx) const {
+        return idx < buf.length() ? buf[idx] : 0;
+    }
+
+    void setCharAt(unsigned int idx, char c) {
+        if (idx < buf.length()) {
+            buf[idx] = c;
+        }
+    }
+
+    char operator[](unsigned int idx) const {
+        return charAt(idx);
+    }
+
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t found = buf.find(c, from);
+        return found == std::string::npos ? -1 : (int) found;
+    }
+
+    String substring(unsigned int from) const {
+        return from < buf.length() ? String(buf.c_str() + from) : String();
+    }
+
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) {
+            std::swap(from, to);
+        }
+        if (from >= buf.length()) {
+            return {};
+        }
+        return {buf.c_str() + from, std::min<size_t>(to, buf.length()) - from};
+    }
+
+    long toInt() const {
+        return strtol(buf.c_str(), nullptr, 10);
+    }
+
+    float toFloat() const {
+        return strtof(buf.c_str(), nullptr);
+    }
+
+private:
+    std::string buf;
+};
+
+/**
+ * Arduino's operator+ returns this type so sums can be chained, ArduinoJson's string adapters reference it by name.
+ */
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String &s) : String(s) {}
+
+    StringSumHelper(const char *p) : String(p) {}
+};
+
+inline StringSumHelper operator+(const StringSumHelper &lhs, const String &rhs) {
+    StringSumHelper sum(lhs);
+    sum.concat(rhs);
+    return sum;
+}
+
+inline StringSumHelper operator+(const String &lhs, const String &rhs) {
+    StringSumHelper sum(lhs);
+    sum.concat(rhs);
+    return sum;
+}
+
+inline StringSumHelper operator+(const String &lhs, const char *rhs) {
+    StringSumHelper sum(lhs);
+    sum.concat(rhs);
+    return sum;
+}
+
+inline StringSumHelper operator+(const char *lhs, const String &rhs) {
+    StringSumHelper sum(lhs);
+    sum.concat(rhs);
+    return sum;
+}
+
+#endif
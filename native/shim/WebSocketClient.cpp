@@ -0,0 +1,114 @@
+#include "WebSocketClient.h"
+
+int WebSocketClient::begin(const char *path) {
+    if (refuseConnections) {
+        isConnected = false;
+        return -1;
+    }
+
+    isConnected = true;
+    if (peer) {
+        peer->onConnect(*this);
+    }
+
+    return 0;
+}
+
+int WebSocketClient::beginMessage(int type) {
+    txType = type;
+    txBuffer.clear();
+    return 0;
+}
+
+size_t WebSocketClient::write(uint8_t c) {
+    counters.writeCalls++;
+    txBuffer.push_back(c);
+    return 1;
+}
+
+size_t WebSocketClient::write(const uint8_t *buffer, size_t size) {
+    counters.writeCalls++;
+    txBuffer.insert(txBuffer.end(), buffer, buffer + size);
+    return size;
+}
+
+int WebSocketClient::endMessage() {
+    if (!isConnected || txType < 0) {
+        return -1;
+    }
+
+    counters.framesSent++;
+    counters.bytesSent += txBuffer.size();
+
+    if (peer) {
+        peer->onMessage(*this, txType, txBuffer.data(), txBuffer.size());
+    }
+
+    if (recordSent) {
+        sent.push_back(MockWebSocketFrame{txType, txBuffer, millis()});
+    }
+
+    txType = -1;
+    return 0;
+}
+
+int WebSocketClient::parseMessage() {
+    if (peer) {
+        peer->poll(*this);
+    }
+
+    //Whatever wasn't read of the previous message is dropped, like the real client flushes it
+    current.clear();
+    readIdx = 0;
+    currentType = -1;
+
+    if (!isConnected || inbound.empty() || inbound.front().deliverAtMs > millis()) {
+        return 0;
+    }
+
+    current.swap(inbound.front().payload);
+    currentType = inbound.front().type;
+    inbound.pop_front();
+
+    counters.framesReceived++;
+    counters.bytesReceived += current.size();
+
+    if (tap) {
+        tap->onInbound(currentType, millis(), current.data(), current.size());
+    }
+
+    return (int) current.size();
+}
+
+int WebSocketClient::read(uint8_t *buffer, size_t size) {
+    size_t toRead = min(size, current.size() - readIdx);
+    if (toRead == 0) {
+        return readIdx < current.size() ? 0 : -1;
+    }
+
+    memcpy(buffer, current.data() + readIdx, toRead);
+    readIdx += toRead;
+    return (int) toRead;
+}
+
+String WebSocketClient::readString() {
+    String ret((const char *) current.data() + readIdx, current.size() - readIdx);
+    readIdx = current.size();
+    return ret;
+}
+
+void WebSocketClient::queueText(const char *text, uint32_t deliverAtMs) {
+    queueText(text, strlen(text), deliverAtMs);
+}
+
+void WebSocketClient::queueText(const char *text, size_t len, uint32_t deliverAtMs) {
+    queueFrame(MockWebSocketFrame{TYPE_TEXT, std::vector<uint8_t>(text, text + len), deliverAtMs});
+}
+
+void WebSocketClient::queueBinary(const uint8_t *payload, size_t len, uint32_t deliverAtMs) {
+    queueFrame(MockWebSocketFrame{TYPE_BINARY, std::vector<uint8_t>(payload, payload + len), deliverAtMs});
+}
+
+void WebSocketClient::queueFrame(MockWebSocketFrame &&frame) {
+    inbound.push_back(std::move(frame));
+}
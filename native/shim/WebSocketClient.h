@@ -0,0 +1,196 @@
+#ifndef WebSocketClient_h
+#define WebSocketClient_h
+
+#include <deque>
+#include <vector>
+
+#include "Arduino.h"
+
+class WebSocketClient;
+
+struct MockWebSocketFrame {
+    int type;
+    std::vector<uint8_t> payload;
+    uint32_t deliverAtMs;
+};
+
+struct MockWebSocketStats {
+    size_t framesSent = 0;
+    size_t bytesSent = 0;
+    size_t writeCalls = 0;
+    size_t framesReceived = 0;
+    size_t bytesReceived = 0;
+};
+
+/**
+ * The far end of a mock connection. Peers see every outbound message and get polled before each inbound message is
+ * parsed, which is where they can push scheduled traffic back through WebSocketClient::queueText()/queueBinary().
+ */
+class WebSocketPeer {
+public:
+    virtual ~WebSocketPeer() = default;
+
+    virtual void onConnect(WebSocketClient &client) {};
+
+    virtual void onMessage(WebSocketClient &client, int type, const uint8_t *payload, size_t len) {};
+
+    virtual void poll(WebSocketClient &client) {};
+};
+
+/**
+ * Sees every inbound message as parseMessage() hands it to the client, with the millis() it was delivered at.
+ */
+class WebSocketTap {
+public:
+    virtual ~WebSocketTap() = default;
+
+    virtual void onInbound(int type, uint32_t atMs, const uint8_t *payload, size_t len) = 0;
+};
+
+/**
+ * In-memory, scriptable stand-in for ArduinoHttpClient's WebSocketClient. It exposes the same message API the
+ * library uses: parseMessage()/messageType() followed by Stream reads of the message body, and
+ * beginMessage()/write()/endMessage() for sends.
+ *
+ * Inbound frames are delivered in FIFO order, each no earlier than its deliverAtMs according to millis(). Outbound
+ * frames are optionally recorded and always forwarded to the attached WebSocketPeer.
+ */
+class WebSocketClient : public Stream {
+public:
+    static const int TYPE_CONTINUATION = 0x0;
+    static const int TYPE_TEXT = 0x1;
+    static const int TYPE_BINARY = 0x2;
+    static const int TYPE_CONNECTION_CLOSE = 0x8;
+    static const int TYPE_PING = 0x9;
+    static const int TYPE_PONG = 0xa;
+
+    WebSocketClient() = default;
+
+    WebSocketClient(const char *serverName, uint16_t serverPort) {};
+
+    int begin(const char *path = "/");
+
+    bool connected() const {
+        return isConnected;
+    }
+
+    void stop() {
+        isConnected = false;
+    }
+
+    int beginMessage(int type);
+
+    size_t write(uint8_t c) override;
+
+    size_t write(const uint8_t *buffer, size_t size) override;
+
+    using Print::write;
+
+    int endMessage();
+
+    int parseMessage();
+
+    int messageType() const {
+        return currentType;
+    }
+
+    bool isFinal() const {
+        return true;
+    }
+
+    int available() override {
+        return (int) (current.size() - readIdx);
+    }
+
+    int read() override {
+        return readIdx < current.size() ? current[readIdx++] : -1;
+    }
+
+    int read(uint8_t *buffer, size_t size);
+
+    int peek() override {
+        return readIdx < current.size() ? current[readIdx] : -1;
+    }
+
+    size_t readBytes(char *buffer, size_t length) override {
+        return (size_t) read((uint8_t *) buffer, length);
+    }
+
+    String readString() override;
+
+    /*
+     * Scripting and inspection, not part of the ArduinoHttpClient API
+     */
+
+    void setPeer(WebSocketPeer *newPeer) {
+        peer = newPeer;
+    }
+
+    void setTap(WebSocketTap *newTap) {
+        tap = newTap;
+    }
+
+    void queueText(const char *text, uint32_t deliverAtMs = 0);
+
+    void queueText(const char *text, size_t len, uint32_t deliverAtMs);
+
+    void queueBinary(const uint8_t *payload, size_t len, uint32_t deliverAtMs = 0);
+
+    void queueFrame(MockWebSocketFrame &&frame);
+
+    size_t pendingInbound() const {
+        return inbound.size();
+    }
+
+    void clearInbound() {
+        inbound.clear();
+    }
+
+    void setConnected(bool connected) {
+        isConnected = connected;
+    }
+
+    void setRefuseConnections(bool refuse) {
+        refuseConnections = refuse;
+    }
+
+    void setRecordSent(bool record) {
+        recordSent = record;
+    }
+
+    const std::vector<MockWebSocketFrame> &sentFrames() const {
+        return sent;
+    }
+
+    void clearSent() {
+        sent.clear();
+    }
+
+    const MockWebSocketStats &stats() const {
+        return counters;
+    }
+
+    void resetStats() {
+        counters = MockWebSocketStats();
+    }
+
+private:
+    WebSocketPeer *peer = nullptr;
+    WebSocketTap *tap = nullptr;
+    bool isConnected = false;
+    bool refuseConnections = false;
+    bool recordSent = true;
+
+    std::deque<MockWebSocketFrame> inbound;
+    std::vector<uint8_t> current;
+    size_t readIdx = 0;
+    int currentType = -1;
+
+    int txType = -1;
+    std::vector<uint8_t> txBuffer;
+    std::vector<MockWebSocketFrame> sent;
+
+    MockWebSocketStats counters;
+};
+
+#endif
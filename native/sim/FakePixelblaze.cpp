@@ -0,0 +1,237 @@
+#include "FakePixelblaze.h"
+
+#include <ArduinoJson.h>
+
+#include "../fixtures/PixelblazeFixtures.h"
+
+using namespace PixelblazeFixtures;
+
+//A device never backfills more than this much missed schedule, it just renders the next frame
+#define MAX_CATCH_UP_MS 1000
+
+FakePixelblaze::FakePixelblaze(FakePixelblazeConfig config) : config(config) {
+    frame.resize(1 + min(config.pixelCount, (size_t) 1024) * 3);
+}
+
+void FakePixelblaze::onConnect(WebSocketClient &client) {
+    rngState = (uint32_t) config.seed;
+    connectedAtMs = millis();
+    nextStatsAtMs = connectedAtMs + config.statsEveryMs;
+    nextPreviewAtMs = connectedAtMs;
+    lastDeliverAtMs = connectedAtMs;
+}
+
+void FakePixelblaze::onMessage(WebSocketClient &client, int type, const uint8_t *payload, size_t len) {
+    if (type == WebSocketClient::TYPE_TEXT) {
+        handleText(client, (const char *) payload, len);
+    } else {
+        //Binary requests are uploads (sources, bytecode, maps), nothing we model
+        counters.unknownRequests++;
+    }
+}
+
+void FakePixelblaze::poll(WebSocketClient &client) {
+    uint32_t now = millis();
+
+    if (config.statsEveryMs > 0) {
+        if ((int32_t) (now - nextStatsAtMs) > MAX_CATCH_UP_MS) {
+            nextStatsAtMs = now;
+        }
+        while ((int32_t) (now - nextStatsAtMs) >= 0) {
+            sendText(client, statsJson(now - connectedAtMs));
+            counters.statsSent++;
+            nextStatsAtMs += config.statsEveryMs;
+        }
+    }
+
+    if (sendUpdates && config.previewFps > 0) {
+        uint32_t intervalMs = max((uint32_t) 1, 1000 / config.previewFps);
+        if ((int32_t) (now - nextPreviewAtMs) > MAX_CATCH_UP_MS) {
+            nextPreviewAtMs = now;
+        }
+        while ((int32_t) (now - nextPreviewAtMs) >= 0) {
+            sendPreviewFrame(client);
+            nextPreviewAtMs += intervalMs;
+        }
+    }
+}
+
+void FakePixelblaze::handleText(WebSocketClient &client, const char *text, size_t len) {
+    DynamicJsonDocument request(2048);
+    if (deserializeJson(request, text, len)) {
+        counters.unknownRequests++;
+        return;
+    }
+
+    counters.requestsHandled++;
+    if (request.containsKey("getConfig")) {
+        sendConfig(client);
+    } else if (request.containsKey("listPrograms")) {
+        sendMultipart(client, BinaryMsgType::GetProgramList, programListBody(config.numPatterns));
+    } else if (request.containsKey("getPlaylist")) {
+        sendText(client, playlistJson(config.playlistItems, (int) (activePattern % config.playlistItems)));
+    } else if (request.containsKey("getPreviewImg")) {
+        std::string body = request["getPreviewImg"].as<const char *>();
+        body += '\xFF';
+        //A 100x150 8-bit JPEG is a few KB, only the SOI marker is real
+        body += "\xFF\xD8";
+        body.append(4096, '\x5A');
+        sendMultipart(client, BinaryMsgType::PreviewImage, body);
+    } else if (request.containsKey("ping")) {
+        sendText(client, ACK_JSON);
+    } else if (request.containsKey("getPeers")) {
+        sendText(client, R"({"peers":[]})");
+    } else {
+        bool known = false;
+        bool patternChanged = false;
+        if (request.containsKey("brightness")) {
+            brightness = request["brightness"];
+            known = true;
+        }
+        if (request.containsKey("maxBrightness")) {
+            maxBrightness = request["maxBrightness"];
+            known = true;
+        }
+        if (request.containsKey("sequencerMode")) {
+            sequencerMode = request["sequencerMode"];
+            known = true;
+        }
+        if (request.containsKey("runSequencer")) {
+            runSequencer = request["runSequencer"];
+            known = true;
+        }
+        if (request.containsKey("sendUpdates")) {
+            sendUpdates = request["sendUpdates"];
+            nextPreviewAtMs = millis();
+            known = true;
+        }
+        if (request.containsKey("setControls") || request.containsKey("pixelCount")) {
+            known = true;
+        }
+        if (request.containsKey("playlist") && request["playlist"].containsKey("position")) {
+            activePattern = request["playlist"]["position"].as<size_t>() % config.playlistItems;
+            patternChanged = true;
+            known = true;
+        }
+        if (request.containsKey("nextProgram")) {
+            activePattern = (activePattern + 1) % config.playlistItems;
+            patternChanged = true;
+            known = true;
+        }
+
+        if (patternChanged) {
+            sendSequencer(client);
+        }
+
+        if (!known) {
+            counters.requestsHandled--;
+            counters.unknownRequests++;
+        }
+    }
+}
+
+void FakePixelblaze::sendConfig(WebSocketClient &client) {
+    std::vector<uint8_t> expanderBody = expanderChannelsBody(config.expanderChannels);
+    std::string expander(expanderBody.begin(), expanderBody.end());
+
+    if (config.expanderChannels > 0 && config.expanderBeforeSettings) {
+        sendMultipart(client, BinaryMsgType::ExpanderChannels, expander);
+    }
+
+    sendText(client, settingsJson());
+    sendSequencer(client);
+
+    if (config.expanderChannels > 0 && !config.expanderBeforeSettings) {
+        sendMultipart(client, BinaryMsgType::ExpanderChannels, expander);
+    }
+}
+
+void FakePixelblaze::sendSequencer(WebSocketClient &client) {
+    size_t patternIdx = activePattern % config.numPatterns;
+    sendText(client, sequencerJson(patternId(patternIdx), "pattern number " + std::to_string(patternIdx),
+                                   (int) activePattern));
+}
+
+std::string FakePixelblaze::settingsJson() const {
+    char buf[1024];
+    snprintf(buf, sizeof(buf),
+             R"({"name":"Pixelblaze_7C9EBD","brandName":"","pixelCount":%zu,"brightness":%.3f,)"
+             R"("maxBrightness":%d,"colorOrder":"GRB","dataSpeed":2000000,"ledType":%d,)"
+             R"("sequenceTimer":15,"transitionDuration":0,"sequencerMode":%d,"runSequencer":%s,)"
+             R"("simpleUiMode":false,"learningUiMode":false,"discoveryEnable":true,)"
+             R"("timezone":"America/Los_Angeles","autoOffEnable":false,"autoOffStart":"00:00",)"
+             R"("autoOffEnd":"00:00","cpuSpeed":240,"networkPowerSave":false,"mapperFit":0,)"
+             R"("leaderId":0,"nodeId":0,"soundSrc":0,"accelSrc":0,"lightSrc":0,"analogSrc":0,)"
+             R"("exp":0,"ver":"3.40","chipId":8216253})",
+             config.pixelCount, brightness, maxBrightness,
+             (int) (config.expanderChannels > 0 ? LedType::OutputExpander : LedType::WS2812_SK6812_NEOPIXEL),
+             sequencerMode, runSequencer ? "true" : "false");
+    return buf;
+}
+
+void FakePixelblaze::sendPreviewFrame(WebSocketClient &client) {
+    for (size_t idx = 1; idx < frame.size(); idx++) {
+        frame[idx] = (uint8_t) (idx * 7 + frameNum * 3);
+    }
+    frameNum++;
+
+    frame[0] = (uint8_t) BinaryMsgType::PreviewFrame;
+    client.queueBinary(frame.data(), frame.size(), deliverAt());
+    counters.binaryFramesSent++;
+    counters.previewFramesSent++;
+}
+
+void FakePixelblaze::sendText(WebSocketClient &client, const std::string &text) {
+    client.queueText(text.data(), text.size(), deliverAt());
+    counters.textFramesSent++;
+}
+
+void FakePixelblaze::sendBinary(WebSocketClient &client, BinaryMsgType type, FramePosition position,
+                                const uint8_t *body, size_t len) {
+    std::vector<uint8_t> message = binaryFrame(type, position, body, len);
+    client.queueBinary(message.data(), message.size(), deliverAt());
+    counters.binaryFramesSent++;
+}
+
+void FakePixelblaze::sendMultipart(WebSocketClient &client, BinaryMsgType type, const std::string &body) {
+    size_t chunk = max((size_t) 1, config.multipartChunkBytes);
+    const auto *bytes = (const uint8_t *) body.data();
+
+    if (body.size() <= chunk) {
+        //The client only completes a reply on a Last frame, so even short replies are split in two
+        sendBinary(client, type, FramePosition::First, bytes, body.size());
+        if (config.interleaveMultipart) {
+            sendPreviewFrame(client);
+        }
+        sendBinary(client, type, FramePosition::Last, nullptr, 0);
+        return;
+    }
+
+    for (size_t start = 0; start < body.size(); start += chunk) {
+        FramePosition position = start == 0 ? FramePosition::First
+                                            : (start + chunk >= body.size() ? FramePosition::Last
+                                                                            : FramePosition::Middle);
+        sendBinary(client, type, position, bytes + start, min(chunk, body.size() - start));
+        if (config.interleaveMultipart && position != FramePosition::Last) {
+            sendPreviewFrame(client);
+        }
+    }
+}
+
+uint32_t FakePixelblaze::deliverAt() {
+    uint32_t at = millis() + config.latencyMs;
+    if (config.latencyJitterMs > 0) {
+        //xorshift32, so jitter doesn't disturb the global random() the client draws buffer ids from
+        rngState ^= rngState << 13;
+        rngState ^= rngState >> 17;
+        rngState ^= rngState << 5;
+        at += rngState % (config.latencyJitterMs + 1);
+    }
+
+    //Frames on one socket arrive in order, jitter can only push later frames back
+    if ((int32_t) (at - lastDeliverAtMs) < 0) {
+        at = lastDeliverAtMs;
+    }
+    lastDeliverAtMs = at;
+    return at;
+}
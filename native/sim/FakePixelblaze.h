@@ -0,0 +1,113 @@
+#ifndef FakePixelblaze_h
+#define FakePixelblaze_h
+
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include <WebSocketClient.h>
+
+#include "PixelblazeCommon.h"
+
+struct FakePixelblazeConfig {
+    size_t pixelCount = 300;
+    size_t numPatterns = 40;
+    size_t playlistItems = 20;
+    size_t expanderChannels = 0;
+    //Preview frames per second while sendUpdates is on, 0 to never send them
+    uint32_t previewFps = 100;
+    uint32_t statsEveryMs = 1000;
+    //Largest body carried by a single binary frame, replies bigger than this are split into First/Middle/Last frames
+    size_t multipartChunkBytes = 1024;
+    //Added to every frame sent back to the client, plus up to latencyJitterMs
+    uint32_t latencyMs = 0;
+    uint32_t latencyJitterMs = 0;
+    //Send the ExpanderChannels frame of a getConfig reply ahead of the settings and sequencer replies
+    bool expanderBeforeSettings = false;
+    //Interleave an unrelated preview frame between the frames of every multipart reply
+    bool interleaveMultipart = false;
+    uint32_t seed = 1;
+};
+
+struct FakePixelblazeStats {
+    size_t requestsHandled = 0;
+    size_t unknownRequests = 0;
+    size_t textFramesSent = 0;
+    size_t binaryFramesSent = 0;
+    size_t previewFramesSent = 0;
+    size_t statsSent = 0;
+};
+
+/**
+ * An in-process stand-in for a Pixelblaze controller. Attach it to the mock WebSocketClient with setPeer() and it
+ * answers the requests PixelblazeClient makes with payloads shaped like a v3's, pushes stats and preview frames on
+ * their own schedules, and keeps enough state (brightness, sequencer, active pattern) for setters to be visible in
+ * later replies.
+ *
+ * Replies are queued on the client with the configured latency. The mock delivers frames in order, so jitter shows up
+ * as head-of-line delay rather than reordering; reordering is injected explicitly by the expander and multipart
+ * options.
+ */
+class FakePixelblaze : public WebSocketPeer {
+public:
+    explicit FakePixelblaze(FakePixelblazeConfig config = FakePixelblazeConfig());
+
+    void onConnect(WebSocketClient &client) override;
+
+    void onMessage(WebSocketClient &client, int type, const uint8_t *payload, size_t len) override;
+
+    void poll(WebSocketClient &client) override;
+
+    const FakePixelblazeStats &stats() const {
+        return counters;
+    }
+
+    float getBrightness() const {
+        return brightness;
+    }
+
+    size_t getActivePattern() const {
+        return activePattern;
+    }
+
+private:
+    void handleText(WebSocketClient &client, const char *text, size_t len);
+
+    void sendText(WebSocketClient &client, const std::string &text);
+
+    void sendBinary(WebSocketClient &client, BinaryMsgType type, FramePosition position,
+                    const uint8_t *body, size_t len);
+
+    void sendMultipart(WebSocketClient &client, BinaryMsgType type, const std::string &body);
+
+    void sendPreviewFrame(WebSocketClient &client);
+
+    void sendConfig(WebSocketClient &client);
+
+    void sendSequencer(WebSocketClient &client);
+
+    std::string settingsJson() const;
+
+    uint32_t deliverAt();
+
+    FakePixelblazeConfig config;
+    FakePixelblazeStats counters;
+
+    float brightness = 1;
+    int maxBrightness = 100;
+    int sequencerMode = (int) SequencerMode::Playlist;
+    bool runSequencer = true;
+    bool sendUpdates = true;
+    size_t activePattern = 0;
+    size_t frameNum = 0;
+
+    uint32_t connectedAtMs = 0;
+    uint32_t nextStatsAtMs = 0;
+    uint32_t nextPreviewAtMs = 0;
+    uint32_t lastDeliverAtMs = 0;
+    uint32_t rngState = 1;
+
+    std::vector<uint8_t> frame;
+};
+
+#endif
@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include <Arduino.h>
+
+#include "PixelblazeClient.h"
+#include "PixelblazeMemBuffer.h"
+
+#include "FakePixelblaze.h"
+#include "FrameCapture.h"
+
+/**
+ * Load and soak test: runs several PixelblazeClients, each against its own FakePixelblaze, issuing the request mix
+ * our controllers see in production at a multiple of the production rate. Reports per-request-type completion,
+ * failures and reply latency.
+ *
+ * By default time is simulated, the shim clock advancing 1ms per step, so an hour soak takes as long as the CPU
+ * needs. With --realtime the wall clock is used and latency includes scheduling noise.
+ *
+ * Every simulated controller interleaves preview frames into multipart replies, and every other one sends the expander
+ * channels of a getConfig reply ahead of its settings.
+ *
+ * With --capture the first client's inbound traffic is saved for replay_bench.
+ *
+ * Usage: load_test [clients] [seconds] [rateMultiplier] [--realtime] [--latency ms] [--jitter ms] [--capture path]
+ */
+
+enum RequestKind {
+    SettingsRequest,
+    SequencerRequest,
+    PlaylistRequest,
+    PatternsRequest,
+    PreviewImageRequest,
+    PingRequest,
+    NumRequestKinds
+};
+
+static const char *REQUEST_NAMES[NumRequestKinds] = {
+        "getSettings", "getSequencerState", "getPlaylist", "getPatterns", "getPreviewImage", "ping"
+};
+
+//Production request interval per kind, divided by the rate multiplier
+static const uint32_t PRODUCTION_INTERVAL_MS[NumRequestKinds] = {500, 500, 10000, 30000, 30000, 3000};
+
+struct KindStats {
+    size_t issued = 0;
+    size_t dispatchFailed = 0;
+    size_t completed = 0;
+    size_t failed[8] = {};
+    std::vector<uint32_t> latenciesMs;
+};
+
+struct Harness {
+    WebSocketClient wsClient;
+    PixelblazeMemBuffer buffer;
+    PixelblazeWatcher watcher;
+    FakePixelblaze device;
+    PixelblazeClient *client = nullptr;
+
+    std::deque<uint32_t> outstanding[NumRequestKinds];
+    uint32_t nextRequestAtMs[NumRequestKinds] = {};
+
+    explicit Harness(FakePixelblazeConfig deviceConfig) : buffer(4, 16384), device(deviceConfig) {}
+};
+
+static KindStats kindStats[NumRequestKinds];
+
+//Handlers are plain function pointers, they find their harness through this while checkForInbound() runs
+static Harness *currentHarness = nullptr;
+
+static void complete(RequestKind kind) {
+    if (currentHarness->outstanding[kind].empty()) {
+        return;
+    }
+
+    kindStats[kind].completed++;
+    kindStats[kind].latenciesMs.push_back(millis() - currentHarness->outstanding[kind].front());
+    currentHarness->outstanding[kind].pop_front();
+}
+
+template<RequestKind kind>
+static void fail(FailureCause cause) {
+    //Failures from evictions during request dispatch happen outside checkForInbound()
+    if (!currentHarness || currentHarness->outstanding[kind].empty()) {
+        return;
+    }
+
+    kindStats[kind].failed[(int) cause % 8]++;
+    currentHarness->outstanding[kind].pop_front();
+}
+
+static void onSettings(Settings &settings) {
+    complete(SettingsRequest);
+}
+
+static void onSequencer(SequencerState &sequencerState) {
+    complete(SequencerRequest);
+}
+
+static void onPlaylist(Playlist &playlist) {
+    complete(PlaylistRequest);
+}
+
+static void onPatterns(AllPatternIterator &iterator) {
+    PatternIdentifiers identifiers;
+    while (iterator.next(identifiers)) {}
+    complete(PatternsRequest);
+}
+
+static void onPreviewImage(String &patternId, CloseableStream *stream) {
+    while (stream->read() >= 0) {}
+    complete(PreviewImageRequest);
+}
+
+static void onPing(uint32_t roundtripMs) {
+    complete(PingRequest);
+}
+
+static bool issue(Harness &harness, RequestKind kind) {
+    PixelblazeClient &client = *harness.client;
+    switch (kind) {
+        case SettingsRequest:
+            return client.getSettings(onSettings, fail<SettingsRequest>);
+        case SequencerRequest:
+            return client.getSequencerState(onSequencer, fail<SequencerRequest>);
+        case PlaylistRequest:
+            return client.getPlaylist(onPlaylist, defaultPlaylist, fail<PlaylistRequest>);
+        case PatternsRequest:
+            return client.getPatterns(onPatterns, fail<PatternsRequest>);
+        case PreviewImageRequest: {
+            static String patternId = "pb00000000000000";
+            return client.getPreviewImage(patternId, onPreviewImage, true, fail<PreviewImageRequest>);
+        }
+        case PingRequest:
+            return client.ping(onPing, fail<PingRequest>);
+        default:
+            return false;
+    }
+}
+
+static uint32_t percentile(std::vector<uint32_t> &values, double pct) {
+    if (values.empty()) {
+        return 0;
+    }
+
+    std::sort(values.begin(), values.end());
+    return values[(size_t) ((values.size() - 1) * pct)];
+}
+
+int main(int argc, char **argv) {
+    size_t numClients = 8;
+    uint32_t seconds = 60;
+    uint32_t multiplier = 10;
+    bool realtime = false;
+    const char *capturePath = nullptr;
+    FakePixelblazeConfig deviceConfig;
+    deviceConfig.latencyMs = 5;
+    deviceConfig.latencyJitterMs = 10;
+    deviceConfig.expanderChannels = 8;
+    deviceConfig.interleaveMultipart = true;
+
+    int positional = 0;
+    for (int idx = 1; idx < argc; idx++) {
+        String arg = argv[idx];
+        if (arg == "--realtime") {
+            realtime = true;
+        } else if (arg == "--latency" && idx + 1 < argc) {
+            deviceConfig.latencyMs = strtoul(argv[++idx], nullptr, 10);
+        } else if (arg == "--jitter" && idx + 1 < argc) {
+            deviceConfig.latencyJitterMs = strtoul(argv[++idx], nullptr, 10);
+        } else if (arg == "--capture" && idx + 1 < argc) {
+            capturePath = argv[++idx];
+        } else if (positional == 0) {
+            numClients = strtoul(argv[idx], nullptr, 10);
+            positional++;
+        } else if (positional == 1) {
+            seconds = strtoul(argv[idx], nullptr, 10);
+            positional++;
+        } else {
+            multiplier = max((uint32_t) 1, (uint32_t) strtoul(argv[idx], nullptr, 10));
+        }
+    }
+
+    deviceConfig.previewFps = 100 * multiplier;
+    deviceConfig.statsEveryMs = max((uint32_t) 1, 1000 / multiplier);
+
+    Serial.mute(true);
+    ArduinoShim::useManualClock(!realtime);
+
+    ClientConfig clientConfig;
+    clientConfig.maxInboundCheckMs = 50;
+
+    FrameCapture capture;
+    std::vector<Harness *> harnesses;
+    for (size_t idx = 0; idx < numClients; idx++) {
+        deviceConfig.seed = idx + 1;
+        deviceConfig.expanderBeforeSettings = idx % 2 == 1;
+        auto *harness = new Harness(deviceConfig);
+        harness->wsClient.setRecordSent(false);
+        harness->wsClient.setPeer(&harness->device);
+        harness->client = new PixelblazeClient(harness->wsClient, harness->buffer, harness->watcher, clientConfig);
+        if (capturePath && idx == 0) {
+            harness->client->setInboundObserver(&capture);
+        }
+        harness->client->begin();
+        for (int kind = 0; kind < NumRequestKinds; kind++) {
+            //Stagger so clients don't all fire in the same millisecond
+            harness->nextRequestAtMs[kind] = millis() + (uint32_t) (idx * 7 + kind * 13) % 100;
+        }
+        harnesses.push_back(harness);
+    }
+
+    auto wallStart = std::chrono::steady_clock::now();
+    uint32_t startMs = millis();
+    while (millis() - startMs < seconds * 1000) {
+        for (Harness *harness: harnesses) {
+            uint32_t now = millis();
+            for (int kind = 0; kind < NumRequestKinds; kind++) {
+                if ((int32_t) (now - harness->nextRequestAtMs[kind]) >= 0) {
+                    harness->nextRequestAtMs[kind] = now + max((uint32_t) 1,
+                                                               PRODUCTION_INTERVAL_MS[kind] / multiplier);
+                    kindStats[kind].issued++;
+                    harness->outstanding[kind].push_back(now);
+                    if (!issue(*harness, (RequestKind) kind)) {
+                        harness->outstanding[kind].pop_back();
+                        kindStats[kind].dispatchFailed++;
+                    }
+                }
+            }
+
+            currentHarness = harness;
+            harness->client->checkForInbound();
+            currentHarness = nullptr;
+        }
+
+        if (realtime) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        } else {
+            ArduinoShim::advanceMillis(1);
+        }
+    }
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    size_t framesReceived = 0;
+    size_t bytesReceived = 0;
+    size_t previewFramesSent = 0;
+    size_t unknownRequests = 0;
+    for (Harness *harness: harnesses) {
+        framesReceived += harness->wsClient.stats().framesReceived;
+        bytesReceived += harness->wsClient.stats().bytesReceived;
+        previewFramesSent += harness->device.stats().previewFramesSent;
+        unknownRequests += harness->device.stats().unknownRequests;
+    }
+
+    printf("clients=%zu simulated=%us multiplier=%ux wall=%.2fs\n", numClients, seconds, multiplier, wallSeconds);
+    printf("frames received=%zu (%.0f/s wall) bytes=%zu previewFramesSent=%zu unknownRequests=%zu\n\n",
+           framesReceived, framesReceived / wallSeconds, bytesReceived, previewFramesSent, unknownRequests);
+    printf("%-18s %9s %9s %9s %9s %9s %9s %8s %8s %8s\n", "request", "issued", "noDispatch", "completed",
+           "timedOut", "interrupt", "otherFail", "p50ms", "p99ms", "maxms");
+    for (int kind = 0; kind < NumRequestKinds; kind++) {
+        KindStats &stats = kindStats[kind];
+        size_t timedOut = stats.failed[(int) FailureCause::TimedOut];
+        size_t interrupted = stats.failed[(int) FailureCause::MultipartReadInterrupted];
+        size_t otherFailures = 0;
+        for (size_t cause = 0; cause < 8; cause++) {
+            otherFailures += stats.failed[cause];
+        }
+        otherFailures -= timedOut + interrupted;
+
+        printf("%-18s %9zu %9zu %9zu %9zu %9zu %9zu %8u %8u %8u\n", REQUEST_NAMES[kind], stats.issued,
+               stats.dispatchFailed, stats.completed, timedOut, interrupted, otherFailures,
+               percentile(stats.latenciesMs, 0.5), percentile(stats.latenciesMs, 0.99),
+               percentile(stats.latenciesMs, 1.0));
+    }
+
+    if (capturePath) {
+        if (capture.save(capturePath)) {
+            printf("\ncaptured %zu frames to %s\n", capture.frames().size(), capturePath);
+        } else {
+            printf("\ncouldn't write capture to %s\n", capturePath);
+        }
+    }
+
+    for (Harness *harness: harnesses) {
+        delete harness->client;
+        delete harness;
+    }
+
+    return 0;
+}
@@ -0,0 +1,362 @@
+#include "PixelblazeArenaBuffer.h"
+
+PixelblazeArenaBuffer::PixelblazeArenaBuffer(size_t arenaBytes, size_t chunkBytes, size_t maxBuffers)
+        : chunkBytes(max(chunkBytes, (size_t) 1)), maxBuffers(max(maxBuffers, (size_t) 1)) {
+    numChunks = (uint16_t) min(arenaBytes / this->chunkBytes, (size_t) FREE_CHUNK - 1);
+    arena = new uint8_t[(size_t) numChunks * this->chunkBytes];
+    nextChunk = new uint16_t[numChunks];
+    for (uint16_t chunk = numChunks; chunk > 0; chunk--) {
+        nextChunk[chunk - 1] = freeList;
+        freeList = chunk - 1;
+    }
+    freeChunks = numChunks;
+
+    entries = new Entry[this->maxBuffers];
+
+    //At most half full, so probe runs stay short
+    size_t indexSlots = 4;
+    while (indexSlots < this->maxBuffers * 2) {
+        indexSlots *= 2;
+    }
+    indexMask = indexSlots - 1;
+    index = new int16_t[indexSlots];
+    for (size_t slot = 0; slot < indexSlots; slot++) {
+        index[slot] = EMPTY_SLOT;
+    }
+}
+
+PixelblazeArenaBuffer::~PixelblazeArenaBuffer() {
+    //Like PixelblazeMemBuffer, any streams still open are about to get hosed
+    delete[] index;
+    delete[] entries;
+    delete[] nextChunk;
+    delete[] arena;
+}
+
+CloseableStream *PixelblazeArenaBuffer::makeWriteStream(String &key, bool append) {
+    int entryIdx = findEntry(key);
+    if (entryIdx >= 0 && !append) {
+        freeChain(entries[entryIdx]);
+    } else if (entryIdx < 0) {
+        entryIdx = createEntry(key);
+        if (entryIdx < 0) {
+            return nullptr;
+        }
+    }
+
+    auto *stream = new ArenaStream(*this, entryIdx, false);
+    return new CloseableStream(stream, nullptr, nullptr, stream);
+}
+
+CloseableStream *PixelblazeArenaBuffer::makeReadStream(String &key) {
+    int entryIdx = findEntry(key);
+    if (entryIdx < 0) {
+        return nullptr;
+    }
+
+    auto *stream = new ArenaStream(*this, entryIdx, true);
+    return new CloseableStream(stream, nullptr, nullptr, stream);
+}
+
+void PixelblazeArenaBuffer::deleteStreamResults(String &key) {
+    bool found;
+    size_t slot = findSlot(key, hashKey(key), found);
+    if (!found) {
+        return;
+    }
+
+    Entry &entry = entries[index[slot]];
+    freeChain(entry);
+    entry.name = "";
+    entry.live = false;
+    index[slot] = DELETED_SLOT;
+}
+
+void PixelblazeArenaBuffer::garbageCollect() {
+    rebuildIndex();
+
+    //Mark free chunks so swaps can tell them from chained ones
+    for (uint16_t chunk = freeList; chunk != NO_CHUNK;) {
+        uint16_t next = nextChunk[chunk];
+        nextChunk[chunk] = FREE_CHUNK;
+        chunk = next;
+    }
+
+    //Walk each chain in turn, swapping its chunks down to the next unplaced position
+    uint16_t placed = 0;
+    for (size_t entryIdx = 0; entryIdx < maxBuffers; entryIdx++) {
+        if (!entries[entryIdx].live) {
+            continue;
+        }
+
+        for (uint16_t chunk = entries[entryIdx].first; chunk != NO_CHUNK; chunk = nextChunk[placed++]) {
+            if (chunk != placed) {
+                swapChunks(chunk, placed);
+            }
+        }
+    }
+
+    freeList = NO_CHUNK;
+    for (uint16_t chunk = numChunks; chunk > placed; chunk--) {
+        nextChunk[chunk - 1] = freeList;
+        freeList = chunk - 1;
+    }
+}
+
+uint32_t PixelblazeArenaBuffer::hashKey(String &key) {
+    //FNV-1a
+    uint32_t hash = 2166136261u;
+    const char *chars = key.c_str();
+    for (size_t idx = 0; idx < key.length(); idx++) {
+        hash = (hash ^ (uint8_t) chars[idx]) * 16777619u;
+    }
+
+    return hash;
+}
+
+size_t PixelblazeArenaBuffer::findSlot(String &key, uint32_t hash, bool &found) const {
+    size_t insertAt = SIZE_MAX;
+    size_t slot = hash & indexMask;
+    //occupiedSlots is kept to half the index, so there's always an empty slot to stop at
+    while (index[slot] != EMPTY_SLOT) {
+        if (index[slot] == DELETED_SLOT) {
+            if (insertAt == SIZE_MAX) {
+                insertAt = slot;
+            }
+        } else if (entries[index[slot]].hash == hash && key.equals(entries[index[slot]].name)) {
+            found = true;
+            return slot;
+        }
+
+        slot = (slot + 1) & indexMask;
+    }
+
+    found = false;
+    return insertAt == SIZE_MAX ? slot : insertAt;
+}
+
+int PixelblazeArenaBuffer::findEntry(String &key) const {
+    bool found;
+    size_t slot = findSlot(key, hashKey(key), found);
+    return found ? index[slot] : -1;
+}
+
+int PixelblazeArenaBuffer::createEntry(String &key) {
+    int entryIdx = -1;
+    for (size_t idx = 0; idx < maxBuffers; idx++) {
+        if (!entries[idx].live) {
+            entryIdx = (int) idx;
+            break;
+        }
+    }
+    if (entryIdx < 0) {
+        return -1;
+    }
+
+    if (occupiedSlots >= (indexMask + 1) / 2) {
+        rebuildIndex();
+    }
+
+    uint32_t hash = hashKey(key);
+    bool found;
+    size_t slot = findSlot(key, hash, found);
+    if (index[slot] == EMPTY_SLOT) {
+        occupiedSlots++;
+    }
+
+    Entry &entry = entries[entryIdx];
+    entry.name = key;
+    entry.hash = hash;
+    entry.first = NO_CHUNK;
+    entry.last = NO_CHUNK;
+    entry.tailFill = 0;
+    entry.used = 0;
+    entry.live = true;
+    index[slot] = (int16_t) entryIdx;
+    return entryIdx;
+}
+
+bool PixelblazeArenaBuffer::growEntry(Entry &entry) {
+    if (freeList == NO_CHUNK) {
+        return false;
+    }
+
+    uint16_t chunk = freeList;
+    freeList = nextChunk[chunk];
+    freeChunks--;
+
+    nextChunk[chunk] = NO_CHUNK;
+    if (entry.last == NO_CHUNK) {
+        entry.first = chunk;
+    } else {
+        nextChunk[entry.last] = chunk;
+    }
+    entry.last = chunk;
+    entry.tailFill = 0;
+    return true;
+}
+
+void PixelblazeArenaBuffer::freeChain(Entry &entry) {
+    uint16_t chunk = entry.first;
+    while (chunk != NO_CHUNK) {
+        uint16_t next = nextChunk[chunk];
+        nextChunk[chunk] = freeList;
+        freeList = chunk;
+        freeChunks++;
+        chunk = next;
+    }
+
+    entry.first = NO_CHUNK;
+    entry.last = NO_CHUNK;
+    entry.tailFill = 0;
+    entry.used = 0;
+}
+
+void PixelblazeArenaBuffer::rebuildIndex() {
+    //Deleted slots only ever lengthen probes, dropping them is all rebuilding is for
+    for (size_t slot = 0; slot <= indexMask; slot++) {
+        index[slot] = EMPTY_SLOT;
+    }
+
+    occupiedSlots = 0;
+    for (size_t entryIdx = 0; entryIdx < maxBuffers; entryIdx++) {
+        if (entries[entryIdx].live) {
+            occupiedSlots++;
+            bool found;
+            size_t slot = findSlot(entries[entryIdx].name, entries[entryIdx].hash, found);
+            index[slot] = (int16_t) entryIdx;
+        }
+    }
+}
+
+void PixelblazeArenaBuffer::swapChunks(uint16_t a, uint16_t b) {
+    //Relabel every reference to either chunk, then trade their contents, so chains stay intact whatever links them
+    for (size_t entryIdx = 0; entryIdx < maxBuffers; entryIdx++) {
+        Entry &entry = entries[entryIdx];
+        if (entry.live) {
+            entry.first = entry.first == a ? b : entry.first == b ? a : entry.first;
+            entry.last = entry.last == a ? b : entry.last == b ? a : entry.last;
+        }
+    }
+    for (uint16_t chunk = 0; chunk < numChunks; chunk++) {
+        uint16_t next = nextChunk[chunk];
+        nextChunk[chunk] = next == a ? b : next == b ? a : next;
+    }
+
+    uint16_t next = nextChunk[a];
+    nextChunk[a] = nextChunk[b];
+    nextChunk[b] = next;
+
+    uint8_t *dataA = chunkData(a);
+    uint8_t *dataB = chunkData(b);
+    for (size_t idx = 0; idx < chunkBytes; idx++) {
+        uint8_t byte = dataA[idx];
+        dataA[idx] = dataB[idx];
+        dataB[idx] = byte;
+    }
+}
+
+ArenaStream::ArenaStream(PixelblazeArenaBuffer &owner, int entryIdx, bool readable)
+        : owner(owner), entry(owner.entries[entryIdx]), readable(readable), readChunk(entry.first),
+          remaining(readable ? entry.used : 0) {}
+
+size_t ArenaStream::write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        size_t space;
+        uint8_t *dest = borrowWrite(space);
+        if (!dest) {
+            break;
+        }
+
+        size_t toWrite = min(space, size - written);
+        memcpy(dest, buffer + written, toWrite);
+        commitWrite(toWrite);
+        written += toWrite;
+    }
+
+    return written;
+}
+
+int ArenaStream::read() {
+    int v = peek();
+    if (v >= 0) {
+        consumeRead(1);
+    }
+
+    return v;
+}
+
+size_t ArenaStream::readBytes(char *buffer, size_t length) {
+    size_t read = 0;
+    while (read < length) {
+        size_t len;
+        const uint8_t *src = borrowRead(len);
+        if (!src) {
+            break;
+        }
+
+        size_t toRead = min(len, length - read);
+        memcpy(buffer + read, src, toRead);
+        consumeRead(toRead);
+        read += toRead;
+    }
+
+    return read;
+}
+
+int ArenaStream::peek() {
+    if (!readable || remaining == 0) {
+        return -1;
+    }
+
+    return owner.chunkData(readChunk)[readOffset];
+}
+
+const uint8_t *ArenaStream::borrowRead(size_t &len) {
+    if (!readable || remaining == 0) {
+        len = 0;
+        return nullptr;
+    }
+
+    //Chunks laid out back to back, as garbageCollect() leaves them, are lent as one span
+    size_t span = owner.chunkBytes - readOffset;
+    uint16_t chunk = readChunk;
+    while (span < remaining && owner.nextChunk[chunk] == chunk + 1) {
+        span += owner.chunkBytes;
+        chunk++;
+    }
+
+    len = min(span, remaining);
+    return owner.chunkData(readChunk) + readOffset;
+}
+
+void ArenaStream::consumeRead(size_t len) {
+    readOffset += len;
+    remaining -= len;
+    while (readOffset >= owner.chunkBytes && readChunk != PixelblazeArenaBuffer::NO_CHUNK) {
+        readOffset -= owner.chunkBytes;
+        readChunk = owner.nextChunk[readChunk];
+    }
+}
+
+uint8_t *ArenaStream::borrowWrite(size_t &len) {
+    len = 0;
+    if (readable) {
+        return nullptr;
+    }
+
+    if (entry.last == PixelblazeArenaBuffer::NO_CHUNK || entry.tailFill == owner.chunkBytes) {
+        if (!owner.growEntry(entry)) {
+            return nullptr;
+        }
+    }
+
+    len = owner.chunkBytes - entry.tailFill;
+    return owner.chunkData(entry.last) + entry.tailFill;
+}
+
+void ArenaStream::commitWrite(size_t len) {
+    entry.tailFill += len;
+    entry.used += len;
+}
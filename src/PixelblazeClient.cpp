@@ -1,11 +1,67 @@
 #include "PixelblazeCommon.h"
 #include "PixelblazeClient.h"
+#include "PixelblazeDecoders.h"
 #include "PixelblazeHandlers.h"
 
 #include <ArduinoJson.h>
 #include <WebSocketClient.h>
 #include <BufferReader.h>
 
+/**
+ * Top level keys of a stats message that are copied into Stats
+ */
+static const char *const STATS_KEYS[] = {
+        "fps", "vmerr", "vmerrpc", "mem", "exp", "renderType", "uptime", "storageUsed", "storageSize", "rr0", "rr1",
+        "rebootCounter"
+};
+
+/**
+ * Requests that never change are sent as these bytes directly, without a trip through ArduinoJson
+ */
+static constexpr char LIST_PROGRAMS_FRAME[] = "{\"listPrograms\":true}";
+static constexpr char NEXT_PROGRAM_FRAME[] = "{\"nextProgram\":true}";
+static constexpr char RUN_SEQUENCER_FRAME[] = "{\"runSequencer\":true}";
+static constexpr char PAUSE_SEQUENCER_FRAME[] = "{\"runSequencer\":false}";
+static constexpr char GET_PEERS_FRAME[] = "{\"getPeers\":1}";
+static constexpr char GET_CONFIG_FRAME[] = "{\"getConfig\":true}";
+static constexpr char PING_FRAME[] = "{\"ping\":true}";
+static constexpr char SEND_UPDATES_FRAME[] = "{\"sendUpdates\":true}";
+static constexpr char STOP_UPDATES_FRAME[] = "{\"sendUpdates\":false}";
+
+/**
+ * Reads the rest of a message for deserializeJson(), showing each byte to an InboundObserver as it goes
+ */
+class ObservedStream : public Stream {
+public:
+    ObservedStream(Stream &wrapped, InboundObserver *observer) : wrapped(wrapped), observer(observer) {};
+
+    int available() override {
+        return wrapped.available();
+    }
+
+    int read() override {
+        int value = wrapped.read();
+        if (observer && value >= 0) {
+            uint8_t byte = value;
+            observer->onInboundBytes(&byte, 1);
+        }
+
+        return value;
+    }
+
+    int peek() override {
+        return wrapped.peek();
+    }
+
+    size_t write(uint8_t c) override {
+        return 0;
+    }
+
+private:
+    Stream &wrapped;
+    InboundObserver *observer;
+};
+
 PixelblazeClient::PixelblazeClient(
         WebSocketClient &wsClient,
         PixelblazeBuffer &streamBuffer,
@@ -13,32 +69,51 @@ PixelblazeClient::PixelblazeClient(
         ClientConfig clientConfig) :
         wsClient(wsClient), streamBuffer(streamBuffer),
         watcher(watcher), clientConfig(clientConfig),
-        json(DynamicJsonDocument(clientConfig.jsonBufferBytes)) {
+        handlerPool(clientConfig.replyQueueSize + MAX_HANDLERS_PER_REQUEST),
+        replyTimeouts(clientConfig.replyQueueSize),
+        json(DynamicJsonDocument(clientConfig.jsonBufferBytes)),
+        jsonFilter(DynamicJsonDocument(clientConfig.jsonFilterBytes)),
+        batchJson(DynamicJsonDocument(clientConfig.batchJsonBytes)),
+        jsonTokenizer(clientConfig.streamTokenBytes) {
 
     byteBuffer = new uint8_t[clientConfig.binaryBufferBytes];
+    if (clientConfig.previewFrameHandoff) {
+        previewExchange = new PreviewFrameExchange(clientConfig.binaryBufferBytes);
+    } else if (clientConfig.coalescePreviewFrames) {
+        previewFrame = new uint8_t[clientConfig.binaryBufferBytes];
+    }
+    if (clientConfig.previewChangeDetection) {
+        previewDiffer = new PreviewFrameDiffer(clientConfig.binaryBufferBytes, clientConfig.previewMaxDirtyRanges,
+                                               clientConfig.previewMergeGapPixels);
+    }
+    if (clientConfig.setterCoalesceWindowMs > 0) {
+        heldControls = new HeldControl[clientConfig.controlLimit];
+    }
+    sendBuffer = new char[clientConfig.sendBufferBytes];
     textReadBuffer = new char[clientConfig.textReadBufferBytes];
+    textFrameBuffer = new char[clientConfig.textFrameBufferBytes];
     expanderChannels = new ExpanderChannel[clientConfig.expanderChannelLimit];
     peers = new Peer[clientConfig.peerLimit];
     controls = new Control[clientConfig.controlLimit];
-    replyQueue = new ReplyHandler *[clientConfig.replyQueueSize];
     sequencerState.controls = new Control[clientConfig.controlLimit];
     playlist.items = new PlaylistItem[clientConfig.playlistLimit];
     playlistUpdate.items = new PlaylistItem[clientConfig.playlistLimit];
 }
 
 PixelblazeClient::~PixelblazeClient() {
-    while (queueLength() > 0) {
-        replyQueue[queueFront]->reportFailure(FailureCause::ClientDestructorCalled);
-        delete replyQueue[queueFront];
-        queueFront = (queueFront + 1) % clientConfig.replyQueueSize;
-    }
+    evictQueue(FailureCause::ClientDestructorCalled);
 
     delete[] byteBuffer;
+    delete[] previewFrame;
+    delete previewExchange;
+    delete previewDiffer;
+    delete[] heldControls;
+    delete[] sendBuffer;
     delete[] textReadBuffer;
+    delete[] textFrameBuffer;
     delete[] expanderChannels;
     delete[] peers;
     delete[] controls;
-    delete[] replyQueue;
     delete[] sequencerState.controls;
     delete[] playlist.items;
     delete[] playlistUpdate.items;
@@ -55,15 +130,17 @@ bool PixelblazeClient::connected() {
 
 bool PixelblazeClient::getPatterns(void (*handler)(AllPatternIterator &), void (*onError)(FailureCause)) {
     String bufferId = String(random());
-    auto *myHandler = new AllPatternsReplyHandler(handler, bufferId, true, onError);
+    auto *myHandler = makeHandler<AllPatternsReplyHandler>(handler, bufferId, true, onError);
+    if (!myHandler) {
+        return false;
+    }
+
     if (!enqueueReply(myHandler)) {
-        delete myHandler;
+        handlerPool.release(myHandler);
         return false;
     }
 
-    json.clear();
-    json["listPrograms"] = true;
-    return sendJson(json);
+    return sendRaw(LIST_PROGRAMS_FRAME);
 }
 
 #ifdef CLOSURES_SUPPORTED
@@ -98,9 +175,13 @@ bool getPatternsSync(void (*handler)(AllPatternIterator &), void (*onError)(Fail
 
 
 bool PixelblazeClient::getPlaylist(void (*handler)(Playlist &), String &playlistName, void (*onError)(FailureCause)) {
-    auto *myHandler = new PlaylistReplyHandler(handler, onError);
+    auto *myHandler = makeHandler<PlaylistReplyHandler>(handler, onError);
+    if (!myHandler) {
+        return false;
+    }
+
     if (!enqueueReply(myHandler)) {
-        delete myHandler;
+        handlerPool.release(myHandler);
         return false;
     }
 
@@ -142,16 +223,18 @@ bool PixelblazeClient::getPlaylistIndex(void (*handler)(size_t), void (*onError)
 }
 
 bool PixelblazeClient::setPlaylistIndex(int idx) {
-    json.clear();
-    JsonObject playlistObj = json.createNestedObject("playlist");
+    if (!batching) {
+        return sendIntFrame("{\"playlist\":{\"position\":", idx, "}}");
+    }
+
+    JsonDocument &doc = setterDoc();
+    JsonObject playlistObj = doc.createNestedObject("playlist");
     playlistObj["position"] = idx;
-    return sendJson(json);
+    return sendSetter(doc);
 }
 
 bool PixelblazeClient::nextPattern() {
-    json.clear();
-    json["nextProgram"] = true;
-    return sendJson(json);
+    return sendRaw(NEXT_PROGRAM_FRAME);
 }
 
 bool PixelblazeClient::prevPattern() {
@@ -192,67 +275,104 @@ bool PixelblazeClient::prevPattern() {
 }
 
 bool PixelblazeClient::playSequence() {
-    json.clear();
-    json["runSequencer"] = true;
-    return sendJson(json);
+    if (!batching) {
+        return sendRaw(RUN_SEQUENCER_FRAME);
+    }
+
+    JsonDocument &doc = setterDoc();
+    doc["runSequencer"] = true;
+    return sendSetter(doc);
 }
 
 bool PixelblazeClient::pauseSequence() {
-    json.clear();
-    json["runSequencer"] = false;
-    return sendJson(json);
+    if (!batching) {
+        return sendRaw(PAUSE_SEQUENCER_FRAME);
+    }
+
+    JsonDocument &doc = setterDoc();
+    doc["runSequencer"] = false;
+    return sendSetter(doc);
 }
 
 bool PixelblazeClient::setSequencerMode(SequencerMode sequencerMode) {
-    json.clear();
-    json["sequencerMode"] = (int) sequencerMode;
-    return sendJson(json);
+    if (!batching) {
+        return sendIntFrame("{\"sequencerMode\":", (int) sequencerMode, "}");
+    }
+
+    JsonDocument &doc = setterDoc();
+    doc["sequencerMode"] = (int) sequencerMode;
+    return sendSetter(doc);
 }
 
 bool PixelblazeClient::getPeers(void (*handler)(Peer *, size_t), void (*onError)(FailureCause)) {
-    auto *myHandler = new PeersReplyHandler(handler, onError);
+    auto *myHandler = makeHandler<PeersReplyHandler>(handler, onError);
+    if (!myHandler) {
+        return false;
+    }
+
     if (!enqueueReply(myHandler)) {
-        delete myHandler;
+        handlerPool.release(myHandler);
         return false;
     }
 
-    json.clear();
-    json["getPeers"] = 1;
-    return sendJson(json);
+    return sendRaw(GET_PEERS_FRAME);
 }
 
 bool PixelblazeClient::setCurrentPatternControls(Control *controls, int numControls, bool saveToFlash) {
-    json.clear();
-    JsonObject controlsObj = json.createNestedObject("setControls");
+    JsonDocument &doc = setterDoc();
+    JsonObject controlsObj = setControlsObj(doc);
     for (int idx = 0; idx < numControls; idx++) {
-        controlsObj[controls[idx].name] = controls[idx].value;
+        HeldControl *held = heldControl(controls[idx].name);
+        if (held && holdSetting(held->setting, controls[idx].value, saveToFlash)) {
+            continue;
+        }
+        putSetterFloat(controlsObj[controls[idx].name], controls[idx].value);
     }
 
-    json["save"] = saveToFlash;
-    return sendJson(json);
+    if (!batching && controlsObj.size() == 0) {
+        //Everything was held
+        return true;
+    }
+
+    return sendSetter(doc, saveToFlash);
 }
 
 bool PixelblazeClient::setCurrentPatternControl(String &controlName, float value, bool saveToFlash) {
-    json.clear();
-    JsonObject controls = json.createNestedObject("setControls");
-    controls[controlName] = value;
-    json["save"] = saveToFlash;
-    return sendJson(json);
+    HeldControl *held = heldControl(controlName);
+    if (held && holdSetting(held->setting, value, saveToFlash)) {
+        return true;
+    }
+
+    JsonDocument &doc = setterDoc();
+    JsonObject controls = setControlsObj(doc);
+    putSetterFloat(controls[controlName], value);
+    return sendSetter(doc, saveToFlash);
 }
 
 bool PixelblazeClient::setBrightness(float brightness, bool saveToFlash) {
-    json.clear();
-    json["brightness"] = constrain(brightness, 0, 1);
-    json["save"] = saveToFlash;
-    return sendJson(json);
+    brightness = constrain(brightness, 0, 1);
+    if (holdSetting(heldBrightness, brightness, saveToFlash)) {
+        return true;
+    }
+
+    return sendBrightness(brightness, saveToFlash);
+}
+
+bool PixelblazeClient::sendBrightness(float brightness, bool saveToFlash) {
+    JsonDocument &doc = setterDoc();
+    putSetterFloat(doc["brightness"], brightness);
+    return sendSetter(doc, saveToFlash);
 }
 
 bool PixelblazeClient::getPatternControls(String &patternId, void (*handler)(String &, Control *, size_t),
                                           void (*onError)(FailureCause)) {
-    auto *myHandler = new PatternControlReplyHandler(handler, onError);
+    auto *myHandler = makeHandler<PatternControlReplyHandler>(handler, onError);
+    if (!myHandler) {
+        return false;
+    }
 
     if (!enqueueReply(myHandler)) {
-        delete myHandler;
+        handlerPool.release(myHandler);
         return false;
     }
 
@@ -316,9 +436,13 @@ bool PixelblazeClient::getCurrentPatternControls(void (*handler)(Control *, size
 
 bool PixelblazeClient::getPreviewImage(String &patternId, void (*handler)(String &, CloseableStream *), bool clean,
                                        void (*onError)(FailureCause)) {
-    auto *myHandler = new PreviewImageReplyHandler(patternId, handler, clean, onError);
+    auto *myHandler = makeHandler<PreviewImageReplyHandler>(patternId, handler, clean, onError);
+    if (!myHandler) {
+        return false;
+    }
+
     if (!enqueueReply(myHandler)) {
-        delete myHandler;
+        handlerPool.release(myHandler);
         return false;
     }
 
@@ -328,10 +452,18 @@ bool PixelblazeClient::getPreviewImage(String &patternId, void (*handler)(String
 }
 
 bool PixelblazeClient::setBrightnessLimit(float value, bool saveToFlash) {
-    json.clear();
-    json["maxBrightness"] = round(constrain(value, 0, 1) * 100);
-    json["save"] = saveToFlash;
-    return sendJson(json);
+    value = constrain(value, 0, 1);
+    if (holdSetting(heldBrightnessLimit, value, saveToFlash)) {
+        return true;
+    }
+
+    return sendBrightnessLimit(value, saveToFlash);
+}
+
+bool PixelblazeClient::sendBrightnessLimit(float value, bool saveToFlash) {
+    JsonDocument &doc = setterDoc();
+    doc["maxBrightness"] = round(value * 100);
+    return sendSetter(doc, saveToFlash);
 }
 
 bool PixelblazeClient::setPixelCount(uint32_t pixels, bool saveToFlash) {
@@ -348,32 +480,37 @@ bool PixelblazeClient::getSystemState(
         int watchResponses,
         void (*onError)(FailureCause)) {
 
-    auto mySettingsHandler = new SettingsReplyHandler(settingsHandler, onError);
+    auto *mySettingsHandler = makeHandler<SettingsReplyHandler>(settingsHandler, onError);
+    auto *mySeqHandler = makeHandler<SequencerReplyHandler>(seqHandler, onError);
+    String bufferId = String(random());
+    auto *myExpanderHandler = makeHandler<ExpanderChannelsReplyHandler>(expanderHandler, bufferId, true, onError);
+    if (!mySettingsHandler || !mySeqHandler || !myExpanderHandler) {
+        handlerPool.release(mySettingsHandler);
+        handlerPool.release(mySeqHandler);
+        handlerPool.release(myExpanderHandler);
+        return false;
+    }
+
     if (!(watchResponses & (int) SettingReply::Settings)) {
         mySettingsHandler->satisfied = true;
     }
 
-    auto *mySeqHandler = new SequencerReplyHandler(seqHandler, onError);
     if (!(watchResponses & (int) SettingReply::Sequencer)) {
         mySeqHandler->satisfied = true;
     }
 
-    String bufferId = String(random());
-    auto *myExpanderHandler = new ExpanderChannelsReplyHandler(expanderHandler, bufferId, true, onError);
     if (!(watchResponses & (int) SettingReply::Expander)) {
         myExpanderHandler->satisfied = true;
     }
 
     if (!enqueueReplies(3, mySettingsHandler, mySeqHandler, myExpanderHandler)) {
-        delete mySettingsHandler;
-        delete mySeqHandler;
-        delete myExpanderHandler;
+        handlerPool.release(mySettingsHandler);
+        handlerPool.release(mySeqHandler);
+        handlerPool.release(myExpanderHandler);
         return false;
     }
 
-    json.clear();
-    json["getConfig"] = true;
-    return sendJson(json);
+    return sendRaw(GET_CONFIG_FRAME);
 }
 
 bool PixelblazeClient::getSettings(void (*settingsHandler)(Settings &), void (*onError)(FailureCause)) {
@@ -390,73 +527,64 @@ PixelblazeClient::getExpanderConfig(void (*expanderHandler)(ExpanderChannel *, s
 }
 
 bool PixelblazeClient::ping(void (*handler)(uint32_t), void (*onError)(FailureCause)) {
-    auto *myHandler = new PingReplyHandler(handler, onError);
+    auto *myHandler = makeHandler<PingReplyHandler>(handler, onError);
+    if (!myHandler) {
+        return false;
+    }
+
     if (!enqueueReply(myHandler)) {
-        delete myHandler;
+        handlerPool.release(myHandler);
         return false;
     }
 
-    json.clear();
-    json["ping"] = true;
-    return sendJson(json);
+    return sendRaw(PING_FRAME);
 }
 
 bool PixelblazeClient::sendFramePreviews(bool sendEm) {
-    json.clear();
-    json["sendUpdates"] = sendEm;
-    return sendJson(json);
+    return sendEm ? sendRaw(SEND_UPDATES_FRAME) : sendRaw(STOP_UPDATES_FRAME);
 }
 
-bool PixelblazeClient::rawRequest(RawBinaryHandler &replyHandler, JsonDocument &request) {
-    auto *myHandler = new RawBinaryHandler(replyHandler);
-    myHandler->requestTsMs = millis();
-    myHandler->satisfied = false;
-
-    if (!enqueueReply(myHandler)) {
-        delete myHandler;
+bool PixelblazeClient::beginBatch() {
+    if (batching) {
         return false;
     }
 
-    return sendJson(request);
+    batchJson.clear();
+    batchSave = false;
+    batching = true;
+    return true;
 }
 
-bool PixelblazeClient::rawRequest(RawTextHandler &replyHandler, JsonDocument &request) {
-    auto *myHandler = new RawTextHandler(replyHandler);
-    myHandler->requestTsMs = millis();
-    myHandler->satisfied = false;
-
-    if (!enqueueReply(myHandler)) {
-        delete myHandler;
+bool PixelblazeClient::commitBatch() {
+    if (!batching) {
+        Serial.println(F("commitBatch() called without beginBatch()"));
         return false;
     }
 
-    return sendJson(request);
-}
-
-bool PixelblazeClient::rawRequest(RawBinaryHandler &replyHandler, int rawBinType, Stream &request) {
-    auto *myHandler = new RawBinaryHandler(replyHandler);
-    myHandler->requestTsMs = millis();
-    myHandler->satisfied = false;
-
-    if (!enqueueReply(myHandler)) {
-        delete myHandler;
+    batching = false;
+    if (batchJson.overflowed()) {
+        Serial.println(F("Batch overflowed batchJsonBytes, dropping it"));
+        batchJson.clear();
         return false;
+    } else if (batchJson.size() == 0) {
+        return true;
     }
 
-    return sendBinary(rawBinType, request);
+    if (batchSave) {
+        batchJson["save"] = true;
+    }
+    bool sent = sendJson(batchJson);
+    batchJson.clear();
+    return sent;
 }
 
-bool PixelblazeClient::rawRequest(RawTextHandler &replyHandler, int rawBinType, Stream &request) {
-    auto *myHandler = new RawTextHandler(replyHandler);
-    myHandler->requestTsMs = millis();
-    myHandler->satisfied = false;
-
-    if (!enqueueReply(myHandler)) {
-        delete myHandler;
-        return false;
-    }
+void PixelblazeClient::abortBatch() {
+    batching = false;
+    batchJson.clear();
+}
 
-    return sendBinary(rawBinType, request);
+bool PixelblazeClient::flushCoalescedSetters() {
+    return sendHeldSettings(true);
 }
 
 bool PixelblazeClient::checkForInbound() {
@@ -478,86 +606,60 @@ bool PixelblazeClient::checkForInbound() {
 //    }
 
     weedExpiredReplies();
+    if (settingsHeld) {
+        sendHeldSettings(false);
+    }
     uint32_t startTime = millis();
 
     int read = wsClient.parseMessage();
     while (read > 0 && startTime + clientConfig.maxInboundCheckMs > millis()) {
+        if (inboundObserver) {
+            inboundObserver->onInboundStart(wsClient.messageType(), millis(), read);
+        }
+
         WebsocketFormat format = websocketFormatFromInt(wsClient.messageType());
         if (format == WebsocketFormat::Unknown) {
             Serial.print("Got unexpected websocket message format: ");
             Serial.println(wsClient.messageType());
 
+            finishInbound();
             read = wsClient.parseMessage();
             continue;
         }
 
-        while (queueLength() > 0 && replyQueue[queueFront]->isSatisfied()) {
-            dequeueReply();
-        }
-
-        if (queueLength() == 0) {
-            //Nothing expected, dispatch everything through unrequested functions
-            if (format == WebsocketFormat::Text) {
-                DeserializationError deErr = deserializeJson(json, wsClient.readString());
-                if (deErr) {
-                    Serial.print(F("Message deserialization error: "));
-                    Serial.println(deErr.f_str());
+        if (format == WebsocketFormat::Text) {
+            if (readJsonFrame()) {
+                //Replies go to the oldest handler that wants them, wherever it sits, so one that never comes can't
+                //hold up the rest
+                ReplyHandler *handler = findTextReply();
+                if (handler) {
+                    dispatchTextReply(handler);
+                    retireReply(handler);
                 } else {
                     handleUnrequestedJson();
                 }
-            } else if (format == WebsocketFormat::Binary && wsClient.available() > 0) {
-                handleUnrequestedBinary(wsClient.read());
-            } else {
-                Serial.print(F("Unexpected reply format: "));
-                Serial.println((int) format);
             }
+        } else if (format == WebsocketFormat::Binary) {
+            readBinaryReply();
         } else {
-            WebsocketFormat soughtFormat = replyQueue[queueFront]->format;
-
-            int repliesExamined = 0;
-            while (repliesExamined <= queueLength()
-                   && soughtFormat == WebsocketFormat::Binary
-                   &&
-                   ((BinaryReplyHandler *) replyQueue[queueFront])->rawBinType == (int) BinaryMsgType::ExpanderChannels
-                   && (format != WebsocketFormat::Binary || wsClient.peek() != (int) BinaryMsgType::ExpanderChannels)) {
-                //Expander configs can be non-optionally fetched by getConfig, and may never come if no expander is installed.
-                //If the head of the queue is seeking them and the current message isn't one, bump it to the back of the queue.
-                //This does require special handling in handleUnrequestedBinary(). If it's the only thing in the queue we'll be
-                //thrashing it a bit, but that should be fine.
-
-                ReplyHandler *expanderHandler = replyQueue[queueFront];
-                replyQueue[queueFront] = nullptr;
-                queueFront = (queueFront + 1) % clientConfig.replyQueueSize;
-                enqueueReply(expanderHandler);
-
-                soughtFormat = replyQueue[queueFront]->format;
-                repliesExamined++;
-            }
-
-            if (soughtFormat == WebsocketFormat::Unknown) {
-                Serial.println(F("Handler had unknown sought websocket format"));
-                replyQueue[queueFront]->reportFailure(FailureCause::MalformedHandler);
-                dequeueReply();
-            } else if (format == WebsocketFormat::Text) {
-                if (soughtFormat == WebsocketFormat::Text) {
-                    seekingTextHasText();
-                } else {
-                    seekingBinaryHasText();
-                }
-            } else if (format == WebsocketFormat::Binary) {
-                if (soughtFormat == WebsocketFormat::Text) {
-                    seekingTextHasBinary();
-                } else {
-                    seekingBinaryHasBinary();
-                }
-            } else {
-                Serial.println(F("Dropping message with 'other' reply format"));
-            }
+            Serial.println(F("Dropping message with 'other' reply format"));
         }
 
+        finishInbound();
         read = wsClient.parseMessage();
     }
 
+    if (read > 0 && inboundObserver) {
+        //Out of time, the message is dropped unhandled but a capture should still have it
+        inboundObserver->onInboundStart(wsClient.messageType(), millis(), read);
+        finishInbound();
+    }
+
+    if (previewFramePending) {
+        previewFramePending = false;
+        deliverPreviewFrame(previewExchange ? previewExchange->writeSlot() : previewFrame, previewFrameLen);
+    }
+
     return true;
 }
 
@@ -583,88 +685,64 @@ bool PixelblazeClient::connectionMaintenance() {
 
 void PixelblazeClient::weedExpiredReplies() {
     uint32_t currentTimeMs = millis();
-    while (queueLength() > 0) {
-        if (replyQueue[queueFront]->isSatisfied()) {
-            queueFront = (queueFront + 1) % clientConfig.replyQueueSize;
-        } else if (replyQueue[queueFront]->requestTsMs + clientConfig.maxResponseWaitMs < currentTimeMs) {
-            replyQueue[queueFront]->reportFailure(FailureCause::TimedOut);
-            queueFront = (queueFront + 1) % clientConfig.replyQueueSize;
-        } else {
-            return;
+    //Only the earliest deadline needs checking while nothing has expired
+    ReplyHandler *next = replyTimeouts.next();
+    while (next && (int32_t) (currentTimeMs - next->deadlineMs) > 0) {
+        if (!next->isSatisfied()) {
+            next->reportFailure(FailureCause::TimedOut);
         }
-    }
-}
-
-void PixelblazeClient::seekingTextHasText() {
-    DeserializationError deErr = deserializeJson(json, wsClient.readString());
-    if (deErr) {
-        Serial.print(F("Message deserialization error: "));
-        Serial.println(deErr.f_str());
-    } else {
-        if (replyQueue[queueFront]->jsonMatches(json)) {
-            dispatchTextReply(replyQueue[queueFront]);
-            dequeueReply();
-        } else {
-            handleUnrequestedJson();
+        if (next == binaryReadHandler) {
+            //The rest of the read is never coming, drop what was buffered so far
+            streamBuffer.deleteStreamResults(((BinaryReplyHandler *) next)->bufferId);
         }
+        retireReply(next);
+        next = replyTimeouts.next();
     }
 }
 
-void PixelblazeClient::seekingTextHasBinary() {
-    handleUnrequestedBinary(wsClient.read());
-}
-
-void PixelblazeClient::seekingBinaryHasBinary() {
-    auto *binaryHandler = (BinaryReplyHandler *) replyQueue[queueFront];
-    int frameType = wsClient.read();
+void PixelblazeClient::readBinaryReply() {
+    int frameType = readInbound();
     if (frameType < 0) {
         Serial.println(F("Empty binary body received"));
-    } else if (rawBinaryReadType < 0) {
+    } else if (!binaryReadHandler) {
         //We've read nothing so far, blank slate
-        if (frameType == binaryHandler->rawBinType) {
-            int frameFlag = wsClient.read();
-            if (frameFlag & (int) FramePosition::First & (int) FramePosition::Last) {
-                //Lone message
-                if (readBinaryToStream(binaryHandler, binaryHandler->bufferId, false)) {
-                    dispatchBinaryReply(replyQueue[queueFront]);
-                }
-                if (replyQueue[queueFront]->shouldDeleteBuffer()) {
-                    streamBuffer.deleteStreamResults(binaryHandler->bufferId);
-                }
-                dequeueReply();
-            } else if (frameFlag & (int) FramePosition::First) {
-                if (!readBinaryToStream(binaryHandler, binaryHandler->bufferId, false)) {
-                    streamBuffer.deleteStreamResults(binaryHandler->bufferId);
-                    dequeueReply();
-                    return;
-                }
-                rawBinaryReadType = frameType;
-            } else {
-                //Frame was middle, last, or 0, none of which should happen. Drop it and keep going
-                Serial.print(F("Got unexpected frameFlag: "));
-                Serial.print(frameFlag);
-                Serial.print(F("For frameType: "));
-                Serial.println(frameType);
-            }
-        } else {
+        ReplyHandler *handler = findBinaryReply(frameType);
+        if (!handler) {
             handleUnrequestedBinary(frameType);
+            return;
+        }
+
+        auto *binaryHandler = (BinaryReplyHandler *) handler;
+        int frameFlag = readInbound();
+        if ((frameFlag & (int) FramePosition::First) && (frameFlag & (int) FramePosition::Last)) {
+            readLoneBinaryReply(handler);
+        } else if (frameFlag & (int) FramePosition::First) {
+            startMultipartRead(handler, frameType);
+        } else {
+            //Frame was middle, last, or 0, none of which should happen. Drop it and keep going
+            Serial.print(F("Got unexpected frameFlag: "));
+            Serial.print(frameFlag);
+            Serial.print(F("For frameType: "));
+            Serial.println(frameType);
         }
     } else if (frameType == rawBinaryReadType) {
         //We're mid read and the latest is compatible
-        int frameFlag = wsClient.read();
+        ReplyHandler *handler = binaryReadHandler;
+        auto *binaryHandler = (BinaryReplyHandler *) handler;
+        int frameFlag = readInbound();
         if (frameFlag & (int) FramePosition::Last) {
             if (readBinaryToStream(binaryHandler, binaryHandler->bufferId, true)) {
-                dispatchBinaryReply(replyQueue[queueFront]);
+                dispatchBinaryReply(handler);
             }
 
-            if (replyQueue[queueFront]->shouldDeleteBuffer()) {
+            if (handler->shouldDeleteBuffer()) {
                 streamBuffer.deleteStreamResults(binaryHandler->bufferId);
             }
-            dequeueReply();
+            retireReply(handler);
         } else if (frameFlag & (int) FramePosition::Middle) {
             if (!readBinaryToStream(binaryHandler, binaryHandler->bufferId, true)) {
                 streamBuffer.deleteStreamResults(binaryHandler->bufferId);
-                dequeueReply();
+                retireReply(handler);
                 return;
             }
         } else {
@@ -675,7 +753,22 @@ void PixelblazeClient::seekingBinaryHasBinary() {
             Serial.println(frameType);
         }
     } else {
-        //We're mid read and just got an incompatible frame
+        //We're mid read and just got an incompatible frame. A lone reply someone's waiting on, like the expander
+        //channels getConfig can answer with at any point, goes to its handler and leaves the read in progress be.
+        //The start of another requested multipart reply means the one in progress isn't finishing.
+        ReplyHandler *handler = findBinaryReply(frameType);
+        int frameFlag = handler ? wsClient.peek() : -1;
+        if (frameFlag >= 0 && (frameFlag & (int) FramePosition::First)) {
+            readInbound();
+            if (frameFlag & (int) FramePosition::Last) {
+                readLoneBinaryReply(handler);
+            } else {
+                abandonMultipartRead();
+                startMultipartRead(handler, frameType);
+            }
+            return;
+        }
+
         if (!handleUnrequestedBinary(frameType)) {
             Serial.print(F("Expected frameType: "));
             Serial.print(rawBinaryReadType);
@@ -683,22 +776,253 @@ void PixelblazeClient::seekingBinaryHasBinary() {
             Serial.println(frameType);
 
             //Scrap the current read, if the finisher never comes it would drop requested events until weeded
-            binaryHandler->reportFailure(FailureCause::MultipartReadInterrupted);
-            streamBuffer.deleteStreamResults(binaryHandler->bufferId);
-            dequeueReply();
-            rawBinaryReadType = -1;
+            abandonMultipartRead();
+        }
+    }
+}
+
+void PixelblazeClient::startMultipartRead(ReplyHandler *handler, int frameType) {
+    auto *binaryHandler = (BinaryReplyHandler *) handler;
+    if (!readBinaryToStream(binaryHandler, binaryHandler->bufferId, false)) {
+        streamBuffer.deleteStreamResults(binaryHandler->bufferId);
+        retireReply(handler);
+        return;
+    }
+
+    binaryReadHandler = handler;
+    rawBinaryReadType = frameType;
+}
+
+void PixelblazeClient::abandonMultipartRead() {
+    auto *binaryHandler = (BinaryReplyHandler *) binaryReadHandler;
+    binaryHandler->reportFailure(FailureCause::MultipartReadInterrupted);
+    streamBuffer.deleteStreamResults(binaryHandler->bufferId);
+    retireReply(binaryHandler);
+}
+
+void PixelblazeClient::readLoneBinaryReply(ReplyHandler *handler) {
+    auto *binaryHandler = (BinaryReplyHandler *) handler;
+    if (readBinaryToStream(binaryHandler, binaryHandler->bufferId, false)) {
+        dispatchBinaryReply(handler);
+    }
+    if (handler->shouldDeleteBuffer()) {
+        streamBuffer.deleteStreamResults(binaryHandler->bufferId);
+    }
+    retireReply(handler);
+}
+
+void PixelblazeClient::rebuildJsonFilter() {
+    jsonFilterDirty = false;
+    jsonFilter.clear();
+
+    int watched = watcher.watchedEvents();
+    if (watched & (int) WatchedEvent::Stats) {
+        for (const char *key: STATS_KEYS) {
+            jsonFilter[key] = true;
         }
     }
+    if (watched & (int) WatchedEvent::PatternChange) {
+        addSequencerStateFilter(jsonFilter);
+    }
+
+    for (ReplyList &list: replyLists) {
+        for (ReplyHandler *handler = list.oldest; handler; handler = handler->newer) {
+            if (!handler->isSatisfied() && !handler->addJsonFilter(jsonFilter)) {
+                jsonFilterActive = false;
+                return;
+            }
+        }
+    }
+
+    //A truncated filter would quietly drop fields someone is waiting on
+    jsonFilterActive = !jsonFilter.overflowed();
+}
+
+TextFrameKind PixelblazeClient::classifyTextFrame(const char *frame, size_t len) {
+    size_t idx = 0;
+    while (idx < len && isspace(frame[idx])) {
+        idx++;
+    }
+    if (idx >= len || frame[idx] != '{') {
+        return TextFrameKind::Other;
+    }
+    idx++;
+
+    while (idx < len && isspace(frame[idx])) {
+        idx++;
+    }
+    if (idx >= len || frame[idx] != '"') {
+        return TextFrameKind::Other;
+    }
+    idx++;
+
+    const char *key = frame + idx;
+    size_t keyLen = 0;
+    while (idx + keyLen < len && key[keyLen] != '"') {
+        keyLen++;
+    }
+
+    if (keyLen == 3 && !strncmp(key, "fps", 3)) {
+        return TextFrameKind::Stats;
+    } else if (keyLen == 13 && !strncmp(key, "activeProgram", 13)) {
+        return TextFrameKind::ActiveProgram;
+    } else if (keyLen == 8 && !strncmp(key, "playlist", 8)) {
+        return TextFrameKind::Playlist;
+    } else if (keyLen == 3 && !strncmp(key, "ack", 3)) {
+        return TextFrameKind::Ack;
+    }
+
+    return TextFrameKind::Other;
+}
+
+const char *PixelblazeClient::textFrameKey(TextFrameKind kind) {
+    switch (kind) {
+        case TextFrameKind::Stats:
+            return "fps";
+        case TextFrameKind::ActiveProgram:
+            return "activeProgram";
+        case TextFrameKind::Playlist:
+            return "playlist";
+        case TextFrameKind::Ack:
+            return "ack";
+        default:
+            return nullptr;
+    }
 }
 
-void PixelblazeClient::seekingBinaryHasText() {
-    DeserializationError deErr = deserializeJson(json, wsClient.readString());
+bool PixelblazeClient::readJsonFrame() {
+    if (jsonFilterDirty) {
+        rebuildJsonFilter();
+    }
+
+    //Small frames are read whole, larger ones as far as the buffer goes, which is plenty to classify them by
+    int frameLen = wsClient.available();
+    int toBuffer = min(frameLen, (int) clientConfig.textFrameBufferBytes - 1);
+    int buffered = 0;
+    while (buffered < toBuffer) {
+        //Socket reads can come up short, keep going until the buffer is full
+        int bytesRead = readInbound((uint8_t *) textFrameBuffer + buffered, toBuffer - buffered);
+        if (bytesRead <= 0) {
+            break;
+        }
+        buffered += bytesRead;
+    }
+    textFrameBuffer[buffered] = '\0';
+
+    //Unprompted stats and pattern changes, and acks to setters, make up most text traffic. If the filter shows
+    //nothing pending or watched reads them there's no point parsing them.
+    TextFrameKind kind = classifyTextFrame(textFrameBuffer, buffered);
+    if (jsonFilterActive && kind != TextFrameKind::Other && !jsonFilter.containsKey(textFrameKey(kind))) {
+        return false;
+    }
+
+    //Playlists and controls grow without bound, so they're decoded as they're read instead of through a document
+    //that can run out of room. Raw handlers can match anything and need the document.
+    if ((kind == TextFrameKind::Playlist || kind == TextFrameKind::ActiveProgram)
+        && !replyLists[(size_t) ReplyHandlerType::RawText].oldest) {
+        streamTextFrame(kind, buffered, frameLen);
+        return false;
+    }
+
+    DeserializationError deErr;
+    if (buffered == frameLen) {
+        //Parsing a mutable buffer is zero-copy: strings in json point into textFrameBuffer, which stays untouched
+        //until the next text frame is read.
+        if (jsonFilterActive) {
+            deErr = deserializeJson(json, textFrameBuffer, buffered, DeserializationOption::Filter(jsonFilter));
+        } else {
+            deErr = deserializeJson(json, textFrameBuffer, buffered);
+        }
+    } else {
+        //Too big to buffer, parse what was read then the rest straight off the socket, the document holds copies of
+        //strings
+        ObservedStream observed(wsClient, inboundObserver);
+        PrefixedStream frame(textFrameBuffer, buffered, inboundObserver ? (Stream &) observed : (Stream &) wsClient);
+        if (jsonFilterActive) {
+            deErr = deserializeJson(json, frame, DeserializationOption::Filter(jsonFilter));
+        } else {
+            deErr = deserializeJson(json, frame);
+        }
+    }
+
     if (deErr) {
         Serial.print(F("Message deserialization error: "));
         Serial.println(deErr.f_str());
+        return false;
+    }
+
+    return true;
+}
+
+void PixelblazeClient::streamTextFrame(TextFrameKind kind, int buffered, int frameLen) {
+    PlaylistStreamDecoder playlistDecoder(playlist, clientConfig.playlistLimit);
+    SequencerStreamDecoder sequencerDecoder(sequencerState, clientConfig.controlLimit);
+    JsonStreamListener &decoder = kind == TextFrameKind::Playlist
+                                  ? (JsonStreamListener &) playlistDecoder : (JsonStreamListener &) sequencerDecoder;
+
+    //The buffer is reused for each chunk, so nothing but the tokenizer's current token is held however long the
+    //frame is
+    jsonTokenizer.reset();
+    bool ok = jsonTokenizer.feed(textFrameBuffer, buffered, decoder);
+    int remaining = frameLen - buffered;
+    while (ok && remaining > 0) {
+        int bytesRead = readInbound((uint8_t *) textFrameBuffer, min(remaining, (int) clientConfig.textFrameBufferBytes));
+        if (bytesRead <= 0) {
+            break;
+        }
+        ok = jsonTokenizer.feed(textFrameBuffer, bytesRead, decoder);
+        remaining -= bytesRead;
+    }
+
+    if (!ok || !jsonTokenizer.isComplete()) {
+        Serial.println(F("Message stream decode error"));
+        return;
+    }
+    if (jsonTokenizer.getTruncatedTokens() > 0) {
+        Serial.print(F("Strings cut short at streamTokenBytes: "));
+        Serial.println(jsonTokenizer.getTruncatedTokens());
+    }
+
+    ReplyHandlerType replyType;
+    if (kind == TextFrameKind::Playlist) {
+        if (playlistDecoder.getDroppedItems() > 0) {
+            Serial.print(F("Got too many patterns on playlist to store: "));
+            Serial.println(playlist.numItems + playlistDecoder.getDroppedItems());
+        }
+        if (!playlistDecoder.sawPosition()) {
+            //Without a position it's an unrequested playlist change rather than a reply
+            return;
+        }
+        replyType = ReplyHandlerType::Playlist;
     } else {
-        handleUnrequestedJson();
+        if (sequencerDecoder.getDroppedControls() > 0) {
+            Serial.print(F("Got more controls than could be saved: "));
+            Serial.println(sequencerState.controlCount + sequencerDecoder.getDroppedControls());
+        }
+        replyType = ReplyHandlerType::Sequencer;
+    }
+
+    ReplyHandler *handler = replyLists[(size_t) replyType].oldest;
+    if (!handler || handler->isSatisfied()) {
+        if (replyType == ReplyHandlerType::Sequencer) {
+            watcher.handlePatternChange(sequencerState);
+        }
+        return;
     }
+
+    ReplyHandler *target = handler;
+    if (handler->type == ReplyHandlerType::Sync) {
+        auto *syncHandler = (SyncHandler *) handler;
+        syncHandler->finish();
+        target = syncHandler->getWrapped();
+    }
+
+    if (replyType == ReplyHandlerType::Playlist) {
+        ((PlaylistReplyHandler *) target)->handle(playlist);
+    } else {
+        ((SequencerReplyHandler *) target)->handle(sequencerState);
+    }
+    retireReply(handler);
 }
 
 bool PixelblazeClient::readBinaryToStream(ReplyHandler *handler, String &bufferId, bool append) {
@@ -718,12 +1042,25 @@ bool PixelblazeClient::readBinaryToStream(ReplyHandler *handler, String &bufferI
 
     int available = wsClient.available();
     while (available > 0) {
-        int bytesRead = wsClient.read(byteBuffer, min((int) clientConfig.binaryBufferBytes, available));
-        size_t written = stream->write(byteBuffer, bytesRead);
-        if (bytesRead != written) {
+        //Read straight into the buffer when it lends out its space, otherwise copy through byteBuffer
+        size_t space;
+        uint8_t *dest = stream->borrowWrite(space);
+        int bytesRead;
+        size_t written;
+        if (dest) {
+            bytesRead = readInbound(dest, min(space, (size_t) available));
+            written = max(bytesRead, 0);
+            stream->commitWrite(written);
+        } else {
+            bytesRead = readInbound(byteBuffer, min((int) clientConfig.binaryBufferBytes, available));
+            written = bytesRead > 0 ? stream->write(byteBuffer, bytesRead) : 0;
+        }
+
+        if (bytesRead <= 0 || (size_t) bytesRead != written) {
             Serial.print(F("Partial write on stream for bufferId: "));
             Serial.println(bufferId);
             handler->reportFailure(FailureCause::StreamWriteFailure);
+            delete stream;
             return false;
         }
 
@@ -731,6 +1068,7 @@ bool PixelblazeClient::readBinaryToStream(ReplyHandler *handler, String &bufferI
     }
 
     stream->close();
+    delete stream;
     return true;
 }
 
@@ -802,38 +1140,7 @@ void PixelblazeClient::dispatchTextReply(ReplyHandler *genHandler) {
         }
         case ReplyHandlerType::Settings: {
             auto *settingsHandler = (SettingsReplyHandler *) handler;
-            settings.name = json["name"].as<String>();
-            settings.brandName = json["brandName"].as<String>();
-            settings.pixelCount = json["pixelCount"];
-            settings.brightness = json["brightness"];
-            settings.maxBrightness = json["maxBrightness"];
-            settings.colorOrder = json["colorOrder"].as<String>();
-            settings.dataSpeedHz = json["dataSpeedHz"];
-            settings.ledType = ledTypeFromInt(json["ledType"].as<int>());
-            settings.sequenceTimerMs = json["sequenceTimer"];
-            settings.transitionDurationMs = json["transitionDuration"];
-            settings.sequencerMode = json["sequencerMode"];
-            settings.runSequencer = json["runSequencer"];
-            settings.simpleUiMode = json["simpleUiMode"];
-            settings.learningUiMode = json["learningUiMode"];
-            settings.discoveryEnabled = json["discoveryEnable"];
-            settings.timezone = json["timezone"].as<String>();
-            settings.autoOffEnable = json["autoOffEnable"];
-            settings.autoOffStart = json["autoOffStart"].as<String>();
-            settings.autoOffEnd = json["autoOffEnd"].as<String>();
-            settings.cpuSpeedMhz = json["cpuSpeed"];
-            settings.networkPowerSave = json["networkPowerSave"];
-            settings.mapperFit = json["mapperFit"];
-            settings.leaderId = json["leaderId"];
-            settings.nodeId = json["nodeId"];
-            settings.soundSrc = inputSourceFromInt(json["soundSrc"]);
-            settings.accelSrc = inputSourceFromInt(json["accelSrc"]);
-            settings.lightSrc = inputSourceFromInt(json["lightSrc"]);
-            settings.analogSrc = inputSourceFromInt(json["analogSrc"]);
-            settings.exp = json["exp"];
-            settings.version = json["ver"].as<String>();
-            settings.chipId = json["chipId"];
-
+            decodeSettings(json.as<JsonObject>(), settings);
             settingsHandler->handle(settings);
             break;
         }
@@ -860,32 +1167,7 @@ void PixelblazeClient::dispatchTextReply(ReplyHandler *genHandler) {
 }
 
 void PixelblazeClient::parseSequencerState() {
-    JsonObject activeProgram = json["activeProgram"];
-    sequencerState.name = activeProgram["name"].as<String>();
-    sequencerState.activeProgramId = activeProgram["activeProgramId"].as<String>();
-
-    JsonObject controlsObj = activeProgram["controls"];
-    int controlIdx = 0;
-    for (JsonPair kv: controlsObj) {
-        sequencerState.controls[controlIdx].name = kv.key().c_str();
-        sequencerState.controls[controlIdx].value = kv.value();
-        controlIdx++;
-        if (controlIdx >= clientConfig.controlLimit) {
-            Serial.print(F("Got more controls than could be saved: "));
-            Serial.println(controlsObj.size());
-            break;
-        }
-    }
-    sequencerState.controlCount = controlIdx;
-
-    sequencerState.sequencerMode = sequencerModeFromInt(json["sequencerMode"]);
-    sequencerState.runSequencer = json["runSequencer"];
-
-    JsonObject playlistObj = json["playlist"];
-    sequencerState.playlistPos = playlistObj["position"];
-    sequencerState.playlistId = playlistObj["id"].as<String>();
-    sequencerState.ttlMs = playlistObj["ms"];
-    sequencerState.remainingMs = playlistObj["remainingMs"];
+    decodeSequencerState(json.as<JsonObject>(), sequencerState, clientConfig.controlLimit);
 }
 
 void PixelblazeClient::dispatchBinaryReply(ReplyHandler *handler) {
@@ -919,24 +1201,7 @@ void PixelblazeClient::dispatchBinaryReply(ReplyHandler *handler) {
         }
         case ReplyHandlerType::PreviewImage: {
             auto previewImageHandler = (PreviewImageReplyHandler *) binHandler;
-            size_t buffIdx = 0;
-            int peek = stream->peek();
-            while (peek >= 0 && peek < 0xFF && buffIdx < clientConfig.textReadBufferBytes) {
-                stream->read();
-                textReadBuffer[buffIdx] = (char) peek;
-                buffIdx++;
-                peek = stream->peek();
-            }
-
-            textReadBuffer[buffIdx] = '\0';
-            if (buffIdx == clientConfig.textReadBufferBytes && peek != 0xFF) {
-                while (peek >= 0 && peek != 0xFF) {
-                    peek = stream->read();
-                }
-            } else if (peek == 0xFF) {
-                stream->read();
-            }
-
+            stream->readUntil(0xFF, textReadBuffer, clientConfig.textReadBufferBytes);
             String id = textReadBuffer;
             previewImageHandler->handle(id, stream);
             break;
@@ -947,22 +1212,20 @@ void PixelblazeClient::dispatchBinaryReply(ReplyHandler *handler) {
             size_t read = stream->readBytes(byteBuffer, EXPANDER_CHANNEL_BYTE_WIDTH);
             size_t channelsFound = 0;
             while (read == EXPANDER_CHANNEL_BYTE_WIDTH && channelsFound < clientConfig.expanderChannelLimit) {
-                //TODO: Do we really need to heap this? Is this because BufferReader hides the copy constructor?
-                auto *reader = new BufferReader(byteBuffer, read, 0);
+                BufferReader reader(byteBuffer, read, 0);
                 auto channel = &expanderChannels[channelsFound];
-                reader->read(channel->channelId);
-                reader->read(channel->ledType);
-                reader->read(channel->numElements);
+                reader.read(channel->channelId);
+                reader.read(channel->ledType);
+                reader.read(channel->numElements);
 
                 uint8_t colorOrderCode = 0;
-                reader->read(colorOrderCode);
+                reader.read(colorOrderCode);
                 channel->colorOrder = getColorOrder(colorOrderCode);
 
-                reader->read(channel->pixels);
-                reader->read(channel->startIndex);
-                reader->read(channel->frequency);
+                reader.read(channel->pixels);
+                reader.read(channel->startIndex);
+                reader.read(channel->frequency);
 
-                delete reader;
                 channelsFound++;
                 read = stream->readBytes(byteBuffer, EXPANDER_CHANNEL_BYTE_WIDTH);
             }
@@ -1017,26 +1280,226 @@ String PixelblazeClient::humanizeVarName(String &camelCaseVar, int maxWords) {
 }
 
 bool PixelblazeClient::sendJson(JsonDocument &doc) {
+    //Serialized to the socket a token at a time, each a small write, so buffer it and write once if it fits
+    size_t len = measureJson(doc);
+    if (len < clientConfig.sendBufferBytes) {
+        serializeJson(doc, sendBuffer, clientConfig.sendBufferBytes);
+        return sendRaw(sendBuffer, len);
+    }
+
     wsClient.beginMessage((int) WebsocketFormat::Text);
     serializeJson(doc, wsClient);
     return !wsClient.endMessage();
 }
 
+/**
+ * With clientConfig.setterCoalesceWindowMs set, decide whether a setter's value goes out now, or is held as the
+ * setting's latest value for sendHeldSettings() to send once the window since the last send has passed. Saved values
+ * always go out, and replace anything held.
+ *
+ * @return true if the value was held, false if the caller should send it
+ */
+bool PixelblazeClient::holdSetting(HeldSetting &setting, float value, bool saveToFlash) {
+    if (clientConfig.setterCoalesceWindowMs == 0) {
+        return false;
+    } else if (batching) {
+        //The batch carries the latest value now
+        setting.pending = false;
+        return false;
+    }
+
+    uint32_t nowMs = millis();
+    if (saveToFlash || settingDue(setting, nowMs)) {
+        if (setting.pending) {
+            coalescedSetters++;
+        }
+        setting.pending = false;
+        setting.sentOnce = true;
+        setting.lastSentMs = nowMs;
+        return false;
+    }
+
+    if (setting.pending) {
+        coalescedSetters++;
+    }
+    setting.value = value;
+    setting.pending = true;
+    settingsHeld = true;
+    return true;
+}
+
+bool PixelblazeClient::settingDue(HeldSetting &setting, uint32_t nowMs) const {
+    return !setting.sentOnce || nowMs - setting.lastSentMs >= clientConfig.setterCoalesceWindowMs;
+}
+
+/**
+ * @return the held state for a control, or nullptr if coalescing is off or controlLimit others are all waiting to go out
+ */
+PixelblazeClient::HeldControl *PixelblazeClient::heldControl(String &controlName) {
+    if (!heldControls) {
+        return nullptr;
+    }
+
+    for (size_t idx = 0; idx < heldControlCount; idx++) {
+        if (heldControls[idx].name == controlName) {
+            return &heldControls[idx];
+        }
+    }
+
+    HeldControl *held = nullptr;
+    if (heldControlCount < clientConfig.controlLimit) {
+        held = &heldControls[heldControlCount++];
+    } else {
+        //Full, mostly of controls from patterns that have since stopped. Take over the idle one sent longest ago.
+        for (size_t idx = 0; idx < heldControlCount; idx++) {
+            HeldSetting &setting = heldControls[idx].setting;
+            if (!setting.pending && (!held || (int32_t) (setting.lastSentMs - held->setting.lastSentMs) < 0)) {
+                held = &heldControls[idx];
+            }
+        }
+        if (!held) {
+            return nullptr;
+        }
+    }
+
+    held->name = controlName;
+    held->setting = HeldSetting();
+    return held;
+}
+
+/**
+ * @return the document a setter should write to, the open batch or a freshly cleared json
+ */
+JsonDocument &PixelblazeClient::setterDoc() {
+    if (batching) {
+        return batchJson;
+    }
+
+    json.clear();
+    return json;
+}
+
+/**
+ * @return doc's setControls object, created if this is the first control set on it
+ */
+JsonObject PixelblazeClient::setControlsObj(JsonDocument &doc) {
+    if (doc.containsKey("setControls")) {
+        return doc["setControls"];
+    }
+
+    return doc.createNestedObject("setControls");
+}
+
+bool PixelblazeClient::sendSetter(JsonDocument &doc) {
+    if (batching) {
+        return true;
+    }
+
+    return sendJson(doc);
+}
+
+bool PixelblazeClient::sendSetter(JsonDocument &doc, bool saveToFlash) {
+    if (batching) {
+        batchSave = batchSave || saveToFlash;
+        return true;
+    }
+
+    doc["save"] = saveToFlash;
+    return sendJson(doc);
+}
+
+bool PixelblazeClient::sendHeldSettings(bool force) {
+    uint32_t nowMs = millis();
+    bool stillHeld = false;
+    bool sent = true;
+
+    HeldSetting *singles[] = {&heldBrightness, &heldBrightnessLimit};
+    for (HeldSetting *setting: singles) {
+        if (!setting->pending) {
+            continue;
+        } else if (!force && !settingDue(*setting, nowMs)) {
+            stillHeld = true;
+            continue;
+        }
+
+        setting->pending = false;
+        setting->lastSentMs = nowMs;
+        if (setting == &heldBrightness) {
+            sent = sendBrightness(setting->value, false) && sent;
+        } else {
+            sent = sendBrightnessLimit(setting->value, false) && sent;
+        }
+    }
+
+    //Every due control goes out in one message, or joins the open batch
+    JsonDocument &doc = setterDoc();
+    JsonObject controlsObj = setControlsObj(doc);
+    size_t dueControls = 0;
+    for (size_t idx = 0; idx < heldControlCount; idx++) {
+        HeldSetting &setting = heldControls[idx].setting;
+        if (!setting.pending) {
+            continue;
+        } else if (!force && !settingDue(setting, nowMs)) {
+            stillHeld = true;
+            continue;
+        }
+
+        setting.pending = false;
+        setting.lastSentMs = nowMs;
+        putSetterFloat(controlsObj[heldControls[idx].name], setting.value);
+        dueControls++;
+    }
+
+    if (dueControls > 0) {
+        sent = sendSetter(doc, false) && sent;
+    }
+
+    settingsHeld = stillHeld;
+    return sent;
+}
+
+bool PixelblazeClient::sendRaw(const char *frame, size_t len) {
+    wsClient.beginMessage((int) WebsocketFormat::Text);
+    wsClient.write((const uint8_t *) frame, len);
+    return !wsClient.endMessage();
+}
+
+/**
+ * Send prefix, value in decimal, then suffix, for requests whose only variable part is one integer. Prefix and suffix
+ * are literals here, so together they're well short of the frame buffer.
+ */
+bool PixelblazeClient::sendIntFrame(const char *prefix, long value, const char *suffix) {
+    char frame[64];
+    size_t len = 0;
+    while (*prefix) {
+        frame[len++] = *prefix++;
+    }
+
+    if (value < 0) {
+        frame[len++] = '-';
+    }
+
+    //Digits come out least significant first, so fill them in from the back
+    char digits[20];
+    size_t digitIdx = sizeof(digits);
+    unsigned long magnitude = value < 0 ? 0UL - (unsigned long) value : (unsigned long) value;
+    do {
+        digits[--digitIdx] = (char) ('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    memcpy(frame + len, digits + digitIdx, sizeof(digits) - digitIdx);
+    len += sizeof(digits) - digitIdx;
+
+    while (*suffix) {
+        frame[len++] = *suffix++;
+    }
+
+    return sendRaw(frame, len);
+}
+
 void PixelblazeClient::handleUnrequestedJson() {
     if (json.containsKey("fps")) {
-        statsEvent.fps = json["fps"];
-        statsEvent.vmerr = json["vmerr"];
-        statsEvent.vmerrpc = json["vmerrpc"];
-        statsEvent.memBytes = json["mem"];
-        statsEvent.expansions = json["exp"];
-        statsEvent.renderType = renderTypeFromInt(json["renderType"]);
-        statsEvent.uptimeMs = json["uptime"];
-        statsEvent.storageBytesUsed = json["storageUsed"];
-        statsEvent.storageBytesSize = json["storageSize"];
-        statsEvent.rr0 = json["rr0"];
-        statsEvent.rr1 = json["rr1"];
-        statsEvent.rebootCounter = json["rebootCounter"];
-
+        decodeStats(json.as<JsonObject>(), statsEvent);
         watcher.handleStats(statsEvent);
     } else if (json.containsKey("activeProgram")) {
         //This is also sent as part of the response to getConfig
@@ -1048,24 +1511,86 @@ void PixelblazeClient::handleUnrequestedJson() {
     }
 }
 
+int PixelblazeClient::readInbound(uint8_t *buffer, size_t len) {
+    int bytesRead = wsClient.read(buffer, len);
+    if (inboundObserver && bytesRead > 0) {
+        inboundObserver->onInboundBytes(buffer, bytesRead);
+    }
+
+    return bytesRead;
+}
+
+int PixelblazeClient::readInbound() {
+    int value = wsClient.read();
+    if (inboundObserver && value >= 0) {
+        uint8_t byte = value;
+        inboundObserver->onInboundBytes(&byte, 1);
+    }
+
+    return value;
+}
+
+void PixelblazeClient::finishInbound() {
+    if (!inboundObserver) {
+        return;
+    }
+
+    //Left unread the rest would be skipped by the next parseMessage(), the observer still wants it
+    while (wsClient.available() > 0) {
+        if (readInbound(byteBuffer, min(wsClient.available(), (int) clientConfig.binaryBufferBytes)) <= 0) {
+            break;
+        }
+    }
+    inboundObserver->onInboundEnd();
+}
+
+void PixelblazeClient::deliverPreviewFrame(uint8_t *frame, size_t len) {
+    if (previewDiffer && !previewDiffer->update(frame, len)) {
+        unchangedPreviewFrames++;
+        return;
+    }
+
+    int watched = watcher.watchedEvents();
+    if (watched & (int) WatchedEvent::PreviewFrame) {
+        watcher.handlePreviewFrame(frame, len);
+    }
+    if (previewDiffer && watched & (int) WatchedEvent::PreviewChange) {
+        watcher.handlePreviewChange(*previewDiffer);
+    }
+    if (previewExchange) {
+        //After this the slot belongs to the consumer, so the watcher has to see it first
+        previewExchange->publish(len);
+    }
+}
+
 bool PixelblazeClient::handleUnrequestedBinary(int frameType) {
     if (frameType == (int) BinaryMsgType::PreviewFrame) {
-        int frameSize = wsClient.read(byteBuffer,
-                                      min(wsClient.available(), (int) clientConfig.binaryBufferBytes));
-        watcher.handlePreviewFrame(byteBuffer, frameSize);
-        return true;
-    } else if (frameType == (int) BinaryMsgType::ExpanderChannels) {
-        // Expander configs can come in out of order, check if one has been requested
-        size_t queuePos = queueFront;
-        while (queuePos != queueBack) {
-            if (replyQueue[queuePos]->format == WebsocketFormat::Binary &&
-                ((BinaryReplyHandler *) replyQueue[queuePos])->type == ReplyHandlerType::Expander) {
-                dispatchBinaryReply(replyQueue[queuePos]);
-                replyQueue[queuePos]->satisfied = true;
-                break;
+        int watched = watcher.watchedEvents();
+        if (!previewExchange && !(watched & (int) WatchedEvent::PreviewFrame)
+            && !(previewDiffer && watched & (int) WatchedEvent::PreviewChange)) {
+            //Left unread, the rest of the frame is skipped by the next parseMessage()
+            return true;
+        }
+
+        if (clientConfig.coalescePreviewFrames) {
+            //Latest wins, checkForInbound() delivers whichever frame is pending when it's done
+            if (previewFramePending) {
+                droppedPreviewFrames++;
             }
-            queuePos = (queuePos + 1) % clientConfig.replyQueueSize;
+
+            int frameSize = readInbound(previewExchange ? previewExchange->writeSlot() : previewFrame,
+                                        min(wsClient.available(), (int) clientConfig.binaryBufferBytes));
+            previewFrameLen = max(frameSize, 0);
+            previewFramePending = true;
+            return true;
         }
+
+        uint8_t *frame = previewExchange ? previewExchange->writeSlot() : byteBuffer;
+        int frameSize = readInbound(frame, min(wsClient.available(), (int) clientConfig.binaryBufferBytes));
+        deliverPreviewFrame(frame, max(frameSize, 0));
+        return true;
+    } else if (frameType == (int) BinaryMsgType::ExpanderChannels) {
+        //Every getConfig is answered with expander channels whether they were asked for or not, nothing to do
         return true;
     }
 
@@ -1073,13 +1598,67 @@ bool PixelblazeClient::handleUnrequestedBinary(int frameType) {
 }
 
 size_t PixelblazeClient::queueLength() const {
-    if (queueFront > queueBack) {
-        //Queue shape: |***B...F**|
-        return queueBack + (clientConfig.replyQueueSize - queueFront);
-    } else {
-        //Queue shape: |.F*****B..| or empty with them ==
-        return queueBack - queueFront;
+    return pendingReplies;
+}
+
+/**
+ * Lists are keyed by the type a handler answers to, a SyncHandler files under the handler it wraps
+ */
+static size_t replyListIdx(ReplyHandler *handler) {
+    if (handler->type == ReplyHandlerType::Sync) {
+        return (size_t) ((SyncHandler *) handler)->getWrapped()->type;
     }
+
+    return (size_t) handler->type;
+}
+
+ReplyHandler *PixelblazeClient::findTextReply() {
+    ReplyHandler *match = nullptr;
+    for (ReplyList &list: replyLists) {
+        for (ReplyHandler *handler = list.oldest; handler; handler = handler->newer) {
+            if (handler->format != WebsocketFormat::Text
+                || (match && (int32_t) (handler->replySeq - match->replySeq) > 0)) {
+                break;
+            }
+
+            if (!handler->isSatisfied() && handler->jsonMatches(json)) {
+                match = handler;
+                break;
+            }
+
+            //Built in handlers of a type all match the same replies, only raw handlers need looking past the oldest
+            if (replyListIdx(handler) != (size_t) ReplyHandlerType::RawText) {
+                break;
+            }
+        }
+    }
+
+    return match;
+}
+
+ReplyHandler *PixelblazeClient::findBinaryReply(int rawBinType) {
+    ReplyHandler *match = nullptr;
+    for (ReplyList &list: replyLists) {
+        for (ReplyHandler *handler = list.oldest; handler; handler = handler->newer) {
+            ReplyHandler *wrapped = handler->type == ReplyHandlerType::Sync
+                                    ? ((SyncHandler *) handler)->getWrapped() : handler;
+            if (wrapped->format != WebsocketFormat::Binary
+                || (match && (int32_t) (handler->replySeq - match->replySeq) > 0)) {
+                break;
+            }
+
+            if (!handler->isSatisfied() && ((BinaryReplyHandler *) wrapped)->rawBinType == rawBinType) {
+                match = handler;
+                break;
+            }
+
+            if (wrapped->type != ReplyHandlerType::RawBinary) {
+                break;
+            }
+        }
+    }
+
+    return match;
 }
 
 bool PixelblazeClient::enqueueReply(ReplyHandler *replyHandler) {
@@ -1094,7 +1673,7 @@ bool PixelblazeClient::enqueueReplies(int num, ...) {
 
     //In order to drop handling parts of a response like from getSystemState, sometimes we mark replies
     //satisfied before we even enqueue them. There are probably cleaner ways but this works.
-    int toEnqueue = 0;
+    size_t toEnqueue = 0;
     va_list arguments;
     va_start(arguments, num);
     for (int idx = 0; idx < num; idx++) {
@@ -1105,15 +1684,14 @@ bool PixelblazeClient::enqueueReplies(int num, ...) {
     }
     va_end(arguments);
 
-    if (toEnqueue == 0) {
-        return true;
-    }
+    uint32_t timeoutMs = nextRequestTimeoutMs ? nextRequestTimeoutMs : clientConfig.maxResponseWaitMs;
+    nextRequestTimeoutMs = 0;
 
     //Verify that there's space
-    if (clientConfig.replyQueueSize - queueLength() < toEnqueue) {
-        //Last ditch compact and try again
-        compactQueue();
-        if (clientConfig.replyQueueSize - queueLength() < toEnqueue) {
+    if (toEnqueue > 0 && clientConfig.replyQueueSize - pendingReplies < toEnqueue) {
+        //Last ditch drop anything expired and try again
+        weedExpiredReplies();
+        if (clientConfig.replyQueueSize - pendingReplies < toEnqueue) {
             return false;
         }
     }
@@ -1122,96 +1700,74 @@ bool PixelblazeClient::enqueueReplies(int num, ...) {
     for (int idx = 0; idx < num; idx++) {
         ReplyHandler *handler = va_arg(arguments, ReplyHandler * );
         if (handler && !handler->isSatisfied()) {
-            replyQueue[queueBack] = handler;
-            queueBack = (queueBack + 1) % clientConfig.replyQueueSize;
+            ReplyList &list = replyLists[replyListIdx(handler)];
+            handler->replySeq = nextReplySeq++;
+            handler->newer = nullptr;
+            handler->older = list.newest;
+            if (list.newest) {
+                list.newest->newer = handler;
+            } else {
+                list.oldest = handler;
+            }
+            list.newest = handler;
+            pendingReplies++;
+
+            handler->deadlineMs = handler->requestTsMs + (handler->timeoutMs ? handler->timeoutMs : timeoutMs);
+            replyTimeouts.push(handler);
         } else if (handler) {
-            delete handler;
+            handlerPool.release(handler);
         }
     }
     va_end(arguments);
-
-    return true;
-}
-
-void PixelblazeClient::dequeueReply() {
-    if (queueLength() == 0) {
-        Serial.println(F("Dequeue called on empty queue"));
-        return;
+    if (toEnqueue > 0) {
+        jsonFilterDirty = true;
     }
 
-    delete replyQueue[queueFront];
-    replyQueue[queueFront] = nullptr;
-    queueFront = (queueFront + 1) % clientConfig.replyQueueSize;
+    return true;
 }
 
-//Last ditch when an enqueue fails
-void PixelblazeClient::compactQueue() {
-    int toKeep = 0;
-    unsigned long nowMs = millis();
-    for (size_t idx = queueFront; idx != queueBack; idx = (idx + 1) % clientConfig.replyQueueSize) {
-        if (!replyQueue[idx]->isSatisfied() && replyQueue[idx]->requestTsMs + clientConfig.maxResponseWaitMs > nowMs) {
-            toKeep++;
-        }
+void PixelblazeClient::retireReply(ReplyHandler *handler) {
+    ReplyList &list = replyLists[replyListIdx(handler)];
+    if (handler->older) {
+        handler->older->newer = handler->newer;
+    } else {
+        list.oldest = handler->newer;
     }
-
-    if (toKeep == 0) {
-        for (size_t idx = 0; idx < clientConfig.replyQueueSize; idx++) {
-            if (replyQueue[idx]) {
-                delete replyQueue[idx];
-                replyQueue[idx] = nullptr;
-            }
-        }
-
-        queueFront = 0;
-        queueBack = 0;
-    } else if (toKeep == clientConfig.replyQueueSize) {
-        //Nothing to do
+    if (handler->newer) {
+        handler->newer->older = handler->older;
     } else {
-        ReplyHandler *temp[toKeep];
-        int tempIdx = 0;
-        for (size_t idx = queueFront; idx != queueBack; idx = (idx + 1) % clientConfig.replyQueueSize) {
-            if (!replyQueue[idx]->isSatisfied() &&
-                replyQueue[idx]->requestTsMs + clientConfig.maxResponseWaitMs > nowMs) {
-                temp[tempIdx] = replyQueue[idx];
-                tempIdx++;
-            } else {
-                delete replyQueue[idx];
-            }
-            replyQueue[idx] = nullptr;
-        }
-
-        for (int idx = 0; idx < toKeep; idx++) {
-            replyQueue[idx] = temp[idx];
-        }
+        list.newest = handler->older;
+    }
 
-        queueFront = 0;
-        queueBack = toKeep;
+    replyTimeouts.remove(handler);
+    if (handler == binaryReadHandler) {
+        binaryReadHandler = nullptr;
+        rawBinaryReadType = -1;
     }
+
+    handlerPool.release(handler);
+    pendingReplies--;
+    jsonFilterDirty = true;
 }
 
 void PixelblazeClient::evictQueue(FailureCause reason) {
-    for (size_t idx = queueFront; idx != queueBack; idx = (idx + 1) % clientConfig.replyQueueSize) {
-        replyQueue[idx]->reportFailure(reason);
-        delete replyQueue[idx];
-        replyQueue[idx] = nullptr;
+    for (ReplyList &list: replyLists) {
+        while (list.oldest) {
+            list.oldest->reportFailure(reason);
+            retireReply(list.oldest);
+        }
     }
-
-    queueFront = 0;
-    queueBack = 0;
 }
 
 bool PixelblazeClient::sendBinary(int binType, Stream &stream) {
+    //The two header bytes go at the front of byteBuffer, so each frame reaches the socket in one write
     size_t freeBufferLen = clientConfig.binaryBufferBytes - 2;
     bool hasSent = false;
     while (true) {
-        size_t read = stream.readBytes(byteBuffer, freeBufferLen);
+        size_t read = stream.readBytes(byteBuffer + 2, freeBufferLen);
         if (read >= freeBufferLen) {
-            FramePosition frameType = hasSent ? FramePosition::Middle : FramePosition::First;
-            wsClient.beginMessage((int) WebsocketFormat::Binary);
-            wsClient.write(binType);
-            wsClient.write((int) frameType);
-            wsClient.write(byteBuffer, read);
-            if (wsClient.endMessage()) {
+            int frameType = hasSent ? (int) FramePosition::Middle : (int) FramePosition::First;
+            if (!sendBinaryFrame(binType, frameType, read)) {
                 return false;
             }
 
@@ -1219,32 +1775,27 @@ bool PixelblazeClient::sendBinary(int binType, Stream &stream) {
         } else if (read > 0) {
             int frameType = hasSent ? (int) FramePosition::Last : (int) FramePosition::First |
                                                                   (int) FramePosition::Last;
-            wsClient.beginMessage((int) WebsocketFormat::Binary);
-            wsClient.write(binType);
-            wsClient.write(frameType);
-            wsClient.write(byteBuffer, read);
-            if (wsClient.endMessage()) {
-                return false;
-            }
-
-            hasSent = true;
+            //A short read means the stream is drained, this was the last frame
+            return sendBinaryFrame(binType, frameType, read);
         } else {
-            if (hasSent) {
-                //Our data broke perfectly along frame boundaries, hopefully sending an empty
-                //last frame doesn't break things
-                wsClient.beginMessage((int) WebsocketFormat::Binary);
-                wsClient.write(binType);
-                wsClient.write((int) FramePosition::Last);
-                if (wsClient.endMessage()) {
-                    return false;
-                }
-            }
-
-            return true;
+            //Our data broke perfectly along frame boundaries, hopefully sending an empty
+            //last frame doesn't break things
+            return !hasSent || sendBinaryFrame(binType, (int) FramePosition::Last, 0);
         }
     }
 }
 
+/**
+ * Send a binary frame whose body has already been read into byteBuffer after its two header bytes
+ */
+bool PixelblazeClient::sendBinaryFrame(int binType, int frameType, size_t bodyLen) {
+    byteBuffer[0] = (uint8_t) binType;
+    byteBuffer[1] = (uint8_t) frameType;
+    wsClient.beginMessage((int) WebsocketFormat::Binary);
+    wsClient.write(byteBuffer, bodyLen + 2);
+    return !wsClient.endMessage();
+}
+
 // Extracted from the web JS
 static String BGR_STR = "BGR";
 static String BRG_STR = "BRG";
@@ -1286,49 +1837,58 @@ String *PixelblazeClient::getColorOrder(uint8_t code) {
 }
 
 bool AllPatternIterator::next(PatternIdentifiers &fillMe) {
-    size_t buffIdx = 0;
-    int read = stream->read();
-    if (read < 0) {
+    if (stream->peek() < 0) {
         return false;
     }
 
-    while (read >= 0 && read != '\t' && buffIdx < bufferLen) {
-        readBuffer[buffIdx] = (char) read;
-        buffIdx++;
-        read = stream->read();
-    }
-
-    //Our length limit exceeded, unclear what id length limits are though 16 bytes seems standard
-    if (buffIdx >= bufferLen) {
-        while (read >= 0 && read != '\t') {
-            read = stream->read();
-        }
-    }
-
-    if (read < 0) {
+    //Ids and names past bufferLen are cut short, unclear what the limits on either are though 16 byte ids are standard
+    if (stream->readUntil('\t', readBuffer, bufferLen) < 0) {
         Serial.println(F("Got malformed all pattern response."));
         return false;
     }
-
-    readBuffer[buffIdx] = '\0';
     fillMe.id = readBuffer;
 
-    buffIdx = 0;
-    while (read >= 0 && read != '\n' && buffIdx < bufferLen) {
-        readBuffer[buffIdx] = (char) read;
-        buffIdx++;
-        read = stream->read();
-    }
+    //The last name may run to the end of the stream without a newline
+    stream->readUntil('\n', readBuffer, bufferLen);
+    fillMe.name = readBuffer;
 
-    //Our length limit exceeded, unclear what name length limits are
-    if (buffIdx >= bufferLen) {
-        while (read >= 0 && read != '\n') {
-            read = stream->read();
+    return true;
+}
+
+int CloseableStream::readUntil(uint8_t delim, char *out, size_t outLen) {
+    size_t kept = 0;
+    size_t room = outLen > 0 ? outLen - 1 : 0;
+    while (true) {
+        size_t unread;
+        const uint8_t *span = borrowRead(unread);
+        if (span) {
+            auto *found = (const uint8_t *) memchr(span, delim, unread);
+            size_t fieldBytes = found ? found - span : unread;
+            size_t toKeep = min(fieldBytes, room - kept);
+            memcpy(out + kept, span, toKeep);
+            kept += toKeep;
+            consumeRead(found ? fieldBytes + 1 : fieldBytes);
+            if (found) {
+                break;
+            }
+            continue;
         }
-    }
 
-    readBuffer[buffIdx] = '\0';
-    fillMe.name = readBuffer;
+        int read = this->read();
+        if (read < 0) {
+            if (outLen > 0) {
+                out[kept] = '\0';
+            }
+            return -1;
+        } else if (read == delim) {
+            break;
+        } else if (kept < room) {
+            out[kept++] = (char) read;
+        }
+    }
 
-    return true;
+    if (outLen > 0) {
+        out[kept] = '\0';
+    }
+    return delim;
 }
\ No newline at end of file
@@ -0,0 +1,349 @@
+#include "PixelblazeDecoders.h"
+
+static void decodeControls(JsonObject obj, SequencerState &state, size_t controlLimit) {
+    size_t controlIdx = 0;
+    for (JsonPair kv: obj) {
+        if (controlIdx >= controlLimit) {
+            Serial.print(F("Got more controls than could be saved: "));
+            Serial.println(obj.size());
+            break;
+        }
+
+        state.controls[controlIdx].name = kv.key().c_str();
+        state.controls[controlIdx].value = kv.value();
+        controlIdx++;
+    }
+    state.controlCount = controlIdx;
+}
+
+static void decodeActiveProgram(JsonObject obj, SequencerState &state, size_t controlLimit) {
+    for (JsonPair kv: obj) {
+        const char *key = kv.key().c_str();
+        JsonVariant value = kv.value();
+        switch (fieldHash(key)) {
+            case fieldHash("name"):
+                if (!strcmp(key, "name")) {
+                    state.name = value.as<String>();
+                }
+                break;
+            case fieldHash("activeProgramId"):
+                if (!strcmp(key, "activeProgramId")) {
+                    state.activeProgramId = value.as<String>();
+                }
+                break;
+            case fieldHash("controls"):
+                if (!strcmp(key, "controls")) {
+                    decodeControls(value.as<JsonObject>(), state, controlLimit);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void decodeSequencerPlaylist(JsonObject obj, SequencerState &state) {
+    for (JsonPair kv: obj) {
+        const char *key = kv.key().c_str();
+        JsonVariant value = kv.value();
+        switch (fieldHash(key)) {
+            case fieldHash("position"):
+                if (!strcmp(key, "position")) {
+                    state.playlistPos = value;
+                }
+                break;
+            case fieldHash("id"):
+                if (!strcmp(key, "id")) {
+                    state.playlistId = value.as<String>();
+                }
+                break;
+            case fieldHash("ms"):
+                if (!strcmp(key, "ms")) {
+                    state.ttlMs = value;
+                }
+                break;
+            case fieldHash("remainingMs"):
+                if (!strcmp(key, "remainingMs")) {
+                    state.remainingMs = value;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void decodeSettings(JsonObject obj, Settings &settings) {
+    settings = Settings();
+    for (JsonPair kv: obj) {
+        const char *key = kv.key().c_str();
+        JsonVariant value = kv.value();
+        switch (fieldHash(key)) {
+            case fieldHash("name"):
+                if (!strcmp(key, "name")) {
+                    settings.name = value.as<String>();
+                }
+                break;
+            case fieldHash("brandName"):
+                if (!strcmp(key, "brandName")) {
+                    settings.brandName = value.as<String>();
+                }
+                break;
+            case fieldHash("pixelCount"):
+                if (!strcmp(key, "pixelCount")) {
+                    settings.pixelCount = value;
+                }
+                break;
+            case fieldHash("brightness"):
+                if (!strcmp(key, "brightness")) {
+                    settings.brightness = value;
+                }
+                break;
+            case fieldHash("maxBrightness"):
+                if (!strcmp(key, "maxBrightness")) {
+                    settings.maxBrightness = value;
+                }
+                break;
+            case fieldHash("colorOrder"):
+                if (!strcmp(key, "colorOrder")) {
+                    settings.colorOrder = value.as<String>();
+                }
+                break;
+            case fieldHash("dataSpeedHz"):
+                if (!strcmp(key, "dataSpeedHz")) {
+                    settings.dataSpeedHz = value;
+                }
+                break;
+            case fieldHash("ledType"):
+                if (!strcmp(key, "ledType")) {
+                    settings.ledType = ledTypeFromInt(value.as<int>());
+                }
+                break;
+            case fieldHash("sequenceTimer"):
+                if (!strcmp(key, "sequenceTimer")) {
+                    settings.sequenceTimerMs = value;
+                }
+                break;
+            case fieldHash("transitionDuration"):
+                if (!strcmp(key, "transitionDuration")) {
+                    settings.transitionDurationMs = value;
+                }
+                break;
+            case fieldHash("sequencerMode"):
+                if (!strcmp(key, "sequencerMode")) {
+                    settings.sequencerMode = value;
+                }
+                break;
+            case fieldHash("runSequencer"):
+                if (!strcmp(key, "runSequencer")) {
+                    settings.runSequencer = value;
+                }
+                break;
+            case fieldHash("simpleUiMode"):
+                if (!strcmp(key, "simpleUiMode")) {
+                    settings.simpleUiMode = value;
+                }
+                break;
+            case fieldHash("learningUiMode"):
+                if (!strcmp(key, "learningUiMode")) {
+                    settings.learningUiMode = value;
+                }
+                break;
+            case fieldHash("discoveryEnable"):
+                if (!strcmp(key, "discoveryEnable")) {
+                    settings.discoveryEnabled = value;
+                }
+                break;
+            case fieldHash("timezone"):
+                if (!strcmp(key, "timezone")) {
+                    settings.timezone = value.as<String>();
+                }
+                break;
+            case fieldHash("autoOffEnable"):
+                if (!strcmp(key, "autoOffEnable")) {
+                    settings.autoOffEnable = value;
+                }
+                break;
+            case fieldHash("autoOffStart"):
+                if (!strcmp(key, "autoOffStart")) {
+                    settings.autoOffStart = value.as<String>();
+                }
+                break;
+            case fieldHash("autoOffEnd"):
+                if (!strcmp(key, "autoOffEnd")) {
+                    settings.autoOffEnd = value.as<String>();
+                }
+                break;
+            case fieldHash("cpuSpeed"):
+                if (!strcmp(key, "cpuSpeed")) {
+                    settings.cpuSpeedMhz = value;
+                }
+                break;
+            case fieldHash("networkPowerSave"):
+                if (!strcmp(key, "networkPowerSave")) {
+                    settings.networkPowerSave = value;
+                }
+                break;
+            case fieldHash("mapperFit"):
+                if (!strcmp(key, "mapperFit")) {
+                    settings.mapperFit = value;
+                }
+                break;
+            case fieldHash("leaderId"):
+                if (!strcmp(key, "leaderId")) {
+                    settings.leaderId = value;
+                }
+                break;
+            case fieldHash("nodeId"):
+                if (!strcmp(key, "nodeId")) {
+                    settings.nodeId = value;
+                }
+                break;
+            case fieldHash("soundSrc"):
+                if (!strcmp(key, "soundSrc")) {
+                    settings.soundSrc = inputSourceFromInt(value.as<int>());
+                }
+                break;
+            case fieldHash("accelSrc"):
+                if (!strcmp(key, "accelSrc")) {
+                    settings.accelSrc = inputSourceFromInt(value.as<int>());
+                }
+                break;
+            case fieldHash("lightSrc"):
+                if (!strcmp(key, "lightSrc")) {
+                    settings.lightSrc = inputSourceFromInt(value.as<int>());
+                }
+                break;
+            case fieldHash("analogSrc"):
+                if (!strcmp(key, "analogSrc")) {
+                    settings.analogSrc = inputSourceFromInt(value.as<int>());
+                }
+                break;
+            case fieldHash("exp"):
+                if (!strcmp(key, "exp")) {
+                    settings.exp = value;
+                }
+                break;
+            case fieldHash("ver"):
+                if (!strcmp(key, "ver")) {
+                    settings.version = value.as<String>();
+                }
+                break;
+            case fieldHash("chipId"):
+                if (!strcmp(key, "chipId")) {
+                    settings.chipId = value;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void decodeStats(JsonObject obj, Stats &stats) {
+    stats = Stats();
+    for (JsonPair kv: obj) {
+        const char *key = kv.key().c_str();
+        JsonVariant value = kv.value();
+        switch (fieldHash(key)) {
+            case fieldHash("fps"):
+                if (!strcmp(key, "fps")) {
+                    stats.fps = value;
+                }
+                break;
+            case fieldHash("vmerr"):
+                if (!strcmp(key, "vmerr")) {
+                    stats.vmerr = value;
+                }
+                break;
+            case fieldHash("vmerrpc"):
+                if (!strcmp(key, "vmerrpc")) {
+                    stats.vmerrpc = value;
+                }
+                break;
+            case fieldHash("mem"):
+                if (!strcmp(key, "mem")) {
+                    stats.memBytes = value;
+                }
+                break;
+            case fieldHash("exp"):
+                if (!strcmp(key, "exp")) {
+                    stats.expansions = value;
+                }
+                break;
+            case fieldHash("renderType"):
+                if (!strcmp(key, "renderType")) {
+                    stats.renderType = renderTypeFromInt(value.as<int>());
+                }
+                break;
+            case fieldHash("uptime"):
+                if (!strcmp(key, "uptime")) {
+                    stats.uptimeMs = value;
+                }
+                break;
+            case fieldHash("storageUsed"):
+                if (!strcmp(key, "storageUsed")) {
+                    stats.storageBytesUsed = value;
+                }
+                break;
+            case fieldHash("storageSize"):
+                if (!strcmp(key, "storageSize")) {
+                    stats.storageBytesSize = value;
+                }
+                break;
+            case fieldHash("rr0"):
+                if (!strcmp(key, "rr0")) {
+                    stats.rr0 = value;
+                }
+                break;
+            case fieldHash("rr1"):
+                if (!strcmp(key, "rr1")) {
+                    stats.rr1 = value;
+                }
+                break;
+            case fieldHash("rebootCounter"):
+                if (!strcmp(key, "rebootCounter")) {
+                    stats.rebootCounter = value;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void decodeSequencerState(JsonObject obj, SequencerState &state, size_t controlLimit) {
+    //Reset everything but the controls array, which belongs to the caller
+    Control *controls = state.controls;
+    state = SequencerState();
+    state.controls = controls;
+
+    for (JsonPair kv: obj) {
+        const char *key = kv.key().c_str();
+        JsonVariant value = kv.value();
+        switch (fieldHash(key)) {
+            case fieldHash("activeProgram"):
+                if (!strcmp(key, "activeProgram")) {
+                    decodeActiveProgram(value.as<JsonObject>(), state, controlLimit);
+                }
+                break;
+            case fieldHash("sequencerMode"):
+                if (!strcmp(key, "sequencerMode")) {
+                    state.sequencerMode = sequencerModeFromInt(value.as<int>());
+                }
+                break;
+            case fieldHash("runSequencer"):
+                if (!strcmp(key, "runSequencer")) {
+                    state.runSequencer = value;
+                }
+                break;
+            case fieldHash("playlist"):
+                if (!strcmp(key, "playlist")) {
+                    decodeSequencerPlaylist(value.as<JsonObject>(), state);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#include "PixelblazeClient.h"
+#include "PixelblazeHandlerPool.h"
+
+ReplyHandlerPool::ReplyHandlerPool(size_t numSlots) : numSlots(numSlots) {
+    slots = new HandlerSlot[numSlots];
+    //Chain back to front so slots are handed out in address order
+    for (size_t idx = numSlots; idx > 0; idx--) {
+        slots[idx - 1].nextFree = freeList;
+        freeList = &slots[idx - 1];
+    }
+    freeSlots = numSlots;
+}
+
+ReplyHandlerPool::~ReplyHandlerPool() {
+    delete[] slots;
+}
+
+void *ReplyHandlerPool::acquire() {
+    if (!freeList) {
+        exhausted++;
+        return nullptr;
+    }
+
+    HandlerSlot *slot = freeList;
+    freeList = slot->nextFree;
+    freeSlots--;
+    return slot;
+}
+
+void ReplyHandlerPool::release(ReplyHandler *handler) {
+    if (!handler) {
+        return;
+    }
+
+    if (handler->type == ReplyHandlerType::Sync) {
+        release(((SyncHandler *) handler)->getWrapped());
+    }
+
+    handler->~ReplyHandler();
+
+    auto *slot = (HandlerSlot *) (void *) handler;
+    slot->nextFree = freeList;
+    freeList = slot;
+    freeSlots++;
+}
@@ -0,0 +1,402 @@
+#include "PixelblazeJsonStream.h"
+
+JsonStreamTokenizer::JsonStreamTokenizer(size_t tokenBytes) : tokenBytes(max(tokenBytes, (size_t) 2)) {
+    token = new char[this->tokenBytes];
+}
+
+JsonStreamTokenizer::~JsonStreamTokenizer() {
+    delete[] token;
+}
+
+void JsonStreamTokenizer::reset() {
+    state = State::Value;
+    depth = 0;
+    objectBits = 0;
+    tokenLen = 0;
+    tokenTruncated = false;
+    truncatedTokens = 0;
+    highSurrogate = 0;
+}
+
+bool JsonStreamTokenizer::feed(const char *bytes, size_t len, JsonStreamListener &listener) {
+    for (size_t idx = 0; idx < len && state != State::Failed; idx++) {
+        char c = bytes[idx];
+        switch (state) {
+            case State::String:
+                if (c == '"') {
+                    if (stringIsKey) {
+                        emitToken(JsonEvent::Key, listener);
+                        state = State::Colon;
+                    } else {
+                        emitToken(JsonEvent::String, listener);
+                        afterValue();
+                    }
+                } else if (c == '\\') {
+                    state = State::StringEscape;
+                } else if ((uint8_t) c < 0x20) {
+                    state = State::Failed;
+                } else {
+                    append(c);
+                }
+                break;
+            case State::StringEscape:
+                state = State::String;
+                switch (c) {
+                    case '"':
+                    case '\\':
+                    case '/':
+                        append(c);
+                        break;
+                    case 'b':
+                        append('\b');
+                        break;
+                    case 'f':
+                        append('\f');
+                        break;
+                    case 'n':
+                        append('\n');
+                        break;
+                    case 'r':
+                        append('\r');
+                        break;
+                    case 't':
+                        append('\t');
+                        break;
+                    case 'u':
+                        unicode = 0;
+                        unicodeDigits = 0;
+                        state = State::StringUnicode;
+                        break;
+                    default:
+                        state = State::Failed;
+                }
+                break;
+            case State::StringUnicode: {
+                int digit = isdigit(c) ? c - '0'
+                                       : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                                                                : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+                if (digit < 0) {
+                    state = State::Failed;
+                    break;
+                }
+
+                unicode = (unicode << 4) | digit;
+                if (++unicodeDigits == 4) {
+                    appendCodepoint(unicode);
+                    state = State::String;
+                }
+                break;
+            }
+            case State::Number:
+                if (isdigit(c) || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                    append(c);
+                    break;
+                }
+
+                //Numbers end at whatever follows them, which still needs handling
+                emitToken(JsonEvent::Number, listener);
+                afterValue();
+                if (!structural(c, listener)) {
+                    state = State::Failed;
+                }
+                break;
+            case State::Literal:
+                if (c != literal[literalIdx]) {
+                    state = State::Failed;
+                } else if (!literal[++literalIdx]) {
+                    listener.onJsonEvent(literalEvent, depth, nullptr, 0);
+                    afterValue();
+                }
+                break;
+            default:
+                if (!structural(c, listener)) {
+                    state = State::Failed;
+                }
+        }
+    }
+
+    return state != State::Failed;
+}
+
+bool JsonStreamTokenizer::structural(char c, JsonStreamListener &listener) {
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+        return true;
+    }
+
+    switch (state) {
+        case State::Value:
+        case State::ValueOrArrayEnd:
+            if (c == '{') {
+                listener.onJsonEvent(JsonEvent::ObjectStart, depth, nullptr, 0);
+                state = State::KeyOrObjectEnd;
+                return push(true);
+            } else if (c == '[') {
+                listener.onJsonEvent(JsonEvent::ArrayStart, depth, nullptr, 0);
+                state = State::ValueOrArrayEnd;
+                return push(false);
+            } else if (c == '"') {
+                stringIsKey = false;
+                startToken(State::String);
+                return true;
+            } else if (c == '-' || isdigit(c)) {
+                startToken(State::Number);
+                append(c);
+                return true;
+            } else if (c == 't' || c == 'f' || c == 'n') {
+                literal = c == 't' ? "true" : c == 'f' ? "false" : "null";
+                literalEvent = c == 't' ? JsonEvent::True : c == 'f' ? JsonEvent::False : JsonEvent::Null;
+                literalIdx = 1;
+                state = State::Literal;
+                return true;
+            } else if (c == ']' && state == State::ValueOrArrayEnd) {
+                depth--;
+                listener.onJsonEvent(JsonEvent::ArrayEnd, depth, nullptr, 0);
+                afterValue();
+                return true;
+            }
+            return false;
+        case State::Key:
+        case State::KeyOrObjectEnd:
+            if (c == '"') {
+                stringIsKey = true;
+                startToken(State::String);
+                return true;
+            } else if (c == '}' && state == State::KeyOrObjectEnd) {
+                depth--;
+                listener.onJsonEvent(JsonEvent::ObjectEnd, depth, nullptr, 0);
+                afterValue();
+                return true;
+            }
+            return false;
+        case State::Colon:
+            if (c == ':') {
+                state = State::Value;
+                return true;
+            }
+            return false;
+        case State::CommaOrEnd:
+            if (c == ',') {
+                state = inObject() ? State::Key : State::Value;
+                return true;
+            } else if (c == (inObject() ? '}' : ']')) {
+                bool wasObject = inObject();
+                depth--;
+                listener.onJsonEvent(wasObject ? JsonEvent::ObjectEnd : JsonEvent::ArrayEnd, depth, nullptr, 0);
+                afterValue();
+                return true;
+            }
+            return false;
+        default:
+            //Only whitespace may follow the top level value
+            return false;
+    }
+}
+
+bool JsonStreamTokenizer::push(bool isObject) {
+    if (depth >= JSON_STREAM_MAX_DEPTH) {
+        return false;
+    }
+
+    if (isObject) {
+        objectBits |= (uint32_t) 1 << depth;
+    } else {
+        objectBits &= ~((uint32_t) 1 << depth);
+    }
+    depth++;
+    return true;
+}
+
+void JsonStreamTokenizer::afterValue() {
+    state = depth == 0 ? State::Done : State::CommaOrEnd;
+}
+
+void JsonStreamTokenizer::startToken(State tokenState) {
+    tokenLen = 0;
+    tokenTruncated = false;
+    highSurrogate = 0;
+    state = tokenState;
+}
+
+void JsonStreamTokenizer::append(char c) {
+    if (tokenLen < tokenBytes - 1) {
+        token[tokenLen++] = c;
+    } else if (!tokenTruncated) {
+        tokenTruncated = true;
+        truncatedTokens++;
+    }
+}
+
+void JsonStreamTokenizer::appendCodepoint(uint32_t codepoint) {
+    if (codepoint >= 0xD800 && codepoint < 0xDC00) {
+        //First half of a surrogate pair, wait for the second
+        highSurrogate = codepoint;
+        return;
+    } else if (codepoint >= 0xDC00 && codepoint < 0xE000) {
+        if (!highSurrogate) {
+            return;
+        }
+        codepoint = 0x10000 + (((uint32_t) highSurrogate - 0xD800) << 10) + (codepoint - 0xDC00);
+    }
+    highSurrogate = 0;
+
+    if (codepoint < 0x80) {
+        append((char) codepoint);
+    } else if (codepoint < 0x800) {
+        append((char) (0xC0 | (codepoint >> 6)));
+        append((char) (0x80 | (codepoint & 0x3F)));
+    } else if (codepoint < 0x10000) {
+        append((char) (0xE0 | (codepoint >> 12)));
+        append((char) (0x80 | ((codepoint >> 6) & 0x3F)));
+        append((char) (0x80 | (codepoint & 0x3F)));
+    } else {
+        append((char) (0xF0 | (codepoint >> 18)));
+        append((char) (0x80 | ((codepoint >> 12) & 0x3F)));
+        append((char) (0x80 | ((codepoint >> 6) & 0x3F)));
+        append((char) (0x80 | (codepoint & 0x3F)));
+    }
+}
+
+void JsonStreamTokenizer::emitToken(JsonEvent event, JsonStreamListener &listener) {
+    token[tokenLen] = '\0';
+    listener.onJsonEvent(event, depth, token, tokenLen);
+}
+
+PlaylistStreamDecoder::PlaylistStreamDecoder(Playlist &playlist, size_t itemLimit)
+        : playlist(playlist), itemLimit(itemLimit) {
+    playlist.id = "";
+    playlist.position = 0;
+    playlist.currentDurationMs = 0;
+    playlist.remainingCurrentMs = 0;
+    playlist.numItems = 0;
+}
+
+void PlaylistStreamDecoder::onJsonEvent(JsonEvent event, uint8_t depth, const char *text, size_t len) {
+    //{"playlist":{"id":..,"position":..,"ms":..,"remainingMs":..,"items":[{"id":..,"ms":..},..]}}
+    if (event == JsonEvent::Key) {
+        if (depth == 1) {
+            inPlaylist = !strcmp(text, "playlist");
+        } else if (depth == 2 && inPlaylist) {
+            field = !strcmp(text, "id") ? Field::Id
+                    : !strcmp(text, "position") ? Field::Position
+                    : !strcmp(text, "ms") ? Field::Ms
+                    : !strcmp(text, "remainingMs") ? Field::RemainingMs
+                    : !strcmp(text, "items") ? Field::Items : Field::Other;
+        } else if (depth == 4 && item) {
+            itemField = !strcmp(text, "id") ? Field::Id : !strcmp(text, "ms") ? Field::Ms : Field::Other;
+        }
+        return;
+    }
+
+    if (!inPlaylist) {
+        return;
+    }
+
+    if (depth == 2) {
+        if (field == Field::Id && event == JsonEvent::String) {
+            playlist.id = text;
+        } else if (field == Field::Position && event == JsonEvent::Number) {
+            playlist.position = atoi(text);
+            positionSeen = true;
+        } else if (field == Field::Ms && event == JsonEvent::Number) {
+            playlist.currentDurationMs = atoi(text);
+        } else if (field == Field::RemainingMs && event == JsonEvent::Number) {
+            playlist.remainingCurrentMs = atoi(text);
+        }
+    } else if (depth == 3 && field == Field::Items) {
+        if (event == JsonEvent::ObjectStart) {
+            if ((size_t) playlist.numItems < itemLimit) {
+                item = &playlist.items[playlist.numItems++];
+                item->id = "";
+                item->durationMs = 0;
+            } else {
+                item = nullptr;
+                droppedItems++;
+            }
+            itemField = Field::Other;
+        } else if (event == JsonEvent::ObjectEnd) {
+            item = nullptr;
+        }
+    } else if (depth == 4 && item) {
+        if (itemField == Field::Id && event == JsonEvent::String) {
+            item->id = text;
+        } else if (itemField == Field::Ms && event == JsonEvent::Number) {
+            item->durationMs = atoi(text);
+        }
+    }
+}
+
+SequencerStreamDecoder::SequencerStreamDecoder(SequencerState &state, size_t controlLimit)
+        : state(state), controlLimit(controlLimit) {
+    state.name = "";
+    state.activeProgramId = "";
+    state.controlCount = 0;
+    state.sequencerMode = SequencerMode::Off;
+    state.runSequencer = false;
+    state.playlistPos = 0;
+    state.playlistId = "";
+    state.ttlMs = 0;
+    state.remainingMs = 0;
+}
+
+void SequencerStreamDecoder::onJsonEvent(JsonEvent event, uint8_t depth, const char *text, size_t len) {
+    //{"activeProgram":{"name":..,"activeProgramId":..,"controls":{..}},"sequencerMode":..,"runSequencer":..,
+    // "playlist":{"position":..,"id":..,"ms":..,"remainingMs":..}}
+    if (event == JsonEvent::Key) {
+        if (depth == 1) {
+            topField = !strcmp(text, "activeProgram") ? Field::ActiveProgram
+                       : !strcmp(text, "sequencerMode") ? Field::SequencerMode
+                       : !strcmp(text, "runSequencer") ? Field::RunSequencer
+                       : !strcmp(text, "playlist") ? Field::Playlist : Field::Other;
+            field = Field::Other;
+            control = nullptr;
+        } else if (depth == 2 && topField == Field::ActiveProgram) {
+            field = !strcmp(text, "name") ? Field::Name
+                    : !strcmp(text, "activeProgramId") ? Field::ActiveProgramId
+                    : !strcmp(text, "controls") ? Field::Controls : Field::Other;
+        } else if (depth == 2 && topField == Field::Playlist) {
+            field = !strcmp(text, "position") ? Field::Position
+                    : !strcmp(text, "id") ? Field::Id
+                    : !strcmp(text, "ms") ? Field::Ms
+                    : !strcmp(text, "remainingMs") ? Field::RemainingMs : Field::Other;
+        } else if (depth == 2) {
+            field = Field::Other;
+        } else if (depth == 3 && topField == Field::ActiveProgram && field == Field::Controls) {
+            //Controls that aren't a single number, like color pickers, read as 0
+            if (state.controlCount < controlLimit) {
+                control = &state.controls[state.controlCount++];
+                control->name = text;
+                control->value = 0;
+            } else {
+                control = nullptr;
+                droppedControls++;
+            }
+        }
+        return;
+    }
+
+    if (depth == 1) {
+        if (topField == Field::SequencerMode && event == JsonEvent::Number) {
+            state.sequencerMode = sequencerModeFromInt(atoi(text));
+        } else if (topField == Field::RunSequencer && (event == JsonEvent::True || event == JsonEvent::False)) {
+            state.runSequencer = event == JsonEvent::True;
+        }
+    } else if (depth == 2 && event == JsonEvent::String) {
+        if (field == Field::Name) {
+            state.name = text;
+        } else if (field == Field::ActiveProgramId) {
+            state.activeProgramId = text;
+        } else if (field == Field::Id) {
+            state.playlistId = text;
+        }
+    } else if (depth == 2 && event == JsonEvent::Number) {
+        if (field == Field::Position) {
+            state.playlistPos = atoi(text);
+        } else if (field == Field::Ms) {
+            state.ttlMs = atoi(text);
+        } else if (field == Field::RemainingMs) {
+            state.remainingMs = atoi(text);
+        }
+    } else if (depth == 3 && control && event == JsonEvent::Number) {
+        control->value = (float) atof(text);
+    }
+}
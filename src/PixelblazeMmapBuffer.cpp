@@ -0,0 +1,383 @@
+#include "PixelblazeMmapBuffer.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Size a file, reserving its blocks where the filesystem allows so writes through the mapping can't fail for space
+ */
+static bool preallocate(int fd, size_t len) {
+#ifdef __linux__
+    if (posix_fallocate(fd, 0, (off_t) len) == 0) {
+        return true;
+    }
+#endif
+    return ftruncate(fd, (off_t) len) == 0;
+}
+
+PixelblazeMmapBuffer::PixelblazeMmapBuffer(const char *directory, size_t segmentBytes, size_t budgetBytes)
+        : root(directory), segmentBytes(max(segmentBytes, (size_t) 1)) {
+    if (!root.endsWith("/")) {
+        root = root + "/";
+    }
+
+    this->budgetBytes = max(budgetBytes, this->segmentBytes);
+    maxSegments = this->budgetBytes / this->segmentBytes;
+    segments = new Segment[maxSegments];
+
+    if (mkdir(root.c_str(), 0700) != 0 && errno != EEXIST) {
+        Serial.print(F("Couldn't create buffer directory: "));
+        Serial.println(root);
+    }
+}
+
+PixelblazeMmapBuffer::~PixelblazeMmapBuffer() {
+    //Like PixelblazeMemBuffer, any streams still open are about to get hosed
+    for (size_t idx = 0; idx < maxSegments; idx++) {
+        releaseSegment(segments[idx]);
+    }
+
+    delete[] segments;
+}
+
+CloseableStream *PixelblazeMmapBuffer::makeWriteStream(String &key, bool append) {
+    uint32_t hash = hashKey(key);
+    int segmentIdx = findSegment(key, hash);
+    if (segmentIdx >= 0) {
+        if (!append) {
+            segments[segmentIdx].used = 0;
+        }
+    } else if (append) {
+        //What was being appended to is gone, starting over empty would pass off the rest as the whole
+        return nullptr;
+    } else {
+        segmentIdx = claimSegment();
+        if (segmentIdx < 0) {
+            return nullptr;
+        }
+
+        Segment &segment = segments[segmentIdx];
+        segment.name = key;
+        segment.hash = hash;
+        segment.used = 0;
+        segment.live = true;
+    }
+
+    segments[segmentIdx].incomplete = true;
+    return openStream(segmentIdx, false);
+}
+
+CloseableStream *PixelblazeMmapBuffer::makeReadStream(String &key) {
+    int segmentIdx = findSegment(key, hashKey(key));
+    if (segmentIdx < 0) {
+        return nullptr;
+    }
+
+    segments[segmentIdx].incomplete = false;
+    return openStream(segmentIdx, true);
+}
+
+void PixelblazeMmapBuffer::deleteStreamResults(String &key) {
+    int segmentIdx = findSegment(key, hashKey(key));
+    if (segmentIdx < 0) {
+        return;
+    }
+
+    //The file stays mapped for the next buffer to reuse
+    Segment &segment = segments[segmentIdx];
+    segment.name = "";
+    segment.live = false;
+    segment.incomplete = false;
+    segment.used = 0;
+}
+
+void PixelblazeMmapBuffer::garbageCollect() {
+    //Give back whatever spares grew past a segment
+    bool haveSpare = false;
+    for (size_t idx = 0; idx < maxSegments; idx++) {
+        Segment &segment = segments[idx];
+        if (!segment.live && segment.fd >= 0) {
+            if (segment.capacity > segmentBytes && !resizeSegment(segment, segmentBytes)) {
+                releaseSegment(segment);
+            } else {
+                haveSpare = true;
+            }
+        }
+    }
+
+    bool haveUnopened = false;
+    for (size_t idx = 0; idx < maxSegments; idx++) {
+        haveUnopened |= segments[idx].fd < 0;
+    }
+    if (haveSpare || (haveUnopened && diskBytes + segmentBytes <= budgetBytes)) {
+        return;
+    }
+
+    int evicted = evictLeastRecentlyUsed(nullptr);
+    if (evicted < 0) {
+        Serial.println(F("Every mapped buffer is open or unread, nothing to evict"));
+    } else if (segments[evicted].capacity > segmentBytes && !resizeSegment(segments[evicted], segmentBytes)) {
+        releaseSegment(segments[evicted]);
+    }
+}
+
+uint32_t PixelblazeMmapBuffer::hashKey(String &key) {
+    //FNV-1a
+    uint32_t hash = 2166136261u;
+    const char *chars = key.c_str();
+    for (size_t idx = 0; idx < key.length(); idx++) {
+        hash = (hash ^ (uint8_t) chars[idx]) * 16777619u;
+    }
+
+    return hash;
+}
+
+int PixelblazeMmapBuffer::findSegment(String &key, uint32_t hash) const {
+    for (size_t idx = 0; idx < maxSegments; idx++) {
+        if (segments[idx].live && segments[idx].hash == hash && key.equals(segments[idx].name)) {
+            return (int) idx;
+        }
+    }
+
+    return -1;
+}
+
+int PixelblazeMmapBuffer::claimSegment() {
+    int unopened = -1;
+    for (size_t idx = 0; idx < maxSegments; idx++) {
+        if (!segments[idx].live && segments[idx].fd >= 0) {
+            return (int) idx;
+        } else if (segments[idx].fd < 0 && unopened < 0) {
+            unopened = (int) idx;
+        }
+    }
+
+    if (unopened < 0 || diskBytes + segmentBytes > budgetBytes || !openSegment(unopened)) {
+        return -1;
+    }
+
+    return unopened;
+}
+
+bool PixelblazeMmapBuffer::openSegment(size_t segmentIdx) {
+    Segment &segment = segments[segmentIdx];
+    String path = root + "segment-" + String((unsigned int) segmentIdx);
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        Serial.print(F("Couldn't open segment file: "));
+        Serial.println(path);
+        return false;
+    }
+
+    void *data = MAP_FAILED;
+    if (preallocate(fd, segmentBytes)) {
+        data = mmap(nullptr, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (data == MAP_FAILED) {
+        Serial.print(F("Couldn't map segment file: "));
+        Serial.println(path);
+        close(fd);
+        unlink(path.c_str());
+        return false;
+    }
+
+    segment.fd = fd;
+    segment.data = (uint8_t *) data;
+    segment.capacity = segmentBytes;
+    diskBytes += segmentBytes;
+    return true;
+}
+
+void PixelblazeMmapBuffer::releaseSegment(Segment &segment) {
+    if (segment.fd < 0) {
+        return;
+    }
+
+    munmap(segment.data, segment.capacity);
+    close(segment.fd);
+    String path = root + "segment-" + String((unsigned int) (&segment - segments));
+    unlink(path.c_str());
+
+    diskBytes -= segment.capacity;
+    segment = Segment();
+}
+
+bool PixelblazeMmapBuffer::resizeSegment(Segment &segment, size_t capacity) {
+    //Growing, the file has to cover the mapping before it's touched. Shrinking, the mapping goes first.
+    if (capacity > segment.capacity && !preallocate(segment.fd, capacity)) {
+        return false;
+    }
+
+#ifdef __linux__
+    void *data = mremap(segment.data, segment.capacity, capacity, MREMAP_MAYMOVE);
+#else
+    void *data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, segment.fd, 0);
+    if (data != MAP_FAILED) {
+        munmap(segment.data, segment.capacity);
+    }
+#endif
+    if (data == MAP_FAILED) {
+        Serial.println(F("Couldn't remap segment file"));
+        return false;
+    }
+
+    if (capacity < segment.capacity && ftruncate(segment.fd, (off_t) capacity) != 0) {
+        Serial.println(F("Couldn't truncate segment file"));
+    }
+
+    diskBytes = diskBytes - segment.capacity + capacity;
+    segment.data = (uint8_t *) data;
+    segment.capacity = capacity;
+    return true;
+}
+
+bool PixelblazeMmapBuffer::growSegment(Segment &segment) {
+    size_t wanted = segment.capacity;
+    while (diskBytes + wanted > budgetBytes) {
+        int spare = -1;
+        for (size_t idx = 0; idx < maxSegments && spare < 0; idx++) {
+            if (!segments[idx].live && segments[idx].fd >= 0) {
+                spare = (int) idx;
+            }
+        }
+        if (spare < 0) {
+            spare = evictLeastRecentlyUsed(&segment);
+        }
+        if (spare < 0) {
+            break;
+        }
+
+        releaseSegment(segments[spare]);
+    }
+
+    size_t extra = min(wanted, budgetBytes - diskBytes);
+    return extra > 0 && resizeSegment(segment, segment.capacity + extra);
+}
+
+int PixelblazeMmapBuffer::evictLeastRecentlyUsed(const Segment *keep) {
+    int oldest = -1;
+    for (size_t idx = 0; idx < maxSegments; idx++) {
+        Segment &segment = segments[idx];
+        if (segment.live && !segment.incomplete && segment.openStreams == 0 && &segment != keep
+            && (oldest < 0 || (int32_t) (segment.lastUse - segments[oldest].lastUse) < 0)) {
+            oldest = (int) idx;
+        }
+    }
+
+    if (oldest >= 0) {
+        Segment &segment = segments[oldest];
+        segment.name = "";
+        segment.live = false;
+        segment.used = 0;
+    }
+
+    return oldest;
+}
+
+CloseableStream *PixelblazeMmapBuffer::openStream(size_t segmentIdx, bool readable) {
+    segments[segmentIdx].lastUse = ++useClock;
+    auto *stream = new MmapStream(*this, segmentIdx, readable);
+    return new CloseableStream(stream, nullptr, closeMmapStream, stream);
+}
+
+void PixelblazeMmapBuffer::closeMmapStream(Stream *stream) {
+    static_cast<MmapStream *>(stream)->close();
+}
+
+MmapStream::MmapStream(PixelblazeMmapBuffer &owner, size_t segmentIdx, bool readable)
+        : owner(owner), segment(owner.segments[segmentIdx]), readable(readable) {
+    segment.openStreams++;
+}
+
+void MmapStream::close() {
+    if (!closed) {
+        segment.openStreams--;
+        closed = true;
+    }
+}
+
+size_t MmapStream::write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        size_t space;
+        uint8_t *dest = borrowWrite(space);
+        if (!dest) {
+            break;
+        }
+
+        size_t toWrite = min(space, size - written);
+        memcpy(dest, buffer + written, toWrite);
+        commitWrite(toWrite);
+        written += toWrite;
+    }
+
+    return written;
+}
+
+int MmapStream::read() {
+    int v = peek();
+    if (v >= 0) {
+        readPos++;
+    }
+
+    return v;
+}
+
+size_t MmapStream::readBytes(char *buffer, size_t length) {
+    size_t len;
+    const uint8_t *src = borrowRead(len);
+    len = min(len, length);
+    if (len > 0) {
+        memcpy(buffer, src, len);
+        readPos += len;
+    }
+
+    return len;
+}
+
+int MmapStream::peek() {
+    if (!readable || readPos >= segment.used) {
+        return -1;
+    }
+
+    return segment.data[readPos];
+}
+
+const uint8_t *MmapStream::borrowRead(size_t &len) {
+    if (!readable || readPos >= segment.used) {
+        len = 0;
+        return nullptr;
+    }
+
+    len = segment.used - readPos;
+    return segment.data + readPos;
+}
+
+void MmapStream::consumeRead(size_t len) {
+    readPos += len;
+}
+
+uint8_t *MmapStream::borrowWrite(size_t &len) {
+    len = 0;
+    if (readable || segment.fd < 0) {
+        return nullptr;
+    }
+
+    if (segment.used == segment.capacity && !owner.growSegment(segment)) {
+        return nullptr;
+    }
+
+    len = segment.capacity - segment.used;
+    return segment.data + segment.used;
+}
+
+void MmapStream::commitWrite(size_t len) {
+    segment.used += len;
+}
+
+#endif
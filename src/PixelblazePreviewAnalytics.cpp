@@ -0,0 +1,329 @@
+#include "PixelblazePreviewAnalytics.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define PREVIEW_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+//Luminance is computed in 16 bits and shifted straight down to a bin index
+#define LUMA_BIN_SHIFT (8 + __builtin_ctz(256 / PREVIEW_HISTOGRAM_BINS))
+
+//Consecutive pixels of flat frames land in the same bin, spreading them over several counters avoids every
+//increment waiting on the one before it
+#define HISTOGRAM_LANES 4
+
+struct KernelAccumulator {
+    uint64_t sums[3];
+    uint8_t peaks[3];
+    uint32_t histogram[HISTOGRAM_LANES][PREVIEW_HISTOGRAM_BINS];
+};
+
+typedef void (*PreviewKernelFn)(const uint8_t *rgb, size_t pixels, KernelAccumulator &acc);
+
+static void scalarKernel(const uint8_t *rgb, size_t pixels, KernelAccumulator &acc) {
+    for (size_t pixel = 0; pixel < pixels; pixel++) {
+        uint8_t red = rgb[0];
+        uint8_t green = rgb[1];
+        uint8_t blue = rgb[2];
+        rgb += 3;
+
+        acc.sums[0] += red;
+        acc.sums[1] += green;
+        acc.sums[2] += blue;
+        acc.peaks[0] = max(acc.peaks[0], red);
+        acc.peaks[1] = max(acc.peaks[1], green);
+        acc.peaks[2] = max(acc.peaks[2], blue);
+
+        uint16_t luma = 77 * red + 150 * green + 29 * blue;
+        acc.histogram[pixel % HISTOGRAM_LANES][luma >> LUMA_BIN_SHIFT]++;
+    }
+}
+
+#ifdef PREVIEW_X86_KERNELS
+
+/*
+ * Both x86 kernels work on 16 pixel groups: three 16 byte loads are split into one vector per channel with byte
+ * shuffles, pixel n of the group in byte n of each. AVX2 runs two groups at once, one per 128 bit lane.
+ */
+#define Z (-1)
+#define DEINTERLEAVE_MASKS(a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15) \
+    _mm_setr_epi8(a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15)
+
+//Inlined into the AVX2 kernel too, where it's VEX encoded and avoids SSE/AVX transition stalls
+#define SSSE3_INLINE __attribute__((target("ssse3"), always_inline)) inline
+
+SSSE3_INLINE
+static void deinterleaveMasks(__m128i masks[9]) {
+    //Red: pixels 0-5 from the first load, 6-10 from the second, 11-15 from the third
+    masks[0] = DEINTERLEAVE_MASKS(0, 3, 6, 9, 12, 15, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z);
+    masks[1] = DEINTERLEAVE_MASKS(Z, Z, Z, Z, Z, Z, 2, 5, 8, 11, 14, Z, Z, Z, Z, Z);
+    masks[2] = DEINTERLEAVE_MASKS(Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, 1, 4, 7, 10, 13);
+    //Green: pixels 0-4, 5-10, 11-15
+    masks[3] = DEINTERLEAVE_MASKS(1, 4, 7, 10, 13, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z);
+    masks[4] = DEINTERLEAVE_MASKS(Z, Z, Z, Z, Z, 0, 3, 6, 9, 12, 15, Z, Z, Z, Z, Z);
+    masks[5] = DEINTERLEAVE_MASKS(Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, 2, 5, 8, 11, 14);
+    //Blue: pixels 0-4, 5-9, 10-15
+    masks[6] = DEINTERLEAVE_MASKS(2, 5, 8, 11, 14, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z);
+    masks[7] = DEINTERLEAVE_MASKS(Z, Z, Z, Z, Z, 1, 4, 7, 10, 13, Z, Z, Z, Z, Z, Z);
+    masks[8] = DEINTERLEAVE_MASKS(Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, 0, 3, 6, 9, 12, 15);
+}
+
+#undef DEINTERLEAVE_MASKS
+#undef Z
+
+SSSE3_INLINE
+static const uint8_t *ssse3Groups(const uint8_t *rgb, size_t groups, KernelAccumulator &acc) {
+    __m128i masks[9];
+    deinterleaveMasks(masks);
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i redWeight = _mm_set1_epi16(77);
+    const __m128i greenWeight = _mm_set1_epi16(150);
+    const __m128i blueWeight = _mm_set1_epi16(29);
+
+    __m128i sums[3] = {zero, zero, zero};
+    __m128i peaks[3] = {zero, zero, zero};
+    alignas(16) uint8_t bins[16];
+
+    for (size_t group = 0; group < groups; group++) {
+        __m128i a = _mm_loadu_si128((const __m128i *) rgb);
+        __m128i b = _mm_loadu_si128((const __m128i *) (rgb + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *) (rgb + 32));
+        rgb += 48;
+
+        __m128i channels[3];
+        for (int channel = 0; channel < 3; channel++) {
+            channels[channel] = _mm_or_si128(
+                    _mm_or_si128(_mm_shuffle_epi8(a, masks[channel * 3]),
+                                 _mm_shuffle_epi8(b, masks[channel * 3 + 1])),
+                    _mm_shuffle_epi8(c, masks[channel * 3 + 2]));
+            sums[channel] = _mm_add_epi64(sums[channel], _mm_sad_epu8(channels[channel], zero));
+            peaks[channel] = _mm_max_epu8(peaks[channel], channels[channel]);
+        }
+
+        __m128i lumaLow = _mm_add_epi16(
+                _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(channels[0], zero), redWeight),
+                              _mm_mullo_epi16(_mm_unpacklo_epi8(channels[1], zero), greenWeight)),
+                _mm_mullo_epi16(_mm_unpacklo_epi8(channels[2], zero), blueWeight));
+        __m128i lumaHigh = _mm_add_epi16(
+                _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(channels[0], zero), redWeight),
+                              _mm_mullo_epi16(_mm_unpackhi_epi8(channels[1], zero), greenWeight)),
+                _mm_mullo_epi16(_mm_unpackhi_epi8(channels[2], zero), blueWeight));
+        _mm_store_si128((__m128i *) bins, _mm_packus_epi16(_mm_srli_epi16(lumaLow, LUMA_BIN_SHIFT),
+                                                           _mm_srli_epi16(lumaHigh, LUMA_BIN_SHIFT)));
+
+        for (int idx = 0; idx < 16; idx++) {
+            acc.histogram[idx % HISTOGRAM_LANES][bins[idx]]++;
+        }
+    }
+
+    alignas(16) uint64_t sumLanes[2];
+    alignas(16) uint8_t peakLanes[16];
+    for (int channel = 0; channel < 3; channel++) {
+        _mm_store_si128((__m128i *) sumLanes, sums[channel]);
+        acc.sums[channel] += sumLanes[0] + sumLanes[1];
+
+        _mm_store_si128((__m128i *) peakLanes, peaks[channel]);
+        for (uint8_t peak: peakLanes) {
+            acc.peaks[channel] = max(acc.peaks[channel], peak);
+        }
+    }
+
+    return rgb;
+}
+
+__attribute__((target("ssse3")))
+static void ssse3Kernel(const uint8_t *rgb, size_t pixels, KernelAccumulator &acc) {
+    rgb = ssse3Groups(rgb, pixels / 16, acc);
+    scalarKernel(rgb, pixels % 16, acc);
+}
+
+__attribute__((target("avx2")))
+static void avx2Kernel(const uint8_t *rgb, size_t pixels, KernelAccumulator &acc) {
+    __m128i halfMasks[9];
+    deinterleaveMasks(halfMasks);
+    __m256i masks[9];
+    for (int idx = 0; idx < 9; idx++) {
+        masks[idx] = _mm256_broadcastsi128_si256(halfMasks[idx]);
+    }
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i redWeight = _mm256_set1_epi16(77);
+    const __m256i greenWeight = _mm256_set1_epi16(150);
+    const __m256i blueWeight = _mm256_set1_epi16(29);
+
+    __m256i sums[3] = {zero, zero, zero};
+    __m256i peaks[3] = {zero, zero, zero};
+    alignas(32) uint8_t bins[32];
+
+    size_t groups = pixels / 32;
+    for (size_t group = 0; group < groups; group++) {
+        //Low lane gets pixels 0-15, high lane pixels 16-31
+        __m256i a = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) rgb)),
+                                            _mm_loadu_si128((const __m128i *) (rgb + 48)), 1);
+        __m256i b = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) (rgb + 16))),
+                                            _mm_loadu_si128((const __m128i *) (rgb + 64)), 1);
+        __m256i c = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) (rgb + 32))),
+                                            _mm_loadu_si128((const __m128i *) (rgb + 80)), 1);
+        rgb += 96;
+
+        __m256i channels[3];
+        for (int channel = 0; channel < 3; channel++) {
+            channels[channel] = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_shuffle_epi8(a, masks[channel * 3]),
+                                    _mm256_shuffle_epi8(b, masks[channel * 3 + 1])),
+                    _mm256_shuffle_epi8(c, masks[channel * 3 + 2]));
+            sums[channel] = _mm256_add_epi64(sums[channel], _mm256_sad_epu8(channels[channel], zero));
+            peaks[channel] = _mm256_max_epu8(peaks[channel], channels[channel]);
+        }
+
+        //Unpack and pack both work within lanes, so bins come out in a different order than the pixels. Nothing
+        //downstream cares which pixel landed in which bin.
+        __m256i lumaLow = _mm256_add_epi16(
+                _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(channels[0], zero), redWeight),
+                                 _mm256_mullo_epi16(_mm256_unpacklo_epi8(channels[1], zero), greenWeight)),
+                _mm256_mullo_epi16(_mm256_unpacklo_epi8(channels[2], zero), blueWeight));
+        __m256i lumaHigh = _mm256_add_epi16(
+                _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(channels[0], zero), redWeight),
+                                 _mm256_mullo_epi16(_mm256_unpackhi_epi8(channels[1], zero), greenWeight)),
+                _mm256_mullo_epi16(_mm256_unpackhi_epi8(channels[2], zero), blueWeight));
+        _mm256_store_si256((__m256i *) bins, _mm256_packus_epi16(_mm256_srli_epi16(lumaLow, LUMA_BIN_SHIFT),
+                                                                 _mm256_srli_epi16(lumaHigh, LUMA_BIN_SHIFT)));
+
+        for (int idx = 0; idx < 32; idx++) {
+            acc.histogram[idx % HISTOGRAM_LANES][bins[idx]]++;
+        }
+    }
+
+    alignas(32) uint64_t sumLanes[4];
+    alignas(32) uint8_t peakLanes[32];
+    for (int channel = 0; channel < 3; channel++) {
+        _mm256_store_si256((__m256i *) sumLanes, sums[channel]);
+        acc.sums[channel] += sumLanes[0] + sumLanes[1] + sumLanes[2] + sumLanes[3];
+
+        _mm256_store_si256((__m256i *) peakLanes, peaks[channel]);
+        for (uint8_t peak: peakLanes) {
+            acc.peaks[channel] = max(acc.peaks[channel], peak);
+        }
+    }
+
+    //GCC doesn't add this for functions that only get AVX through a target attribute, and without it the legacy SSE
+    //code the caller was compiled to stalls on the dirty upper halves
+    _mm256_zeroupper();
+
+    //Up to 31 pixels left
+    rgb = ssse3Groups(rgb, (pixels % 32) / 16, acc);
+    scalarKernel(rgb, pixels % 16, acc);
+}
+
+#undef SSSE3_INLINE
+
+#endif
+
+bool previewKernelAvailable(PreviewKernel kernel) {
+    switch (kernel) {
+        case PreviewKernel::Auto:
+        case PreviewKernel::Scalar:
+            return true;
+#ifdef PREVIEW_X86_KERNELS
+        case PreviewKernel::SSSE3:
+            return __builtin_cpu_supports("ssse3");
+        case PreviewKernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+static PreviewKernelFn pickKernel(PreviewKernel kernel) {
+    if (kernel == PreviewKernel::Auto) {
+        if (previewKernelAvailable(PreviewKernel::AVX2)) {
+            kernel = PreviewKernel::AVX2;
+        } else if (previewKernelAvailable(PreviewKernel::SSSE3)) {
+            kernel = PreviewKernel::SSSE3;
+        } else {
+            kernel = PreviewKernel::Scalar;
+        }
+    } else if (!previewKernelAvailable(kernel)) {
+        return nullptr;
+    }
+
+    switch (kernel) {
+#ifdef PREVIEW_X86_KERNELS
+        case PreviewKernel::SSSE3:
+            return ssse3Kernel;
+        case PreviewKernel::AVX2:
+            return avx2Kernel;
+#endif
+        default:
+            return scalarKernel;
+    }
+}
+
+static uint8_t mean(uint64_t sum, size_t count) {
+    if (count == 0) {
+        return 0;
+    }
+
+    return (uint8_t) ((sum + count / 2) / count);
+}
+
+bool analyzePreviewFrame(const uint8_t *previewPixelRGB, size_t len, PreviewFrameStats &stats,
+                         PreviewSegment *segments, size_t numSegments, PreviewKernel kernel) {
+    PreviewKernelFn kernelFn = pickKernel(kernel);
+    if (!kernelFn) {
+        return false;
+    }
+
+    size_t pixels = len / 3;
+    KernelAccumulator acc = {};
+    uint64_t totals[3] = {0, 0, 0};
+
+    if (!segments) {
+        numSegments = 0;
+    }
+
+    if (numSegments == 0) {
+        kernelFn(previewPixelRGB, pixels, acc);
+        for (int channel = 0; channel < 3; channel++) {
+            totals[channel] = acc.sums[channel];
+        }
+    } else {
+        //Segments tile the frame, so running the kernel over each in turn is still a single pass
+        for (size_t segmentIdx = 0; segmentIdx < numSegments; segmentIdx++) {
+            size_t start = pixels * segmentIdx / numSegments;
+            size_t end = pixels * (segmentIdx + 1) / numSegments;
+
+            acc.sums[0] = acc.sums[1] = acc.sums[2] = 0;
+            kernelFn(previewPixelRGB + start * 3, end - start, acc);
+
+            PreviewSegment &segment = segments[segmentIdx];
+            segment.firstPixel = start;
+            segment.pixelCount = end - start;
+            segment.red = mean(acc.sums[0], end - start);
+            segment.green = mean(acc.sums[1], end - start);
+            segment.blue = mean(acc.sums[2], end - start);
+
+            for (int channel = 0; channel < 3; channel++) {
+                totals[channel] += acc.sums[channel];
+            }
+        }
+    }
+
+    stats.pixelCount = pixels;
+    stats.avgRed = mean(totals[0], pixels);
+    stats.avgGreen = mean(totals[1], pixels);
+    stats.avgBlue = mean(totals[2], pixels);
+    stats.peakRed = acc.peaks[0];
+    stats.peakGreen = acc.peaks[1];
+    stats.peakBlue = acc.peaks[2];
+    for (size_t bin = 0; bin < PREVIEW_HISTOGRAM_BINS; bin++) {
+        stats.luminanceHistogram[bin] = 0;
+        for (auto &lane: acc.histogram) {
+            stats.luminanceHistogram[bin] += lane[bin];
+        }
+    }
+
+    return true;
+}
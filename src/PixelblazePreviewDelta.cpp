@@ -0,0 +1,159 @@
+#include "PixelblazePreviewDelta.h"
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * Offset of the first byte at or after from where a and b differ, to if there's none. Compares 16 bytes at a time
+ * with SSE2 where it's available, a machine word at a time elsewhere.
+ */
+static size_t firstDifference(const uint8_t *a, const uint8_t *b, size_t from, size_t to) {
+    size_t idx = from;
+#ifdef __SSE2__
+    while (idx + 16 <= to) {
+        __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (a + idx)),
+                                    _mm_loadu_si128((const __m128i *) (b + idx)));
+        int mask = _mm_movemask_epi8(eq);
+        if (mask != 0xFFFF) {
+            return idx + __builtin_ctz(~mask);
+        }
+        idx += 16;
+    }
+#else
+    while (idx + sizeof(size_t) <= to) {
+        size_t wordA, wordB;
+        memcpy(&wordA, a + idx, sizeof(size_t));
+        memcpy(&wordB, b + idx, sizeof(size_t));
+        if (wordA != wordB) {
+            break;
+        }
+        idx += sizeof(size_t);
+    }
+#endif
+
+    while (idx < to && a[idx] == b[idx]) {
+        idx++;
+    }
+
+    return idx;
+}
+
+PreviewFrameDiffer::PreviewFrameDiffer(size_t frameBytes, size_t maxRanges, size_t mergeGapPixels) :
+        frameBytes(frameBytes), maxRanges(max(maxRanges, (size_t) 1)), mergeGapPixels(mergeGapPixels) {
+    previous = new uint8_t[frameBytes];
+    ranges = new PixelRange[this->maxRanges];
+}
+
+PreviewFrameDiffer::~PreviewFrameDiffer() {
+    delete[] previous;
+    delete[] ranges;
+}
+
+void PreviewFrameDiffer::addRange(size_t firstPixel, size_t pixelCount) {
+    if (numRanges < maxRanges) {
+        ranges[numRanges++] = {firstPixel, pixelCount};
+    } else {
+        PixelRange &last = ranges[numRanges - 1];
+        last.pixelCount = firstPixel + pixelCount - last.firstPixel;
+    }
+}
+
+bool PreviewFrameDiffer::update(const uint8_t *previewPixelRGB, size_t len) {
+    len = min(len, frameBytes);
+    numRanges = 0;
+
+    size_t pixels = len / 3;
+    if (!havePrevious || len != previousLen) {
+        memcpy(previous, previewPixelRGB, len);
+        previousLen = len;
+        havePrevious = true;
+        if (pixels > 0) {
+            addRange(0, pixels);
+        }
+        return changed();
+    }
+
+    size_t byteIdx = 0;
+    size_t end = pixels * 3;
+    while (byteIdx < end) {
+        byteIdx = firstDifference(previous, previewPixelRGB, byteIdx, end);
+        if (byteIdx >= end) {
+            break;
+        }
+
+        //Extend the run until mergeGapPixels pass without a change. Inside a dirty run comparing pixel by pixel is
+        //fine, consumers are about to touch all of them anyway.
+        size_t firstDirty = byteIdx / 3;
+        size_t lastDirty = firstDirty;
+        for (size_t pixel = firstDirty + 1; pixel < pixels && pixel - lastDirty <= mergeGapPixels; pixel++) {
+            if (memcmp(previous + pixel * 3, previewPixelRGB + pixel * 3, 3) != 0) {
+                lastDirty = pixel;
+            }
+        }
+
+        size_t runBytes = (lastDirty - firstDirty + 1) * 3;
+        memcpy(previous + firstDirty * 3, previewPixelRGB + firstDirty * 3, runBytes);
+        addRange(firstDirty, lastDirty - firstDirty + 1);
+        byteIdx = (lastDirty + 1) * 3;
+    }
+
+    //Trailing bytes that don't make up a whole pixel are never reported, but are kept current
+    memcpy(previous + end, previewPixelRGB + end, len - end);
+
+    return changed();
+}
+
+size_t PreviewFrameDiffer::dirtyPixelCount() const {
+    size_t count = 0;
+    for (size_t idx = 0; idx < numRanges; idx++) {
+        count += ranges[idx].pixelCount;
+    }
+
+    return count;
+}
+
+size_t PreviewFrameDiffer::writeDelta(uint8_t *out, size_t outLen) const {
+    if (!changed() || outLen < deltaBytes()) {
+        return 0;
+    }
+
+    size_t written = 0;
+    for (size_t idx = 0; idx < numRanges; idx++) {
+        const PixelRange &range = ranges[idx];
+        out[written++] = range.firstPixel & 0xFF;
+        out[written++] = (range.firstPixel >> 8) & 0xFF;
+        out[written++] = range.pixelCount & 0xFF;
+        out[written++] = (range.pixelCount >> 8) & 0xFF;
+
+        memcpy(out + written, previous + range.firstPixel * 3, range.pixelCount * 3);
+        written += range.pixelCount * 3;
+    }
+
+    return written;
+}
+
+bool PreviewFrameDiffer::applyDelta(uint8_t *previewPixelRGB, size_t len, const uint8_t *delta, size_t deltaLen) {
+    size_t readIdx = 0;
+    while (readIdx < deltaLen) {
+        if (deltaLen - readIdx < PREVIEW_DELTA_RANGE_HEADER_BYTES) {
+            return false;
+        }
+
+        size_t firstPixel = delta[readIdx] | (delta[readIdx + 1] << 8);
+        size_t pixelCount = delta[readIdx + 2] | (delta[readIdx + 3] << 8);
+        readIdx += PREVIEW_DELTA_RANGE_HEADER_BYTES;
+
+        size_t rangeBytes = pixelCount * 3;
+        if (deltaLen - readIdx < rangeBytes || (firstPixel + pixelCount) * 3 > len) {
+            return false;
+        }
+
+        memcpy(previewPixelRGB + firstPixel * 3, delta + readIdx, rangeBytes);
+        readIdx += rangeBytes;
+    }
+
+    return true;
+}
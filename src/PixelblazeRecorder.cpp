@@ -0,0 +1,699 @@
+#include "PixelblazeRecorder.h"
+
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const uint8_t HEADER_MAGIC[4] = {'P', 'B', 'R', 'C'};
+static const uint8_t FOOTER_MAGIC[4] = {'P', 'B', 'I', 'X'};
+
+//Longest pattern id or name recorded, anything past this is cut off
+#define MAX_RECORDED_STRING_BYTES 200
+
+//A type byte and two varints
+#define MAX_RECORD_HEADER_BYTES 11
+
+static size_t putVarint(uint8_t *out, uint32_t value) {
+    size_t len = 0;
+    while (value >= 0x80) {
+        out[len++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[len++] = value;
+    return len;
+}
+
+static bool getVarint(const uint8_t *in, size_t inLen, size_t &pos, uint32_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && pos < inLen; shift += 7) {
+        uint8_t byte = in[pos++];
+        value |= (uint32_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static size_t putSigned(uint8_t *out, int32_t value) {
+    return putVarint(out, ((uint32_t) value << 1) ^ (uint32_t) (value >> 31));
+}
+
+static bool getSigned(const uint8_t *in, size_t inLen, size_t &pos, int &value) {
+    uint32_t raw;
+    if (!getVarint(in, inLen, pos, raw)) {
+        return false;
+    }
+
+    value = (int) ((raw >> 1) ^ (~(raw & 1) + 1));
+    return true;
+}
+
+static void putUint32(uint8_t *out, uint32_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = (value >> 24) & 0xFF;
+}
+
+static uint32_t getUint32(const uint8_t *in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t) in[3] << 24);
+}
+
+static size_t putString(uint8_t *out, const String &str) {
+    size_t len = min((size_t) str.length(), (size_t) MAX_RECORDED_STRING_BYTES);
+    size_t written = putVarint(out, len);
+    memcpy(out + written, str.c_str(), len);
+    return written + len;
+}
+
+static bool getString(const uint8_t *in, size_t inLen, size_t &pos, String &str) {
+    uint32_t len;
+    if (!getVarint(in, inLen, pos, len) || inLen - pos < len) {
+        return false;
+    }
+
+    str = String((const char *) in + pos, len);
+    pos += len;
+    return true;
+}
+
+/**
+ * Pixel run-length encoding, a sequence of tokens each starting with a varint: (count - 1) << 1 | 1 followed by one
+ * pixel repeated count times, or (count - 1) << 1 followed by count literal pixels.
+ */
+static size_t putPixels(uint8_t *out, const uint8_t *rgb, size_t pixels) {
+    size_t written = 0;
+    size_t literalStart = 0;
+    size_t pixel = 0;
+    while (pixel < pixels) {
+        size_t runEnd = pixel + 1;
+        while (runEnd < pixels && memcmp(rgb + runEnd * 3, rgb + pixel * 3, 3) == 0) {
+            runEnd++;
+        }
+
+        //Two identical pixels already encode smaller as a run, once the literal before them is flushed
+        if (runEnd - pixel < 2) {
+            pixel = runEnd;
+            continue;
+        }
+
+        if (pixel > literalStart) {
+            written += putVarint(out + written, (pixel - literalStart - 1) << 1);
+            memcpy(out + written, rgb + literalStart * 3, (pixel - literalStart) * 3);
+            written += (pixel - literalStart) * 3;
+        }
+
+        written += putVarint(out + written, ((runEnd - pixel - 1) << 1) | 1);
+        memcpy(out + written, rgb + pixel * 3, 3);
+        written += 3;
+
+        pixel = runEnd;
+        literalStart = runEnd;
+    }
+
+    if (pixels > literalStart) {
+        written += putVarint(out + written, (pixels - literalStart - 1) << 1);
+        memcpy(out + written, rgb + literalStart * 3, (pixels - literalStart) * 3);
+        written += (pixels - literalStart) * 3;
+    }
+
+    return written;
+}
+
+static bool getPixels(const uint8_t *in, size_t inLen, size_t &pos, uint8_t *rgb, size_t pixels) {
+    size_t pixel = 0;
+    while (pixel < pixels) {
+        uint32_t token;
+        if (!getVarint(in, inLen, pos, token)) {
+            return false;
+        }
+
+        size_t count = (token >> 1) + 1;
+        if (count > pixels - pixel) {
+            return false;
+        }
+
+        if (token & 1) {
+            if (inLen - pos < 3) {
+                return false;
+            }
+            for (size_t idx = 0; idx < count; idx++) {
+                memcpy(rgb + (pixel + idx) * 3, in + pos, 3);
+            }
+            pos += 3;
+        } else {
+            if (inLen - pos < count * 3) {
+                return false;
+            }
+            memcpy(rgb + pixel * 3, in + pos, count * 3);
+            pos += count * 3;
+        }
+
+        pixel += count;
+    }
+
+    return true;
+}
+
+PixelblazeRecorder::PixelblazeRecorder(Print &out, PixelblazeWatcher *downstream, RecorderConfig config) :
+        out(out), downstream(downstream), config(config),
+        differ(config.frameBytes, config.maxDirtyRanges, config.mergeGapPixels) {
+    //Run-length encoding never grows a frame by more than a token per pixel pair, ranges add two varints each
+    payloadBytes = config.frameBytes * 2 + config.maxDirtyRanges * 10 + 2 * MAX_RECORDED_STRING_BYTES + 64;
+    payload = new uint8_t[payloadBytes];
+    indexCapacity = max(config.indexEntries, (size_t) 1);
+    index = new RecordingIndexEntry[indexCapacity];
+}
+
+PixelblazeRecorder::~PixelblazeRecorder() {
+    delete[] payload;
+    delete[] index;
+}
+
+bool PixelblazeRecorder::begin() {
+    uint8_t header[RECORDING_HEADER_BYTES] = {0};
+    memcpy(header, HEADER_MAGIC, sizeof(HEADER_MAGIC));
+    header[4] = RECORDING_VERSION;
+
+    recording = writeBytes(header, sizeof(header));
+    return recording;
+}
+
+bool PixelblazeRecorder::finish() {
+    if (!recording) {
+        return false;
+    }
+    recording = false;
+
+    //Entry count, then time and offset deltas, which stay small. Sized up front so it can be written in chunks.
+    uint8_t scratch[5];
+    size_t indexLen = putVarint(scratch, indexCount);
+    for (size_t idx = 0; idx < indexCount; idx++) {
+        indexLen += putVarint(scratch, index[idx].timeMs - (idx > 0 ? index[idx - 1].timeMs : 0));
+        indexLen += putVarint(scratch, index[idx].offset - (idx > 0 ? index[idx - 1].offset : 0));
+    }
+
+    uint32_t indexOffset = written;
+    if (!writeRecordHeader(RecordType::Index, indexLen, millis())) {
+        return false;
+    }
+
+    size_t payloadLen = putVarint(payload, indexCount);
+    for (size_t idx = 0; idx < indexCount; idx++) {
+        if (payloadLen + 10 > payloadBytes) {
+            if (!writeBytes(payload, payloadLen)) {
+                return false;
+            }
+            payloadLen = 0;
+        }
+        payloadLen += putVarint(payload + payloadLen, index[idx].timeMs - (idx > 0 ? index[idx - 1].timeMs : 0));
+        payloadLen += putVarint(payload + payloadLen, index[idx].offset - (idx > 0 ? index[idx - 1].offset : 0));
+    }
+
+    uint8_t footer[RECORDING_FOOTER_BYTES];
+    putUint32(footer, indexOffset);
+    memcpy(footer + 4, FOOTER_MAGIC, sizeof(FOOTER_MAGIC));
+    return writeBytes(payload, payloadLen) && writeBytes(footer, sizeof(footer));
+}
+
+int PixelblazeRecorder::watchedEvents() {
+    int downstreamEvents = downstream ? downstream->watchedEvents() : 0;
+    return downstreamEvents | (int) WatchedEvent::Stats | (int) WatchedEvent::PatternChange
+           | (int) WatchedEvent::PreviewFrame;
+}
+
+void PixelblazeRecorder::handleStats(Stats &stats) {
+    if (recording) {
+        size_t len = 0;
+        memcpy(payload, &stats.fps, sizeof(float));
+        len += sizeof(float);
+        len += putSigned(payload + len, stats.vmerr);
+        len += putSigned(payload + len, stats.vmerrpc);
+        len += putSigned(payload + len, stats.memBytes);
+        len += putSigned(payload + len, stats.expansions);
+        len += putSigned(payload + len, (int) stats.renderType);
+        len += putSigned(payload + len, stats.uptimeMs);
+        len += putSigned(payload + len, stats.storageBytesUsed);
+        len += putSigned(payload + len, stats.storageBytesSize);
+        len += putSigned(payload + len, stats.rr0);
+        len += putSigned(payload + len, stats.rr1);
+        len += putSigned(payload + len, stats.rebootCounter);
+        writeRecord(RecordType::Stats, len, millis());
+    }
+
+    if (downstream) {
+        downstream->handleStats(stats);
+    }
+}
+
+void PixelblazeRecorder::handlePatternChange(SequencerState &patternChange) {
+    if (recording) {
+        size_t len = 0;
+        len += putString(payload + len, patternChange.activeProgramId);
+        len += putString(payload + len, patternChange.name);
+        len += putSigned(payload + len, patternChange.playlistPos);
+        writeRecord(RecordType::PatternChange, len, millis());
+    }
+
+    if (downstream) {
+        downstream->handlePatternChange(patternChange);
+    }
+}
+
+void PixelblazeRecorder::handlePreviewFrame(uint8_t *previewPixelRGB, size_t len) {
+    if (recording && differ.update(previewPixelRGB, len)) {
+        uint32_t now = millis();
+        const uint8_t *frame = differ.frame();
+        size_t pixels = differ.frameLen() / 3;
+
+        bool keyFrame = !keyFrameWritten || now - lastKeyFrameMs >= config.keyFrameEveryMs
+                        || (differ.dirtyRangeCount() == 1 && differ.dirtyPixelCount() == pixels);
+        size_t payloadLen = 0;
+        if (!keyFrame) {
+            //Ranges as (gap since the last one ended, length), then their pixels
+            payloadLen += putVarint(payload, differ.dirtyRangeCount());
+            size_t cursor = 0;
+            for (size_t idx = 0; idx < differ.dirtyRangeCount(); idx++) {
+                const PixelRange &range = differ.dirtyRanges()[idx];
+                payloadLen += putVarint(payload + payloadLen, range.firstPixel - cursor);
+                payloadLen += putVarint(payload + payloadLen, range.pixelCount);
+                payloadLen += putPixels(payload + payloadLen, frame + range.firstPixel * 3, range.pixelCount);
+                cursor = range.firstPixel + range.pixelCount;
+            }
+
+            //Most of the frame changed, a key frame costs about the same and gives seeks another landing spot
+            keyFrame = payloadLen >= pixels * 3;
+        }
+
+        if (keyFrame) {
+            payloadLen = putVarint(payload, pixels);
+            payloadLen += putPixels(payload + payloadLen, frame, pixels);
+
+            uint32_t offset = written;
+            if (writeRecord(RecordType::KeyFrame, payloadLen, now)) {
+                if (!keyFrameWritten || now - lastKeyFrameMs >= config.keyFrameEveryMs) {
+                    addIndexEntry(now, offset);
+                    lastKeyFrameMs = now;
+                }
+                keyFrameWritten = true;
+            }
+        } else {
+            writeRecord(RecordType::DeltaFrame, payloadLen, now);
+        }
+    }
+
+    if (downstream) {
+        downstream->handlePreviewFrame(previewPixelRGB, len);
+    }
+}
+
+void PixelblazeRecorder::handlePreviewChange(const PreviewFrameDiffer &diff) {
+    if (downstream) {
+        downstream->handlePreviewChange(diff);
+    }
+}
+
+void PixelblazeRecorder::handlePlaylistChange(PlaylistUpdate &playlistUpdate) {
+    if (downstream) {
+        downstream->handlePlaylistChange(playlistUpdate);
+    }
+}
+
+bool PixelblazeRecorder::writeRecord(RecordType type, size_t payloadLen, uint32_t timeMs) {
+    if (!writeRecordHeader(type, payloadLen, timeMs) || !writeBytes(payload, payloadLen)) {
+        writeFailures++;
+        return false;
+    }
+
+    return true;
+}
+
+bool PixelblazeRecorder::writeRecordHeader(RecordType type, size_t payloadLen, uint32_t timeMs) {
+    uint8_t header[MAX_RECORD_HEADER_BYTES];
+    size_t headerLen = 0;
+    header[headerLen++] = (uint8_t) type;
+    headerLen += putVarint(header + headerLen, timeMs - lastRecordMs);
+    headerLen += putVarint(header + headerLen, payloadLen);
+    lastRecordMs = timeMs;
+
+    return writeBytes(header, headerLen);
+}
+
+bool PixelblazeRecorder::writeBytes(const uint8_t *bytes, size_t len) {
+    size_t wrote = out.write(bytes, len);
+    written += wrote;
+    return wrote == len;
+}
+
+void PixelblazeRecorder::addIndexEntry(uint32_t timeMs, uint32_t offset) {
+    if (indexCount >= indexCapacity) {
+        auto *grown = new RecordingIndexEntry[indexCapacity * 2];
+        memcpy(grown, index, indexCount * sizeof(RecordingIndexEntry));
+        delete[] index;
+        index = grown;
+        indexCapacity *= 2;
+    }
+
+    index[indexCount++] = {timeMs, offset};
+}
+
+PixelblazeRecordingReader::PixelblazeRecordingReader(size_t frameBytes) : frameBytes(frameBytes) {
+    frame = new uint8_t[frameBytes];
+}
+
+PixelblazeRecordingReader::~PixelblazeRecordingReader() {
+    close();
+    delete[] frame;
+}
+
+bool PixelblazeRecordingReader::open(const uint8_t *recording, size_t len) {
+    delete[] index;
+    index = nullptr;
+    indexCount = 0;
+
+    if (len < RECORDING_HEADER_BYTES || memcmp(recording, HEADER_MAGIC, sizeof(HEADER_MAGIC)) != 0
+        || recording[4] != RECORDING_VERSION) {
+        data = nullptr;
+        dataLen = 0;
+        return false;
+    }
+
+    data = recording;
+    dataLen = len;
+    recordsEnd = len;
+    pos = RECORDING_HEADER_BYTES;
+    lastRecordMs = 0;
+    frameLen = 0;
+
+    if (!loadIndex()) {
+        return rebuildIndex();
+    }
+
+    return true;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+bool PixelblazeRecordingReader::open(const char *path) {
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat fileStat = {};
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    mapped = mapping;
+    mappedLen = fileStat.st_size;
+    if (!open((const uint8_t *) mapped, mappedLen)) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+#endif
+
+void PixelblazeRecordingReader::close() {
+#if defined(__unix__) || defined(__APPLE__)
+    if (mapped) {
+        munmap(mapped, mappedLen);
+    }
+#endif
+    mapped = nullptr;
+    mappedLen = 0;
+
+    data = nullptr;
+    dataLen = 0;
+    recordsEnd = 0;
+    delete[] index;
+    index = nullptr;
+    indexCount = 0;
+}
+
+bool PixelblazeRecordingReader::loadIndex() {
+    if (dataLen < RECORDING_HEADER_BYTES + RECORDING_FOOTER_BYTES
+        || memcmp(data + dataLen - 4, FOOTER_MAGIC, sizeof(FOOTER_MAGIC)) != 0) {
+        return false;
+    }
+
+    size_t indexPos = getUint32(data + dataLen - RECORDING_FOOTER_BYTES);
+    if (indexPos < RECORDING_HEADER_BYTES || indexPos >= dataLen - RECORDING_FOOTER_BYTES) {
+        return false;
+    }
+
+    size_t readPos = indexPos;
+    RecordType type;
+    uint32_t timeMs;
+    size_t payloadLen;
+    if (!readHeader(readPos, type, timeMs, payloadLen) || type != RecordType::Index) {
+        return false;
+    }
+
+    const uint8_t *payload = data + readPos;
+    size_t payloadPos = 0;
+    uint32_t count;
+    if (!getVarint(payload, payloadLen, payloadPos, count) || count > payloadLen) {
+        return false;
+    }
+
+    index = new RecordingIndexEntry[max(count, (uint32_t) 1)];
+    uint32_t entryTimeMs = 0;
+    uint32_t entryOffset = 0;
+    for (size_t idx = 0; idx < count; idx++) {
+        uint32_t timeDelta, offsetDelta;
+        if (!getVarint(payload, payloadLen, payloadPos, timeDelta)
+            || !getVarint(payload, payloadLen, payloadPos, offsetDelta)) {
+            delete[] index;
+            index = nullptr;
+            return false;
+        }
+        entryTimeMs += timeDelta;
+        entryOffset += offsetDelta;
+        index[idx] = {entryTimeMs, entryOffset};
+    }
+
+    indexCount = count;
+    recordsEnd = indexPos;
+    return true;
+}
+
+bool PixelblazeRecordingReader::rebuildIndex() {
+    //Unfinished recording, possibly cut off mid-record. Key frames can be at most one per record, count them first.
+    size_t scanPos = RECORDING_HEADER_BYTES;
+    size_t keyFrames = 0;
+    size_t lastGoodEnd = scanPos;
+    uint32_t timeMs = 0;
+    RecordType type;
+    uint32_t delta;
+    size_t payloadLen;
+    recordsEnd = dataLen;
+    while (readHeader(scanPos, type, delta, payloadLen)) {
+        scanPos += payloadLen;
+        lastGoodEnd = scanPos;
+        if (type == RecordType::KeyFrame) {
+            keyFrames++;
+        }
+    }
+    recordsEnd = lastGoodEnd;
+
+    index = new RecordingIndexEntry[max(keyFrames, (size_t) 1)];
+    scanPos = RECORDING_HEADER_BYTES;
+    while (scanPos < recordsEnd) {
+        size_t recordPos = scanPos;
+        readHeader(scanPos, type, delta, payloadLen);
+        timeMs += delta;
+        scanPos += payloadLen;
+        if (type == RecordType::KeyFrame) {
+            index[indexCount++] = {timeMs, (uint32_t) recordPos};
+        }
+    }
+
+    return true;
+}
+
+bool PixelblazeRecordingReader::readHeader(size_t &readPos, RecordType &type, uint32_t &timeDeltaMs,
+                                           size_t &payloadLen) const {
+    if (readPos >= recordsEnd) {
+        return false;
+    }
+
+    type = (RecordType) data[readPos++];
+    uint32_t len;
+    if (!getVarint(data, recordsEnd, readPos, timeDeltaMs) || !getVarint(data, recordsEnd, readPos, len)
+        || recordsEnd - readPos < len) {
+        return false;
+    }
+
+    payloadLen = len;
+    return true;
+}
+
+bool PixelblazeRecordingReader::next(RecordedEvent &event) {
+    while (pos < recordsEnd) {
+        RecordType type;
+        uint32_t delta;
+        size_t payloadLen;
+        size_t readPos = pos;
+        if (!readHeader(readPos, type, delta, payloadLen)) {
+            return false;
+        }
+
+        pos = readPos + payloadLen;
+        lastRecordMs += delta;
+        if (type != RecordType::KeyFrame && type != RecordType::DeltaFrame && type != RecordType::Stats
+            && type != RecordType::PatternChange) {
+            continue;
+        }
+
+        event.type = type;
+        event.timeMs = lastRecordMs;
+        return decode(type, data + readPos, payloadLen, event);
+    }
+
+    return false;
+}
+
+bool PixelblazeRecordingReader::seek(uint32_t timeMs) {
+    //Last key frame at or before timeMs
+    size_t low = 0;
+    size_t high = indexCount;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if ((int32_t) (index[mid].timeMs - timeMs) <= 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    if (low == 0) {
+        return false;
+    }
+
+    const RecordingIndexEntry &entry = index[low - 1];
+    size_t readPos = entry.offset;
+    RecordType type;
+    uint32_t delta;
+    size_t payloadLen;
+    if (!readHeader(readPos, type, delta, payloadLen) || type != RecordType::KeyFrame) {
+        return false;
+    }
+
+    pos = entry.offset;
+    lastRecordMs = entry.timeMs - delta;
+    frameLen = 0;
+
+    //Decode forward to timeMs so the frame buffer is current, but stop short of the first event at or after it
+    RecordedEvent skipped;
+    while (pos < recordsEnd) {
+        readPos = pos;
+        if (!readHeader(readPos, type, delta, payloadLen)) {
+            return false;
+        }
+        if ((int32_t) (lastRecordMs + delta - timeMs) >= 0) {
+            return true;
+        }
+
+        if (type == RecordType::KeyFrame || type == RecordType::DeltaFrame) {
+            if (!next(skipped)) {
+                return false;
+            }
+        } else {
+            pos = readPos + payloadLen;
+            lastRecordMs += delta;
+        }
+    }
+
+    return true;
+}
+
+bool PixelblazeRecordingReader::decode(RecordType type, const uint8_t *payload, size_t payloadLen,
+                                       RecordedEvent &event) {
+    size_t payloadPos = 0;
+    switch (type) {
+        case RecordType::KeyFrame: {
+            uint32_t pixels;
+            if (!getVarint(payload, payloadLen, payloadPos, pixels) || pixels * 3 > frameBytes
+                || !getPixels(payload, payloadLen, payloadPos, frame, pixels)) {
+                frameLen = 0;
+                return false;
+            }
+
+            frameLen = pixels * 3;
+            event.frame = frame;
+            event.frameLen = frameLen;
+            return true;
+        }
+        case RecordType::DeltaFrame: {
+            uint32_t numRanges;
+            if (frameLen == 0 || !getVarint(payload, payloadLen, payloadPos, numRanges)) {
+                return false;
+            }
+
+            size_t cursor = 0;
+            for (size_t idx = 0; idx < numRanges; idx++) {
+                uint32_t gap, pixels;
+                if (!getVarint(payload, payloadLen, payloadPos, gap)
+                    || !getVarint(payload, payloadLen, payloadPos, pixels)
+                    || (cursor + gap + pixels) * 3 > frameLen
+                    || !getPixels(payload, payloadLen, payloadPos, frame + (cursor + gap) * 3, pixels)) {
+                    return false;
+                }
+                cursor += gap + pixels;
+            }
+
+            event.frame = frame;
+            event.frameLen = frameLen;
+            return true;
+        }
+        case RecordType::Stats: {
+            if (payloadLen < sizeof(float)) {
+                return false;
+            }
+
+            Stats &stats = event.stats;
+            int renderType;
+            memcpy(&stats.fps, payload, sizeof(float));
+            payloadPos += sizeof(float);
+            bool ok = getSigned(payload, payloadLen, payloadPos, stats.vmerr)
+                      && getSigned(payload, payloadLen, payloadPos, stats.vmerrpc)
+                      && getSigned(payload, payloadLen, payloadPos, stats.memBytes)
+                      && getSigned(payload, payloadLen, payloadPos, stats.expansions)
+                      && getSigned(payload, payloadLen, payloadPos, renderType)
+                      && getSigned(payload, payloadLen, payloadPos, stats.uptimeMs)
+                      && getSigned(payload, payloadLen, payloadPos, stats.storageBytesUsed)
+                      && getSigned(payload, payloadLen, payloadPos, stats.storageBytesSize)
+                      && getSigned(payload, payloadLen, payloadPos, stats.rr0)
+                      && getSigned(payload, payloadLen, payloadPos, stats.rr1)
+                      && getSigned(payload, payloadLen, payloadPos, stats.rebootCounter);
+            stats.renderType = (RenderType) renderType;
+            return ok;
+        }
+        case RecordType::PatternChange:
+            return getString(payload, payloadLen, payloadPos, event.activeProgramId)
+                   && getString(payload, payloadLen, payloadPos, event.patternName)
+                   && getSigned(payload, payloadLen, payloadPos, event.playlistPos);
+        default:
+            return false;
+    }
+}
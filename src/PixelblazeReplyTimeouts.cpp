@@ -0,0 +1,74 @@
+#include "PixelblazeClient.h"
+#include "PixelblazeReplyTimeouts.h"
+
+ReplyTimeouts::ReplyTimeouts(size_t capacity) : capacity(capacity) {
+    heap = new ReplyHandler *[capacity];
+}
+
+ReplyTimeouts::~ReplyTimeouts() {
+    delete[] heap;
+}
+
+bool ReplyTimeouts::push(ReplyHandler *handler) {
+    if (count >= capacity) {
+        return false;
+    }
+
+    place(handler, count);
+    count++;
+    siftUp(handler->heapIdx);
+    return true;
+}
+
+void ReplyTimeouts::remove(ReplyHandler *handler) {
+    size_t idx = handler->heapIdx;
+    if (idx >= count || heap[idx] != handler) {
+        return;
+    }
+
+    count--;
+    if (idx < count) {
+        //Fill the hole with the last entry, which may belong above or below it
+        ReplyHandler *moved = heap[count];
+        place(moved, idx);
+        siftUp(idx);
+        siftDown(moved->heapIdx);
+    }
+}
+
+void ReplyTimeouts::place(ReplyHandler *handler, size_t idx) {
+    heap[idx] = handler;
+    handler->heapIdx = idx;
+}
+
+void ReplyTimeouts::siftUp(size_t idx) {
+    ReplyHandler *handler = heap[idx];
+    while (idx > 0) {
+        size_t parent = (idx - 1) / 2;
+        if (!before(handler, heap[parent])) {
+            break;
+        }
+        place(heap[parent], idx);
+        idx = parent;
+    }
+    place(handler, idx);
+}
+
+void ReplyTimeouts::siftDown(size_t idx) {
+    ReplyHandler *handler = heap[idx];
+    while (true) {
+        size_t child = idx * 2 + 1;
+        if (child >= count) {
+            break;
+        }
+        if (child + 1 < count && before(heap[child + 1], heap[child])) {
+            child++;
+        }
+        if (!before(heap[child], handler)) {
+            break;
+        }
+        place(heap[child], idx);
+        idx = child;
+    }
+    place(handler, idx);
+}